@@ -48,36 +48,28 @@
 
 #define DELAY_TIME 300  // Delay between scroll updates (milliseconds)
 #define LCD_WIDTH 20    // Width of the LCD screen
-#define MESSAGE "Dawg"  // Scrolling message
+#define MESSAGE "Dawg"  // Scrolling message, at most LCD_WIDTH characters
 
+// Same approach as lcd_scrollBanner() in lab_10/lcd_scroll.c: the message is
+// written into the controller's DDRAM once and every step after that is one
+// display shift command, instead of redrawing the screen with lcd_printf().
+// Rows 1 and 3 are one 40 character ring, so the message is put just past the
+// right edge of row 1 (the start of row 3) and each shift left brings it one
+// cell further into row 1; it comes back around through row 3.
 void scrollBanner(void) {
-    int messageLength = strlen(MESSAGE);
-    char display[LCD_WIDTH + 1];  // Buffer to hold the visible portion of the message
-int i;
-int offset;
-    while (1) {
-        // Scroll message from right to left
-        for (offset = 0; offset < messageLength + LCD_WIDTH; offset++) {
-            // Fill display buffer with characters or spaces
-            for (i = 0; i < LCD_WIDTH; i++) {
-                int messageIndex = offset + i - LCD_WIDTH;
-                display[i] = (messageIndex >= 0 && messageIndex < messageLength) ? MESSAGE[messageIndex] : ' ';
-            }
-            display[LCD_WIDTH] = '\0';  // Null-terminate the string
-
-            // Wait for the LCD to be ready before displaying
-            lcd_printf("%s", display);  // Display the string on the LCD
+    char message[LCD_WIDTH + 1];
 
-            timer_waitMillis(DELAY_TIME);  // Delay for smooth scrolling
+    // Longer messages would wrap onto themselves in the ring
+    strncpy(message, MESSAGE, LCD_WIDTH);
+    message[LCD_WIDTH] = '\0';
 
-            // Clear second line to maintain clean display
-            lcd_gotoLine(2);
-            lcd_printf("");  // Ensure second line is blank
-        }
+    lcd_clear();
+    lcd_setCursorPos(0, 2);
+    lcd_puts(message);
 
-        // Clear the screen briefly between loops
-        lcd_clear();
-        timer_waitMillis(DELAY_TIME);
+    while (1) {
+        timer_waitMillis(DELAY_TIME);  // Delay for smooth scrolling
+        lcd_shiftDisplay(-1);
     }
 }
 
@@ -229,6 +229,19 @@ void lcd_setCursorPos(uint8_t x, uint8_t y) {
 	lcd_sendCommand(0x80 | index);
 }
 
+///Shift every row by steps, negative to the left, without touching DDRAM
+void lcd_shiftDisplay(int8_t steps)
+{
+	while (steps < 0) {
+		lcd_sendCommand(HD_DISPLAY_SHIFT_LEFT);
+		steps++;
+	}
+	while (steps > 0) {
+		lcd_sendCommand(HD_DISPLAY_SHIFT_RIGHT);
+		steps--;
+	}
+}
+
 /// Print a formatted string to the LCD screen
 /**
  * Mimics the C library function printf for writing to the LCD screen.  The function is buffered; i.e. if you call
@@ -43,6 +43,11 @@ void lcd_setCursorPos(uint8_t x, uint8_t y);
 
 void lcd_printf(const char *format, ...);
 
+///Shift every row by steps, negative to the left, with the controller's
+///display shift. Each 40 character controller line turns as a ring: rows 1
+///and 3 are one line, rows 2 and 4 the other. lcd_home() undoes it.
+void lcd_shiftDisplay(int8_t steps);
+
 ///Send command to LCD - Position, Clear, Etc.
 void lcd_sendCommand(uint8_t data);
 
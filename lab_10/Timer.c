@@ -6,12 +6,17 @@
  *      Adapted from (and compatible with) Eric Middleton's timer utility
  */
 
-// TODO: Check value of MICROS_PER_TICK
-
 #include "Timer.h"
+#include "power.h"
+
+// WTIMER5 counts up at 16 MHz (PIOSC through the timer's alternate clock
+// input), so 16 counts make a microsecond no matter what the system clock is.
+// As one 64-bit counter it only wraps after about 36,000 years, so there is no
+// overflow interrupt to keep track of. Its match interrupt is only used to
+// wake the CPU from timer_waitMillis() and power_sleepUntil().
+#define COUNTS_PER_MICRO_SHIFT 4
 
-// 65000 gives a countdown time of exactly 65ms TODO: is it 65000 or 64999?
-#define MICROS_PER_TICK 64999UL // Number of microseconds in one timer cycle
+static void timer_wakeHandler(void);
 
 /**
  * @brief Tracks if the clock is currently running or stopped
@@ -19,47 +24,44 @@
  */
 unsigned char _running = 0;
 
-/**
- * @brief Tracks the number of milliseconds passed since a call to startClock()
- *
- */
-volatile unsigned int _timeout_ticks;
-
 /**
  * @brief Initialize and start the clock at 0. If the clock is
- * already running on a call, reset the time count back to 0. Uses TIMER5.
+ * already running on a call, reset the time count back to 0. Uses WTIMER5.
  *
  */
 void timer_init(void) {
     if (!_running) {
-        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5; // Turn on clock to TIMER5
-        TIMER5_CTL_R &= ~TIMER_CTL_TAEN;           // Disable TIMER5 for setup
-        TIMER5_CFG_R = TIMER_CFG_16_BIT;           // Set as 16-bit timer
-        TIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD;    // Periodic, countdown mode
-        TIMER5_TAILR_R = MICROS_PER_TICK - 1;      // Countdown time of 65ms
-        TIMER5_ICR_R |= TIMER_ICR_TATOCINT; // Clear timeout interrupt status
-        TIMER5_TAPR_R = 0x0F;               // 15 gives a period of 1us
-        TIMER5_IMR_R |= TIMER_IMR_TATOIM;   // Allow TIMER5 timeout interrupts
-        NVIC_PRI23_R |= NVIC_PRI23_INTA_M;  // Priority 7 (lowest)
-        NVIC_EN2_R |= (1 << 28);             // Enable TIMER5 interrupts
-
-        IntRegister(INT_TIMER5A, timer_clockTickHandler); // Bind the ISR
-        TIMER5_CTL_R |= TIMER_CTL_TAEN; // Start TIMER5 counting
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R5; // Turn on clock to WTIMER5
+        while (!(SYSCTL_PRWTIMER_R & SYSCTL_PRWTIMER_R5));
+        WTIMER5_CTL_R &= ~TIMER_CTL_TAEN;          // Disable WTIMER5 for setup
+        WTIMER5_CFG_R = TIMER_CFG_32_BIT_TIMER;    // A and B as one 64-bit timer
+        WTIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR | // Count up,
+                         TIMER_TAMR_TAMIE;                           // match can wake
+        WTIMER5_TAILR_R = 0xFFFFFFFF;              // Full 64-bit range
+        WTIMER5_TBILR_R = 0xFFFFFFFF;
+        SYSCTL_ALTCLKCFG_R = SYSCTL_ALTCLKCFG_ALTCLK_PIOSC;
+        WTIMER5_CC_R = TIMER_CC_ALTCLK;            // Count PIOSC, 16 MHz
+        WTIMER5_TAV_R = 0;
+        WTIMER5_TBV_R = 0;
+        WTIMER5_IMR_R &= ~TIMER_IMR_TAMIM;         // Armed by timer_setWake()
+        IntRegister(INT_WTIMER5A, timer_wakeHandler);
+        NVIC_EN3_R |= 1 << (INT_WTIMER5A - 16 - 96); // WTIMER5A is IRQ 104
+        WTIMER5_CTL_R |= TIMER_CTL_TAEN; // Start WTIMER5 counting
 
         _running = 1;
     }
 }
 
 /**
- * @brief Stop the clock and free up TIMER5. Resets the value returned by
+ * @brief Stop the clock and free up WTIMER5. Resets the value returned by
  * timer_getMillis() and timer_getMicros().
  *
  */
 void timer_stop(void) {
-    TIMER5_CTL_R &= ~TIMER_CTL_TAEN;            // Disable TIMER5
-    _timeout_ticks = 0;                         // Reset tick counter
-    TIMER5_TAV_R = MICROS_PER_TICK;             // Set TIMER5 back to the top
-    SYSCTL_RCGCTIMER_R &= ~SYSCTL_RCGCTIMER_R5; // Turn off clock to TIMER5
+    WTIMER5_CTL_R &= ~TIMER_CTL_TAEN;             // Disable WTIMER5
+    WTIMER5_TAV_R = 0;                            // Set WTIMER5 back to 0
+    WTIMER5_TBV_R = 0;
+    SYSCTL_RCGCWTIMER_R &= ~SYSCTL_RCGCWTIMER_R5; // Turn off clock to WTIMER5
     _running = 0;
 }
 
@@ -68,7 +70,7 @@ void timer_stop(void) {
  *
  */
 void timer_pause(void) {
-    TIMER5_CTL_R &= ~TIMER_CTL_TAEN; // Disable TIMER5
+    WTIMER5_CTL_R &= ~TIMER_CTL_TAEN; // Disable WTIMER5
     _running = 0;
 }
 
@@ -77,10 +79,29 @@ void timer_pause(void) {
  *
  */
 void timer_resume(void) {
-    TIMER5_CTL_R |= TIMER_CTL_TAEN; // Enable TIMER5
+    WTIMER5_CTL_R |= TIMER_CTL_TAEN; // Enable WTIMER5
     _running = 1;
 }
 
+/**
+ * @brief Returns the raw 64-bit count, 16 per microsecond. The high half is
+ * read on both sides of the low half; if it changed, the low half wrapped in
+ * between and is read again. No interrupts need to be masked.
+ *
+ * @return counts since the clock was started
+ */
+static uint64_t timer_getCounts(void) {
+    uint32_t high = WTIMER5_TBV_R;
+    uint32_t low = WTIMER5_TAV_R;
+    uint32_t check = WTIMER5_TBV_R;
+
+    if (high != check) {
+        low = WTIMER5_TAV_R; // Wrapped while reading, take the newer value
+    }
+
+    return ((uint64_t)check << 32) | low;
+}
+
 /**
  * @brief Returns the number milliseconds that have passed since startClock()
  * was called. Value rolls over after about 49 days.
@@ -89,23 +110,7 @@ void timer_resume(void) {
  * timer_startClock()
  */
 unsigned int timer_getMillis(void) {
-    unsigned int ticks;
-    unsigned int millis;
-
-    TIMER5_IMR_R &= ~TIMER_IMR_TATOIM; // Disable timeout interrupts
-
-    millis = (MICROS_PER_TICK - TIMER5_TAR_R & 0xFFFF) / 1000;
-    if (TIMER5_RIS_R & TIMER_RIS_TATORIS) {
-        // If the timer overflows while we're getting the time
-        ticks = (_timeout_ticks + 1);
-        millis = 0;
-    } else {
-        ticks = _timeout_ticks;
-    }
-
-    TIMER5_IMR_R |= TIMER_IMR_TATOIM; // Reenable interrupts from TIMER timeout
-
-    return ticks * (MICROS_PER_TICK / 1000) + millis;
+    return (unsigned int)(timer_getMicros64() / 1000);
 }
 
 /**
@@ -115,26 +120,70 @@ unsigned int timer_getMillis(void) {
  * @return unsigned int number of microseconds since a call to startClock()
  */
 unsigned int timer_getMicros(void) {
-    unsigned int ticks;
-    unsigned int micros;
     if(!_running){
            timer_init();
     }
-    TIMER5_IMR_R &= ~TIMER_IMR_TATOIM; // Disable TIMER5 timeout interrupts
+    return (unsigned int)(timer_getCounts() >> COUNTS_PER_MICRO_SHIFT);
+}
+
+/**
+ * @brief Returns the number of microseconds passed since a call to
+ * startClock(), without rolling over.
+ *
+ * @return microseconds since a call to startClock()
+ */
+uint64_t timer_getMicros64(void) {
+    if(!_running){
+           timer_init();
+    }
+    return timer_getCounts() >> COUNTS_PER_MICRO_SHIFT;
+}
 
-    micros = MICROS_PER_TICK - TIMER5_TAR_R & 0xFFFF;
+/**
+ * @brief Raise the WTIMER5 match interrupt when the clock reaches micros. The
+ * interrupt only wakes the CPU and disarms itself. The match only fires on
+ * equality, so a deadline that passed while it was being armed pends the
+ * interrupt by hand instead; a WFI after this always ends.
+ *
+ * @param micros time to wake at, as returned by timer_getMicros64()
+ */
+void timer_setWake(uint64_t micros) {
+    uint64_t counts = micros << COUNTS_PER_MICRO_SHIFT;
+
+    WTIMER5_IMR_R &= ~TIMER_IMR_TAMIM;
+    WTIMER5_TAMATCHR_R = (uint32_t)counts;
+    WTIMER5_TBMATCHR_R = (uint32_t)(counts >> 32);
+    WTIMER5_ICR_R = TIMER_ICR_TAMCINT;
+    WTIMER5_IMR_R |= TIMER_IMR_TAMIM;
 
-    if (TIMER5_RIS_R & TIMER_RIS_TATORIS) {
-        // If the timer overflows while we're getting the time
-        ticks = (_timeout_ticks + 1);
-        micros = 0;
-    } else {
-        ticks = _timeout_ticks;
+    if (timer_getCounts() >= counts) {
+        NVIC_PEND3_R = 1 << (INT_WTIMER5A - 16 - 96); // Too late for the match
     }
+}
+
+static void timer_wakeHandler(void) {
+    WTIMER5_IMR_R &= ~TIMER_IMR_TAMIM;
+    WTIMER5_ICR_R = TIMER_ICR_TAMCINT;
+}
 
-    TIMER5_IMR_R |= TIMER_IMR_TATOIM; // Reenable TIMER5 interrupts
+/**
+ * @brief Spins until WTIMER5 has counted at least the given number of
+ * 62.5 ns counts. Interrupts that run in between count towards the delay
+ * instead of adding to it.
+ *
+ * @param counts number of counts to wait
+ */
+static void timer_waitCounts(uint64_t counts) {
+    uint64_t end;
+
+    if(!_running){
+           timer_init();
+    }
 
-    return ticks * MICROS_PER_TICK + micros;
+    // The start read can fall just before a tick, so wait for one more: a
+    // delay may end up to a count late but never early
+    end = timer_getCounts() + counts + 1;
+    while (timer_getCounts() < end);
 }
 
 /**
@@ -144,30 +193,18 @@ unsigned int timer_getMicros(void) {
  */
 //unsigned int
 void timer_waitMicros(uint32_t delay_time) {
+    timer_waitCounts((uint64_t)delay_time << COUNTS_PER_MICRO_SHIFT);
+}
 
-    if (delay_time <= 2) {
-        // Overhead of the function call is around 1.5us
-        return;
-    } else {
-        delay_time -= 2;
-    }
-
-    while (delay_time > 0) { // ldr: 2, cmp: 1, bne: 1; 4 cycles
-        // 16 cycles = 1us: need 16 - 9 = 7 NOP cycles
-        // Experimentally, 6 is accurate. Missing a cycle?
-        asm(" NOP"
-            "\n"
-            " NOP"
-            "\n"
-            " NOP"
-            "\n"
-            " NOP"
-            "\n"
-            " NOP"
-            "\n"
-            " NOP");
-        delay_time--; // ldr: 2, subs: 1, str: 2; 5 cycles
-    }
+/**
+ * @brief Pauses execution for at least the given number of nanoseconds, in
+ * steps of 62.5 ns.
+ *
+ * @param delay_time number of nanoseconds to pause for
+ */
+void timer_waitNanos(uint32_t delay_time) {
+    // Round up to whole counts
+    timer_waitCounts(((uint64_t)delay_time * 16 + 999) / 1000);
 }
 
 /**
@@ -178,26 +215,11 @@ void timer_waitMicros(uint32_t delay_time) {
 //unsigned int
 void timer_waitMillis(uint32_t delay_time) {
 
-    unsigned int start = timer_getMicros();
-    unsigned int current_micros = timer_getMicros();
-
-    while (delay_time > 0) {
-        current_micros = timer_getMicros();
-        // Uses a while loop (instead of if) in case a long ISR is called
-        while (delay_time > 0 && ((current_micros - start) >= 1000)) {
-            delay_time--;
-            start += 1000;
-            current_micros = timer_getMicros();
-        }
-    }
-}
+    uint64_t end = timer_getMicros64() + (uint64_t)delay_time * 1000;
 
-/**
- * @brief ISR handler to increment the timeout variable for tracking total
- * milliseconds
- *
- */
-static void timer_clockTickHandler() {
-    TIMER5_ICR_R |= TIMER_ICR_TATOCINT; // Clear interrupt flag
-    _timeout_ticks++;
+    // Sleep between interrupts; the WTIMER5 match wakes us at the end, any
+    // other interrupt just costs one more pass
+    while (timer_getMicros64() < end) {
+        power_sleepUntil(end);
+    }
 }
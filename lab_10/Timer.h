@@ -15,13 +15,15 @@
 
 /**
  * @brief Initialize and start the clock at 0. If the clock is
- * already running on a call, reset the time count back to 0. Uses TIMER5.
+ * already running on a call, reset the time count back to 0. Uses WTIMER5 as
+ * a free running 64-bit counter; its match interrupt only wakes the CPU for
+ * timer_waitMillis().
  *
  */
 void timer_init(void);
 
 /**
- * @brief Stop the clock and free up TIMER5. Resets the value returned by
+ * @brief Stop the clock and free up WTIMER5. Resets the value returned by
  * getMillis() and get Micros().
  *
  */
@@ -57,50 +59,74 @@ unsigned int timer_getMillis(void);
 unsigned int timer_getMicros(void);
 
 /**
- * @brief Pauses execution for the specifeid number of microseconds.
+ * @brief Returns the number of microseconds passed since a call to
+ * startClock(). Rolls over after about 36,000 years.
  *
- * @param delay_time number of microseconds to pause for
+ * @return uint64_t number of microseconds since a call to startClock()
+ */
+uint64_t timer_getMicros64(void);
+
+/**
+ * @brief Pauses execution for the specified number of milliseconds. The CPU
+ * sleeps (WFI) in between, interrupts keep being served.
+ *
+ * @param delay_time number of milliseconds to pause for
  */
 void timer_waitMillis(unsigned int delay_time);
 
 /**
- * @brief Pauses execution for the specifeid number of microseconds.
+ * @brief Pauses execution for the specifeid number of microseconds. Counts
+ * WTIMER5, so interrupts and the clock rate do not change the delay. See
+ * oneshot.h to get called back instead of waiting.
  *
  * @param delay_time number of microseconds to pause for
  */
 void timer_waitMicros(unsigned int delay_time);
 
-// TODO: Implement
+/**
+ * @brief Pauses execution for at least the given number of nanoseconds, in
+ * steps of 62.5 ns.
+ *
+ * @param delay_time number of nanoseconds to pause for
+ */
+void timer_waitNanos(unsigned int delay_time);
+
+/**
+ * @brief Raise the WTIMER5 match interrupt when the clock reaches micros, to
+ * wake the CPU from WFI. Only one wake time is armed at a time. If micros has
+ * already passed, the interrupt is pended at once.
+ *
+ * @param micros time to wake at, as returned by timer_getMicros64()
+ */
+void timer_setWake(uint64_t micros);
+
 /**
  * @brief Sets up an interrupt to call the given function once every given
- * milliseconds. Uses TIMER4 for the countdown. Function f executes inside an
- * ISR, so keep the passed function as short as possible. Maximum interval time
- * is TODO: calculate
+ * milliseconds. Runs on the TIMER4 timer wheel (timer_wheel.h), use
+ * timer_every() there to get a handle for cancelling. Function f executes
+ * inside an ISR, so keep the passed function as short as possible.
  *
  * @param f the function to call
  * @param millis the interval between calls
  */
 void timer_fireEvery(void (*f)(void), int millis);
 
-// TODO: Implement
 /**
  * @brief Sets up an interrupt to call the given function after the given number
- * of milliseconds. Uses TIMER4 for the countdown, and thus can only be used
- * when timer_fireEvery() and timer_fireFor() are not being used. Function f
- * executes inside an ISR and should be kept as short as possible.
+ * of milliseconds. Runs on the TIMER4 timer wheel, alongside any other
+ * timers. Function f executes inside an ISR and should be kept as short as
+ * possible.
  *
  * @param f the function to call
  * @param millis milliseconds until call
  */
 void timer_fireOnce(void (*f)(void), int millis);
 
-// TODO: Implement
 /**
  * @brief Sets up an interrupt to call the given function after the given number
- * of milliseconds for the given number of times. Uses TIMER4 for the countdown,
- * and thus can only be used when fireOnce() and fireEvery() are not being used.
- * Function f executes inside an ISR and should be kept as short as possible.
- * Maximum interval time is TODO: calculate
+ * of milliseconds for the given number of times. Runs on the TIMER4 timer
+ * wheel, alongside any other timers. Function f executes inside an ISR and
+ * should be kept as short as possible.
  *
  * @param f the function to call
  * @param millis milliseconds until call
@@ -108,11 +134,4 @@ void timer_fireOnce(void (*f)(void), int millis);
  */
 void timer_fireFor(void (*f)(void), int millis, int times);
 
-/**
- * @brief ISR handler to increment the timeout variable for tracking total
- * milliseconds
- *
- */
-static void timer_clockTickHandler();
-
 #endif /* TIMER_H_ */
@@ -1,6 +1,7 @@
 #include "Timer.h"
 #include "lcd.h"
 #include "adc.h"
+#include "profile.h"
 #include <stdint.h>
 
 
@@ -36,8 +37,10 @@ int ADC0_InSeq3(void) {
 int adc_read(void){
         int i;
         int total = 0;
+        PROFILE_BEGIN(PROFILE_ADC_READ);
         for (i = 0; i < 16; i++) {
             total += ADC0_InSeq3();
         }
+        PROFILE_END(PROFILE_ADC_READ);
         return total / 16;  // Average result
 }
@@ -0,0 +1,52 @@
+/*
+ * clock.c
+ *
+ * PLL setup and the system clock rate, see clock.h.
+ *
+ */
+
+#include <inc/tm4c123gh6pm.h>
+#include "clock.h"
+
+static uint32_t clock_hz = CLOCK_PIOSC_HZ;
+
+void clock_init(void)
+{
+    // Start the crystal and let it settle
+    SYSCTL_RCC_R &= ~SYSCTL_RCC_MOSCDIS;
+    while (!(SYSCTL_RIS_R & SYSCTL_RIS_MOSCPUPRIS));
+
+    // Run from the oscillator directly while the PLL is changed
+    SYSCTL_RCC2_R |= SYSCTL_RCC2_USERCC2;
+    SYSCTL_RCC2_R |= SYSCTL_RCC2_BYPASS2;
+
+    SYSCTL_RCC_R = (SYSCTL_RCC_R & ~SYSCTL_RCC_XTAL_M) | SYSCTL_RCC_XTAL_16MHZ;
+    SYSCTL_RCC2_R &= ~SYSCTL_RCC2_OSCSRC2_M; // main oscillator
+    SYSCTL_RCC2_R &= ~SYSCTL_RCC2_PWRDN2;    // PLL on
+
+    // 400 MHz PLL divided by SYSDIV2:SYSDIV2LSB + 1 = 5
+    SYSCTL_RCC2_R |= SYSCTL_RCC2_DIV400;
+    SYSCTL_RCC2_R = (SYSCTL_RCC2_R & ~(SYSCTL_RCC2_SYSDIV2_M | SYSCTL_RCC2_SYSDIV2LSB)) |
+                    ((400000000UL / CLOCK_PLL_HZ - 1) << 22);
+
+    while (!(SYSCTL_RIS_R & SYSCTL_RIS_PLLLRIS));
+
+    SYSCTL_RCC2_R &= ~SYSCTL_RCC2_BYPASS2;
+    clock_hz = CLOCK_PLL_HZ;
+}
+
+uint32_t clock_getHz(void)
+{
+    return clock_hz;
+}
+
+uint32_t clock_cyclesPerMicro(void)
+{
+    return clock_hz / 1000000UL;
+}
+
+uint32_t clock_baudDivisor(uint32_t baud)
+{
+    // clock / (16 * baud) in 64ths, rounded
+    return (clock_hz * 4 + baud / 2) / baud;
+}
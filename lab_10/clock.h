@@ -0,0 +1,36 @@
+/*
+ * clock.h
+ *
+ * System clock setup. clock_init() runs the core from the PLL at 80 MHz
+ * instead of the 16 MHz PIOSC it resets to. Drivers ask clock_getHz() for the
+ * current rate and work out their baud divisors, PWM periods, prescalers and
+ * delay loops from it, so clock_init() has to run before any of their init
+ * functions.
+ *
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+
+/// Rate out of reset, precision internal oscillator
+#define CLOCK_PIOSC_HZ 16000000UL
+
+/// Rate after clock_init(), 400 MHz PLL / 5
+#define CLOCK_PLL_HZ 80000000UL
+
+/// Switch to the PLL, fed by the 16 MHz crystal
+void clock_init(void);
+
+/// Current system clock in Hz
+uint32_t clock_getHz(void);
+
+/// System clock cycles per microsecond
+uint32_t clock_cyclesPerMicro(void);
+
+/// \brief UART baud rate divisor in 64ths, for a UART clocked by the system
+/// clock with 16x oversampling: IBRD = divisor >> 6, FBRD = divisor & 0x3F
+uint32_t clock_baudDivisor(uint32_t baud);
+
+#endif /* CLOCK_H_ */
@@ -0,0 +1,365 @@
+/*
+ * fmt.c
+ *
+ * Allocation free formatting into buffers and character sinks. See fmt.h.
+ *
+ */
+
+#include "fmt.h"
+
+#define FMT_DIGITS 24 // Longest number: 20 digits of a uint64_t, spare
+
+static const int32_t fmt_powers[FMT_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000
+};
+
+void fmt_buffer(fmt_t *f, char *buffer, uint16_t size)
+{
+    f->buffer = buffer;
+    f->size = size;
+    f->length = 0;
+    f->truncated = 0;
+    f->putc = 0;
+
+    if (size) {
+        buffer[0] = '\0';
+    }
+}
+
+void fmt_sink(fmt_t *f, fmt_putc_t putc)
+{
+    f->buffer = 0;
+    f->size = 0;
+    f->length = 0;
+    f->truncated = 0;
+    f->putc = putc;
+}
+
+void fmt_char(fmt_t *f, char c)
+{
+    if (f->putc) {
+        f->putc(c);
+        f->length++;
+    } else if (f->length + 1 < f->size) {
+        f->buffer[f->length++] = c;
+        f->buffer[f->length] = '\0';
+    } else {
+        f->truncated = 1;
+    }
+}
+
+void fmt_str(fmt_t *f, const char *s)
+{
+    while (*s) {
+        fmt_char(f, *s++);
+    }
+}
+
+static void fmt_repeat(fmt_t *f, char c, uint8_t count)
+{
+    while (count--) {
+        fmt_char(f, c);
+    }
+}
+
+/**
+ * @brief Write sign (if not 0) and len characters of s, padded to the
+ * absolute value of width. Negative widths pad with spaces on the right, zero
+ * padding goes between the sign and the digits.
+ */
+static void fmt_pad(fmt_t *f, char sign, const char *s, uint8_t len, int8_t width, char pad)
+{
+    uint8_t used = len + (sign != 0);
+    uint8_t w = (width < 0) ? -width : width;
+    uint8_t fill = (w > used) ? w - used : 0;
+
+    if (width > 0 && pad == ' ') {
+        fmt_repeat(f, ' ', fill);
+    }
+    if (sign) {
+        fmt_char(f, sign);
+    }
+    if (width > 0 && pad == '0') {
+        fmt_repeat(f, '0', fill);
+    }
+    while (len--) {
+        fmt_char(f, *s++);
+    }
+    if (width < 0) {
+        fmt_repeat(f, ' ', fill);
+    }
+}
+
+void fmt_field(fmt_t *f, const char *s, int8_t width)
+{
+    uint8_t w = (width < 0) ? -width : width;
+    uint8_t len = 0;
+
+    while (len < w && s[len]) {
+        len++;
+    }
+
+    fmt_pad(f, 0, s, len, width, ' ');
+}
+
+/**
+ * @brief Write the digits of value backwards, ending just before end.
+ *
+ * @return the first digit
+ */
+static char *fmt_digits(char *end, uint32_t value, uint8_t base, uint8_t minDigits)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char *p = end;
+
+    do {
+        *--p = digits[value % base];
+        value /= base;
+        if (minDigits) {
+            minDigits--;
+        }
+    } while (value || minDigits);
+
+    return p;
+}
+
+/// Magnitude of a signed value, INT32_MIN included
+static uint32_t fmt_magnitude(int32_t value)
+{
+    return (value < 0) ? (uint32_t)(-(value + 1)) + 1 : (uint32_t)value;
+}
+
+static void fmt_integer(fmt_t *f, char sign, uint32_t value, int8_t width, char pad)
+{
+    char digits[FMT_DIGITS];
+    char *end = digits + sizeof(digits);
+    char *p = fmt_digits(end, value, 10, 1);
+
+    fmt_pad(f, sign, p, end - p, width, pad);
+}
+
+void fmt_int(fmt_t *f, int32_t value, int8_t width)
+{
+    fmt_integer(f, (value < 0) ? '-' : 0, fmt_magnitude(value), width, ' ');
+}
+
+void fmt_uint(fmt_t *f, uint32_t value, int8_t width)
+{
+    fmt_integer(f, 0, value, width, ' ');
+}
+
+void fmt_u64(fmt_t *f, uint64_t value, int8_t width)
+{
+    char digits[FMT_DIGITS];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+
+    // Nine digits at a time, so only the split takes 64-bit divisions
+    while (value > 0xFFFFFFFFu) {
+        p = fmt_digits(p, (uint32_t)(value % 1000000000u), 10, 9);
+        value /= 1000000000u;
+    }
+    p = fmt_digits(p, (uint32_t)value, 10, 1);
+
+    fmt_pad(f, 0, p, end - p, width, ' ');
+}
+
+void fmt_hex(fmt_t *f, uint32_t value, uint8_t digits)
+{
+    char buffer[FMT_DIGITS];
+    char *end = buffer + sizeof(buffer);
+    char *p = fmt_digits(end, value, 16, (digits > 8) ? 8 : digits);
+
+    fmt_pad(f, 0, p, end - p, 0, ' ');
+}
+
+/**
+ * @brief Write whole.fraction, with fraction zero padded to decimals digits
+ * (decimals at most FMT_MAX_DECIMALS, 0 for no point).
+ */
+static void fmt_decimal(fmt_t *f, char sign, uint32_t whole, uint32_t fraction,
+                        uint8_t decimals, int8_t width, char pad)
+{
+    char buffer[FMT_DIGITS];
+    char *end = buffer + sizeof(buffer);
+    char *p = end;
+
+    if (decimals) {
+        // Fraction with its leading zeros, the point, then the whole part
+        p = fmt_digits(p, fraction, 10, decimals);
+        *--p = '.';
+    }
+    p = fmt_digits(p, whole, 10, 1);
+
+    fmt_pad(f, sign, p, end - p, width, pad);
+}
+
+void fmt_fixed(fmt_t *f, int32_t value, uint8_t decimals, int8_t width)
+{
+    uint32_t magnitude = fmt_magnitude(value);
+
+    if (decimals > FMT_MAX_DECIMALS) {
+        decimals = FMT_MAX_DECIMALS;
+    }
+
+    fmt_decimal(f, (value < 0) ? '-' : 0, magnitude / fmt_powers[decimals],
+                magnitude % fmt_powers[decimals], decimals, width, ' ');
+}
+
+static void fmt_floatPad(fmt_t *f, float value, uint8_t decimals, int8_t width, char pad)
+{
+    char sign = (value < 0.0f) ? '-' : 0; // Kept when it rounds to 0, as printf
+    float magnitude = sign ? -value : value;
+    uint32_t whole;
+    uint32_t fraction;
+
+    if (decimals > FMT_MAX_DECIMALS) {
+        decimals = FMT_MAX_DECIMALS;
+    }
+
+    // The whole part has to fit 32 bits; also catches NaN and infinity
+    if (!(magnitude < 4294967040.0f)) {
+        fmt_pad(f, sign, "ovf", 3, width, ' ');
+        return;
+    }
+
+    // Whole part and fraction apart, so decimals do not eat into the range.
+    // The fraction is exact in single precision, rounded half away from zero.
+    whole = (uint32_t)magnitude;
+    fraction = (uint32_t)((magnitude - (float)whole) * (float)fmt_powers[decimals] + 0.5f);
+    if (fraction >= (uint32_t)fmt_powers[decimals]) {
+        fraction -= fmt_powers[decimals]; // Rounded up into the whole part
+        whole++;
+    }
+
+    fmt_decimal(f, sign, whole, fraction, decimals, width, pad);
+}
+
+void fmt_float(fmt_t *f, float value, uint8_t decimals, int8_t width)
+{
+    fmt_floatPad(f, value, decimals, width, ' ');
+}
+
+int fmt_vformat(fmt_t *f, const char *format, va_list args)
+{
+    uint16_t start = f->length;
+
+    while (*format) {
+        char pad = ' ';
+        int8_t left = 0;
+        int8_t width = 0;
+        int8_t precision = -1;
+        int8_t w;
+
+        if (*format != '%') {
+            fmt_char(f, *format++);
+            continue;
+        }
+        format++;
+
+        for (;; format++) {
+            if (*format == '-') {
+                left = 1;
+            } else if (*format == '0') {
+                pad = '0';
+            } else {
+                break;
+            }
+        }
+        while (*format >= '0' && *format <= '9') {
+            width = width * 10 + (*format++ - '0');
+        }
+        if (*format == '.') {
+            format++;
+            precision = 0;
+            while (*format >= '0' && *format <= '9') {
+                precision = precision * 10 + (*format++ - '0');
+            }
+        }
+        while (*format == 'l' || *format == 'h') {
+            format++; // int and long are both 32 bits here
+        }
+
+        w = left ? -width : width;
+        if (left) {
+            pad = ' ';
+        }
+
+        switch (*format) {
+        case 'd':
+        case 'i': {
+            int32_t value = va_arg(args, int);
+
+            fmt_integer(f, (value < 0) ? '-' : 0, fmt_magnitude(value), w, pad);
+            break;
+        }
+        case 'u':
+            fmt_integer(f, 0, va_arg(args, unsigned int), w, pad);
+            break;
+        case 'x':
+        case 'X': {
+            char buffer[FMT_DIGITS];
+            char *end = buffer + sizeof(buffer);
+            char *p = fmt_digits(end, va_arg(args, unsigned int), 16, 1);
+            char *c;
+
+            for (c = p; *format == 'x' && c < end; c++) {
+                if (*c >= 'A') {
+                    *c += 'a' - 'A';
+                }
+            }
+            fmt_pad(f, 0, p, end - p, w, pad);
+            break;
+        }
+        case 'c': {
+            char c = (char)va_arg(args, int);
+
+            fmt_pad(f, 0, &c, 1, w, ' ');
+            break;
+        }
+        case 's': {
+            const char *s = va_arg(args, const char *);
+            uint8_t len = 0;
+
+            if (s == 0) {
+                s = "(null)";
+            }
+
+            while (s[len] && (precision < 0 || len < precision) && len < 255) {
+                len++;
+            }
+            fmt_pad(f, 0, s, len, w, ' ');
+            break;
+        }
+        case 'f':
+            // Passed as double; converting once is all the double math done
+            fmt_floatPad(f, (float)va_arg(args, double),
+                         (precision < 0) ? FMT_MAX_DECIMALS : precision, w, pad);
+            break;
+        case '%':
+            fmt_char(f, '%');
+            break;
+        case '\0':
+            return f->length - start; // Format ends in '%'
+        default:
+            fmt_char(f, '%'); // Unknown, show it as it was written
+            fmt_char(f, *format);
+            break;
+        }
+        format++;
+    }
+
+    return f->length - start;
+}
+
+int fmt_format(fmt_t *f, const char *format, ...)
+{
+    va_list args;
+    int written;
+
+    va_start(args, format);
+    written = fmt_vformat(f, format, args);
+    va_end(args);
+
+    return written;
+}
@@ -0,0 +1,88 @@
+/*
+ * fmt.h
+ *
+ * Small formatter for the LCD and telemetry, in place of sprintf/vsnprintf.
+ * Nothing is allocated and there is no double arithmetic: integers are
+ * converted with the hardware divider, fixed point values are integers with
+ * a number of decimals, and floats are scaled once in single precision.
+ *
+ * Output goes either into a caller supplied buffer, which is never overrun
+ * and always stays terminated, or straight to a character sink such as
+ * uart_sendChar() or lcd_putc():
+ *
+ *     char line[32];
+ *     fmt_t f;
+ *
+ *     fmt_buffer(&f, line, sizeof(line));
+ *     fmt_str(&f, "Dist:");
+ *     fmt_fixed(&f, distanceMm, 1, 6);    // "Dist: 123.4"
+ *
+ *     fmt_sink(&f, uart_sendChar);
+ *     fmt_format(&f, "%3d deg %5.2f cm\n", angle, width);
+ *
+ * The typed calls are checked by the compiler. fmt_format() takes the usual
+ * %d %i %u %x %X %c %s %f %% conversions with '-' and '0' flags, a width and a
+ * precision, for code that already has printf style strings. Widths are
+ * minimums, a string's precision is its maximum length. %f goes through
+ * fmt_float(): single precision, whole parts up to 4294967040, ties rounded
+ * away from zero ("%.0f" of 2.5 is "3"). tools/fmt_bench.c compares the output
+ * and speed with the C library's snprintf on the host.
+ *
+ */
+
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#define FMT_MAX_DECIMALS 6 // Floats carry about 7 significant digits
+
+typedef void (*fmt_putc_t)(char c);
+
+typedef struct {
+    char *buffer;       // NULL when writing to putc
+    uint16_t size;      // buffer size, including the terminator
+    uint16_t length;    // characters written so far
+    uint8_t truncated;  // set once something did not fit into the buffer
+    fmt_putc_t putc;
+} fmt_t;
+
+/// Write into buffer, at most size - 1 characters and a terminator
+void fmt_buffer(fmt_t *f, char *buffer, uint16_t size);
+
+/// Send every character to putc
+void fmt_sink(fmt_t *f, fmt_putc_t putc);
+
+void fmt_char(fmt_t *f, char c);
+
+void fmt_str(fmt_t *f, const char *s);
+
+/// Exactly width characters of s: cut off, or padded with spaces on the
+/// right (negative width) or left
+void fmt_field(fmt_t *f, const char *s, int8_t width);
+
+/// Decimal, padded with spaces to width; a negative width pads on the right
+void fmt_int(fmt_t *f, int32_t value, int8_t width);
+
+void fmt_uint(fmt_t *f, uint32_t value, int8_t width);
+
+/// 64-bit counters such as timer_getMicros64(), padded like fmt_uint()
+void fmt_u64(fmt_t *f, uint64_t value, int8_t width);
+
+/// Upper case hex, zero padded to digits
+void fmt_hex(fmt_t *f, uint32_t value, uint8_t digits);
+
+/// value / 10^decimals with all decimals shown, e.g. 1234, 2 gives "12.34"
+void fmt_fixed(fmt_t *f, int32_t value, uint8_t decimals, int8_t width);
+
+/// value rounded to decimals (at most FMT_MAX_DECIMALS); "ovf" when the
+/// whole part does not fit into 32 bits, or for NaN and infinity
+void fmt_float(fmt_t *f, float value, uint8_t decimals, int8_t width);
+
+/// printf subset, see above. Returns the number of characters written.
+int fmt_vformat(fmt_t *f, const char *format, va_list args);
+
+int fmt_format(fmt_t *f, const char *format, ...);
+
+#endif /* FMT_H_ */
@@ -12,6 +12,12 @@
 
 
 #include "lcd.h"
+#include "profile.h"
+#include "fmt.h"
+#include "clock.h"
+#include "power.h"
+#include "ringbuf.h"
+#include "driverlib/interrupt.h"
 
 #define BIT0		0x01
 #define BIT1		0x02
@@ -38,8 +44,6 @@
 #define HD_DISPLAY_SHIFT_LEFT 0x18
 #define HD_DISPLAY_SHIFT_RIGHT 0x1C
 
-#define LCD_WIDTH 20
-#define LCD_HEIGHT 4
 #define LCD_TOTAL_CHARS (LCD_WIDTH * LCD_HEIGHT)
 #define LCD_DDRAM_WRITE 0x80
 #define LCD_CGRAM_WRITE 0x40
@@ -50,21 +54,210 @@
 #define LCD_PORT_DATA	GPIO_PORTF_DATA_R
 #define LCD_PORT_CNTRL	GPIO_PORTD_DATA_R
 
+//HD44780 timing: enable high >= 450ns with data set up >= 195ns before the
+//falling edge, enable cycle >= 1000ns, 37us to execute a write
+#define LCD_ENABLE_NANOS	500
+#define LCD_EXEC_MICROS		43
+
+//Writer queue: after lcd_init() every nibble goes through lcd_queue and is
+//clocked out by the TIMER0A interrupt. One byte per nibble: the nibble, RS and
+//how long the controller needs before the next one.
+#define LCD_QUEUE_SIZE		256
+#define LCD_Q_NIBBLE		0x0F
+#define LCD_Q_RS			0x10
+#define LCD_Q_WAIT_S		5
+#define LCD_WAIT_CYCLE		0	//Between the two nibbles of a byte, 1us
+#define LCD_WAIT_EXEC		1	//After a write or most commands, 43us
+#define LCD_WAIT_LONG		2	//After clear and home, 2ms
+
+//Longest sleep while waiting on the queue, the TIMER0A interrupt wakes us first
+#define LCD_SLEEP_MICROS	1000
+
+static const uint16_t lcd_waitMicros[] = {1, LCD_EXEC_MICROS, 2000};
+
+static uint8_t lcd_queueStorage[LCD_QUEUE_SIZE];
+static ringbuf_t lcd_queue;
+static uint8_t lcd_async = 0;
+static volatile uint8_t lcd_engineBusy = 0;
+
 
 //TODO: Poll Busy Flag
 
+//Framebuffer: lcd_frame is what the screen should show, lcd_shown what the
+//controller's DDRAM holds. lcd_putc() and lcd_sendCommand() keep lcd_shown and
+//the address counter in step, so lcd_refresh() only sends the cells that differ.
+#define LCD_ADDR_CGRAM 0xFF
+
+static const uint8_t lcd_lineAddresses[] = {0x00, 0x40, 0x14, 0x54};
+
+static char lcd_frame[LCD_HEIGHT][LCD_WIDTH];
+static char lcd_shown[LCD_HEIGHT][LCD_WIDTH];
+static uint8_t lcd_address = 0;		//Next DDRAM address lcd_putc() writes
+static int8_t lcd_shift = 0;		//Display shift, undone by lcd_home()
+
 //private function prototypes
 
+///Cell shown at a DDRAM address (no display shift), 0 if there is none
+static char *lcd_shownAt(uint8_t address)
+{
+	uint8_t y;
+
+	for (y = 0; y < LCD_HEIGHT; y++) {
+		if (address >= lcd_lineAddresses[y] && address < lcd_lineAddresses[y] + LCD_WIDTH) {
+			return &lcd_shown[y][address - lcd_lineAddresses[y]];
+		}
+	}
+
+	return 0;
+}
+
+///Follow the controller's address counter across a write, 2 line mode
+static void lcd_advanceAddress(void)
+{
+	if (lcd_address == LCD_ADDR_CGRAM) {
+		return;
+	}
+
+	lcd_address++;
+	if (lcd_address == 0x28) {
+		lcd_address = 0x40;
+	} else if (lcd_address == 0x68) {
+		lcd_address = 0x00;
+	}
+}
+
 uint8_t lcd_reverseNibble(uint8_t x)
 {
 	return(((x & 0b0001) << 3) | ((x & 0b0010) << 1) | ((x & 0b0100) >> 1) | ((x & 0b1000) >> 3));
 }
 
 
+///Set RS and clock one nibble into the controller
+static void lcd_strobe(uint8_t entry)
+{
+	if (entry & LCD_Q_RS) {
+		LCD_PORT_CNTRL |= RS_PIN;
+	} else {
+		LCD_PORT_CNTRL &= ~RS_PIN;
+	}
+	LCD_PORT_CNTRL &= ~(RW_PIN);
+
+	uint8_t theNibble = entry & LCD_Q_NIBBLE;
+	#ifdef IS_STEPPER_BOARD
+	theNibble = lcd_reverseNibble(theNibble);
+	#endif
+	LCD_PORT_CNTRL |= EN_PIN;
+	LCD_PORT_DATA |= (theNibble & 0x0F) << 1; //PORTD1:4
+
+	//Enable pulse width and data setup time, counted by WTIMER5
+	timer_waitNanos(LCD_ENABLE_NANOS);
+	//Clock in Data
+	LCD_PORT_CNTRL &= ~(EN_PIN);
+
+	//Data hold, and the rest of the enable cycle
+	timer_waitNanos(LCD_ENABLE_NANOS);
+	//Clear Port
+	LCD_PORT_DATA &= ~((0x0F) << 1);
+}
+
+///Fire TIMER0A after micros
+static void lcd_armTimer(uint32_t micros)
+{
+	TIMER0_TAILR_R = micros * clock_cyclesPerMicro();
+	TIMER0_CTL_R |= TIMER_CTL_TAEN; //One-shot, clears itself at the timeout
+}
+
+///TIMER0A: the controller is ready, send the next nibble
+static void lcd_timerHandler(void)
+{
+	uint8_t entry;
+
+	TIMER0_ICR_R = TIMER_ICR_TATOCINT;
+
+	if (!ringbuf_get(&lcd_queue, &entry)) {
+		lcd_engineBusy = 0;
+		return;
+	}
+
+	lcd_strobe(entry);
+	lcd_armTimer(lcd_waitMicros[entry >> LCD_Q_WAIT_S]);
+}
+
+///Queue one nibble and start the writer if it is idle. The queue has a single
+///producer, so this only runs from the main program, never from an ISR.
+static void lcd_enqueue(uint8_t entry)
+{
+	bool wasDisabled;
+
+	if (!ringbuf_space(&lcd_queue)) {
+		//Full, so TIMER0A is running; sleep until it takes a nibble
+		wasDisabled = power_lock();
+		while (!ringbuf_space(&lcd_queue)) {
+			power_sleepLocked(POWER_FOREVER);
+		}
+		power_unlock(wasDisabled);
+	}
+
+	ringbuf_put(&lcd_queue, entry);
+
+	wasDisabled = IntMasterDisable();
+	if (!lcd_engineBusy) {
+		lcd_engineBusy = 1;
+		lcd_armTimer(1);
+	}
+	if (!wasDisabled) {
+		IntMasterEnable();
+	}
+}
+
+///Send a byte as two nibbles, then give the controller time to execute it
+static void lcd_write(uint8_t data, uint8_t rs, uint8_t wait)
+{
+	uint8_t high = (data >> 4) | rs | (LCD_WAIT_CYCLE << LCD_Q_WAIT_S);
+	uint8_t low = (data & 0x0F) | rs | (wait << LCD_Q_WAIT_S);
+
+	if (lcd_async) {
+		lcd_enqueue(high);
+		lcd_enqueue(low);
+		return;
+	}
+
+	lcd_strobe(high);
+	timer_waitMicros(lcd_waitMicros[LCD_WAIT_CYCLE]);
+	lcd_strobe(low);
+	if (wait == LCD_WAIT_LONG) {
+		timer_waitMillis(2);
+	} else {
+		timer_waitMicros(lcd_waitMicros[wait]);
+	}
+}
+
+///Set up TIMER0A to clock out the queue
+static void lcd_startWriter(void)
+{
+	ringbuf_init(&lcd_queue, lcd_queueStorage, LCD_QUEUE_SIZE);
+
+	SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R0; //Turn on clock to TIMER0
+	while (!(SYSCTL_PRTIMER_R & SYSCTL_PRTIMER_R0));
+	TIMER0_CTL_R &= ~TIMER_CTL_TAEN;		   //Disable TIMER0 for setup
+	TIMER0_CFG_R = TIMER_CFG_32_BIT_TIMER;	 //A alone, 32 bits of cycles
+	TIMER0_TAMR_R = TIMER_TAMR_TAMR_1_SHOT;	//One-shot, countdown mode
+	TIMER0_ICR_R = TIMER_ICR_TATOCINT;
+	TIMER0_IMR_R |= TIMER_IMR_TATOIM;
+	NVIC_PRI4_R = (NVIC_PRI4_R & ~NVIC_PRI4_INT19_M) | (2 << NVIC_PRI4_INT19_S);
+	IntRegister(INT_TIMER0A, lcd_timerHandler);
+	NVIC_EN0_R |= 1 << (INT_TIMER0A - 16);	 //TIMER0A is IRQ 19
+
+	lcd_engineBusy = 0;
+	lcd_async = 1;
+}
+
 void lcd_init(void)
 {
 	//TODO: Remove waitMillis after commands -- poll busy flag in sendCommand
 	volatile uint32_t i = 0;
+	lcd_flush(); //In case this is a second lcd_init()
+	lcd_async = 0; //Blocking writes until the controller is set up
 	SYSCTL_RCGCGPIO_R |= BIT3 | BIT5; //Turn on PORTD, PORTF sys clock
 
 	//Set port to output
@@ -116,24 +309,21 @@ void lcd_init(void)
 	lcd_clear();
 	timer_waitMillis(1);
 
+	lcd_startWriter();
 }
 
 ///Send Char to LCD
 void lcd_putc(char data)
 {
-	//Select - Send Data
-	LCD_PORT_CNTRL |= RS_PIN;
-	LCD_PORT_CNTRL &= ~(RW_PIN);
-
-	//Send High nibble
-	lcd_sendNibble(data >> 4);
+	char *cell = (lcd_address == LCD_ADDR_CGRAM) ? 0 : lcd_shownAt(lcd_address);
 
-	timer_waitMicros(43);
-
-	//Send Lower Nibble
-	lcd_sendNibble(data & 0x0F);
+	if (cell) {
+		*cell = data;
+	}
+	lcd_advanceAddress();
 
-	//TODO: Poll Busy flag
+	//Select - Send Data
+	lcd_write(data, LCD_Q_RS, LCD_WAIT_EXEC);
 }
 
 ///Send Character array to LCD
@@ -150,49 +340,61 @@ void lcd_puts(char data[])
 ///Send Command to LCD - Position, Clear, Etc.
 void lcd_sendCommand(uint8_t data)
 {
-	//Enable High
-	LCD_PORT_CNTRL |= EN_PIN;
-	LCD_PORT_CNTRL &= ~(RW_PIN | RS_PIN); // Write Command
-
-	//Send High nibble
-	lcd_sendNibble(data >> 4);
-
-	timer_waitMicros(1);
-	//Send Lower Nibble
-	lcd_sendNibble(data & 0x0F);
-
 	//TODO: Poll Busy Flag
-	timer_waitMillis(1);
+	if (data == HD_LCD_CLEAR || (data & 0xFE) == HD_RETURN_HOME) {
+		lcd_write(data, 0, LCD_WAIT_LONG); //Clear and home take 1.52ms
+	} else {
+		lcd_write(data, 0, LCD_WAIT_EXEC);
+	}
+
+	//Track where the next character goes
+	if (data & LCD_DDRAM_WRITE) {
+		lcd_address = data & 0x7F;
+	} else if (data & LCD_CGRAM_WRITE) {
+		lcd_address = LCD_ADDR_CGRAM;
+	} else if (data == HD_LCD_CLEAR) {
+		memset(lcd_shown, ' ', sizeof(lcd_shown));
+		lcd_address = 0;
+		lcd_shift = 0;
+	} else if ((data & 0xFE) == HD_RETURN_HOME) {
+		lcd_address = 0;
+		lcd_shift = 0;
+	} else if ((data & 0xFC) == HD_CURSOR_MOVE_LEFT) {
+		lcd_address = (lcd_address == LCD_ADDR_CGRAM) ? LCD_ADDR_CGRAM : lcd_address - 1;
+	} else if ((data & 0xFC) == HD_CURSOR_MOVE_RIGHT) {
+		lcd_advanceAddress();
+	} else if ((data & 0xFC) == HD_DISPLAY_SHIFT_LEFT) {
+		lcd_shift = (lcd_shift - 1) % LCD_DDRAM_LINE; //A full turn is no shift
+	} else if ((data & 0xFC) == HD_DISPLAY_SHIFT_RIGHT) {
+		lcd_shift = (lcd_shift + 1) % LCD_DDRAM_LINE;
+	}
 }
 
 
 ///Send 4bit nibble to lcd, then clear port.
 void lcd_sendNibble(uint8_t theNibble)
 {
-	#ifdef IS_STEPPER_BOARD
-	theNibble = lcd_reverseNibble(theNibble);
-    #endif
-	LCD_PORT_CNTRL |= EN_PIN;
-	LCD_PORT_DATA |= (theNibble & 0x0F) << 1; //PORTD1:4
+	lcd_flush(); //Keep the order with queued writes
 
-	//Data Hold time before Clock = 40ns -- Change if faster clock
-	timer_waitMicros(20);
-	//Clock in Data
-	LCD_PORT_CNTRL &= ~(EN_PIN);
+	//RS as left by the last write
+	lcd_strobe((theNibble & LCD_Q_NIBBLE) | ((LCD_PORT_CNTRL & RS_PIN) ? LCD_Q_RS : 0));
+}
 
-	timer_waitMicros(20);
-	//Clear Port
-	LCD_PORT_DATA &= ~((0x0F) << 1);
+///Wait until every queued write reached the controller
+void lcd_flush(void)
+{
+	while (lcd_engineBusy || ringbuf_count(&lcd_queue)) {
+		power_sleepUntil(timer_getMicros64() + LCD_SLEEP_MICROS);
+	}
 }
 
 ///Clear LCD Screen
 void inline lcd_clear(void)
 {
+	//Takes over 1ms, lcd_sendCommand() waits it out
 	lcd_sendCommand(HD_LCD_CLEAR);
 
-	//This command takes over 1ms to complete
-	timer_waitMillis(2);
-
+	memset(lcd_frame, ' ', sizeof(lcd_frame));
 }
 
 ///Return Cursor to 0,0
@@ -201,29 +403,56 @@ void inline lcd_home(void)
 	lcd_sendCommand(HD_RETURN_HOME);
 }
 
+///Shift every row by steps, negative to the left, without touching DDRAM
+void lcd_shiftDisplay(int8_t steps)
+{
+	while (steps < 0) {
+		lcd_sendCommand(HD_DISPLAY_SHIFT_LEFT);
+		steps++;
+	}
+	while (steps > 0) {
+		lcd_sendCommand(HD_DISPLAY_SHIFT_RIGHT);
+		steps--;
+	}
+}
+
+/**
+ * Write count rows of the 5x8 custom character code (0-7), starting at row
+ * first. Cells showing the character change at once, without being rewritten.
+ * The cursor goes back to where it was.
+ */
+void lcd_loadGlyph(uint8_t code, uint8_t first, const uint8_t *rows, uint8_t count)
+{
+	uint8_t was = lcd_address;
+
+	lcd_sendCommand(LCD_CGRAM_WRITE | ((code & 0x07) << 3) | (first & 0x07));
+	while (count--) {
+		lcd_putc(*rows++ & 0x1F);
+	}
+
+	if (was != LCD_ADDR_CGRAM) {
+		lcd_sendCommand(LCD_DDRAM_WRITE | was);
+	}
+}
+
 ///Goto 0 indexed line number
 void lcd_gotoLine(uint8_t lineNum)
 {
 
-	//Address of the four line elements
-	static const uint8_t lineAddress[] = {0x00, 0x40, 0x14, 0x54};
-
 	lineNum = (0x03 & (lineNum-1)); // Mask input for 0 - 3
-	lcd_sendCommand(LCD_DDRAM_WRITE | lineAddress[lineNum]);
+	lcd_sendCommand(LCD_DDRAM_WRITE | lcd_lineAddresses[lineNum]);
 
 }
 
 ///Set cursor position - top left is 0,0
 void lcd_setCursorPos(uint8_t x, uint8_t y) {
-	static const uint8_t lineAddresses[] = {0x00, 0x40, 0x14, 0x54};
-
 	if(x >= 20 || y >= 4) {
 		//Invalid coordinates
 		return;
 	}
 
 	//Compute the location index
-	uint8_t index = lineAddresses[y] + x;
+	uint8_t index = lcd_lineAddresses[y] + x;
 
 	//Set the cursor index
 	lcd_sendCommand(0x80 | index);
@@ -234,7 +463,8 @@ void lcd_setCursorPos(uint8_t x, uint8_t y) {
  * Mimics the C library function printf for writing to the LCD screen.  The function is buffered; i.e. if you call
  * lprintf twice with the same string, it will only update the LCD the first time.
  *
- * Google "printf" for documentation on the formatter string.
+ * Takes the printf subset of fmt.h (no heap, no double math) rather than the C
+ * library's vsnprintf.
  *
  * Code from this site was also used: http://www.ozzu.com/cpp-tutorials/tutorial-writing-custom-printf-wrapper-function-t89166.html
  * @author Kerrick Staley & Chad Nelson
@@ -242,18 +472,18 @@ void lcd_setCursorPos(uint8_t x, uint8_t y) {
  */
 
 void lcd_printf(const char *format, ...) {
-	static char lastbuffer[LCD_TOTAL_CHARS + 1];
-
 	char buffer[LCD_TOTAL_CHARS + 1];
+	fmt_t f;
+	PROFILE_BEGIN(PROFILE_LCD_PRINTF);
 	va_list arglist;
 	va_start(arglist, format);
-	vsnprintf(buffer, LCD_TOTAL_CHARS + 1, format, arglist);
-
-	if (!strcmp(lastbuffer, buffer))
-		return;
+	fmt_buffer(&f, buffer, sizeof(buffer));
+	fmt_vformat(&f, format, arglist);
+	va_end(arglist);
 
-	strcpy(lastbuffer, buffer);
-	lcd_clear();
+	//Lay the text out in the framebuffer, the rest of the screen blank, and
+	//send only what changed since the last call
+	memset(lcd_frame, ' ', sizeof(lcd_frame));
 	char *str = buffer;
 	int charnum = 0;
 	while (*str && charnum < LCD_TOTAL_CHARS) {
@@ -261,36 +491,92 @@ void lcd_printf(const char *format, ...) {
 			/* fill remainder of line with spaces */
 			charnum += LCD_WIDTH - charnum % LCD_WIDTH;
 		} else {
-			lcd_putc(*str);
+			lcd_frame[charnum / LCD_WIDTH][charnum % LCD_WIDTH] = *str;
 			charnum++;
 		}
 
 		str++;
+	}
+
+	lcd_refresh();
+	PROFILE_END(PROFILE_LCD_PRINTF);
+}
+
+///Write a character into the framebuffer
+void lcd_bufPutc(uint8_t x, uint8_t y, char c)
+{
+	if (x < LCD_WIDTH && y < LCD_HEIGHT) {
+		lcd_frame[y][x] = c;
+	}
+}
+
+///Write a string into the framebuffer, cut off at the end of the row
+void lcd_bufPuts(uint8_t x, uint8_t y, const char *s)
+{
+	while (*s && x < LCD_WIDTH) {
+		lcd_bufPutc(x++, y, *s++);
+	}
+}
 
-		/*
-		 * The LCD's lines are not sequential; for future reference, the address are like
-		 * 0x00...0x13 : line 1
-		 * 0x14...0x27 : line 3
-		 * 0x28...0x3F : random junk
-		 * 0x40...0x53 : line 2
-		 * 0x54...0x68 : line 4
-		 *
-		 * The cursor position must be reset at the end of every line, otherwise, after writing line 1, it writes line 3 and then nothingness
-		 */
-
-		if (charnum % LCD_WIDTH == 0) {
-			switch (charnum / LCD_WIDTH) {
-			case 1:
-				lcd_gotoLine(2);
-				break;
-			case 2:
-				lcd_gotoLine(3);
-				break;
-			case 3:
-				lcd_gotoLine(4);
+///Blank the framebuffer
+void lcd_bufClear(void)
+{
+	memset(lcd_frame, ' ', sizeof(lcd_frame));
+}
+
+/**
+ * Send the framebuffer cells that differ from the screen. Each row with changes
+ * costs one cursor move, then everything from its first to its last changed
+ * cell is written: a character takes as long as a cursor move, so writing
+ * through a few unchanged cells is never slower than skipping them.
+ */
+void lcd_refresh(void)
+{
+	uint8_t x;
+	uint8_t y;
+
+	if (lcd_shift != 0) {
+		lcd_home(); //Undo a display shift, the cells below assume none
+	}
+
+	/*
+	 * The LCD's lines are not sequential; for future reference, the address are like
+	 * 0x00...0x13 : line 1
+	 * 0x14...0x27 : line 3
+	 * 0x28...0x3F : random junk
+	 * 0x40...0x53 : line 2
+	 * 0x54...0x68 : line 4
+	 */
+	for (y = 0; y < LCD_HEIGHT; y++) {
+		int8_t first = -1;
+		int8_t last = -1;
+
+		for (x = 0; x < LCD_WIDTH; x++) {
+			if (lcd_frame[y][x] != lcd_shown[y][x]) {
+				if (first < 0) {
+					first = x;
+				}
+				last = x;
 			}
 		}
+
+		if (first < 0) {
+			continue;
+		}
+
+		//A run that carries on from the end of the previous line needs no move
+		if (lcd_address != lcd_lineAddresses[y] + first) {
+			lcd_setCursorPos(first, y);
+		}
+		for (x = first; x <= last; x++) {
+			lcd_putc(lcd_frame[y][x]);
+		}
 	}
-	va_end(arglist);
+}
+
+///Forget what the screen shows, the next lcd_refresh() rewrites every cell
+void lcd_invalidate(void)
+{
+	memset(lcd_shown, 0, sizeof(lcd_shown));
 }
 
@@ -17,6 +17,13 @@
 #include <inc/tm4c123gh6pm.h>
 #include "Timer.h"
 
+//The lcd_* calls share one writer queue and framebuffer: call them from one
+//context, the main program or a single task, never from an interrupt.
+
+#define LCD_WIDTH 20
+#define LCD_HEIGHT 4
+#define LCD_DDRAM_LINE 40 //Characters per controller line, rows 1+3 and 2+4
+
 /// Extra function for the stepper motor board
 uint8_t lcd_reverseNibble(uint8_t x);
 
@@ -29,7 +36,7 @@ void lcd_putc(char data);
 ///Send Character array to LCD
 void lcd_puts(char data[]);
 
-///Clear LCD Screen
+///Clear LCD Screen and the framebuffer
 void inline lcd_clear(void);
 
 ///Return Cursor to 0,0
@@ -41,13 +48,46 @@ void lcd_gotoLine(uint8_t lineNum);
 ///Set cursor position - top left is 0,0
 void lcd_setCursorPos(uint8_t x, uint8_t y);
 
+///Shift every row by steps, negative to the left, with the controller's
+///display shift. Each 40 character controller line turns as a ring: rows 1
+///and 3 are one line, rows 2 and 4 the other. lcd_home() and lcd_refresh()
+///undo it.
+void lcd_shiftDisplay(int8_t steps);
+
+///Write count rows of custom character code (0-7) from row first. The
+///character shows up as code or code + 8; use code + 8 in strings.
+void lcd_loadGlyph(uint8_t code, uint8_t first, const uint8_t *rows, uint8_t count);
+
+/// Print to the whole screen like printf, '\n' starts the next line. Goes
+/// through the framebuffer, so only the cells that changed are sent.
 void lcd_printf(const char *format, ...);
 
+/// Write a character into the framebuffer at column x, row y (0 indexed)
+void lcd_bufPutc(uint8_t x, uint8_t y, char c);
+
+/// Write a string into the framebuffer at column x, row y, cut off at the end
+/// of the row
+void lcd_bufPuts(uint8_t x, uint8_t y, const char *s);
+
+/// Blank the framebuffer
+void lcd_bufClear(void);
+
+/// Send the framebuffer cells that differ from the screen
+void lcd_refresh(void);
+
+/// Forget what the screen shows, the next lcd_refresh() rewrites every cell
+void lcd_invalidate(void);
+
 ///Send command to LCD - Position, Clear, Etc.
 void lcd_sendCommand(uint8_t data);
 
-///Send 4bit nibble to lcd, then clear port
+///Send 4bit nibble to lcd, then clear port. Blocking, waits for queued writes.
 void lcd_sendNibble(uint8_t theNibble);
 
+///Wait until every queued write reached the controller. Once lcd_init() is
+///done, writes and commands only queue nibbles for the TIMER0A interrupt to
+///clock out and return at once.
+void lcd_flush(void);
+
 
 #endif /* LCD_H_ */
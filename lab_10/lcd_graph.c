@@ -0,0 +1,144 @@
+/*
+ * lcd_graph.c
+ *
+ * Bar graph and echo strip views of scan data with custom characters. See
+ * lcd_graph.h.
+ *
+ */
+
+#include <string.h>
+#include "lcd_graph.h"
+#include "lcd.h"
+
+#define LCD_GRAPH_GLYPH_ROWS 8
+#define LCD_GRAPH_GLYPH_BASE 8    // Glyph 0 shows as 8 too, which is not '\0'
+#define LCD_GRAPH_FULL_BLOCK 0xFF // All dots lit, from the character ROM
+
+// What the controller's CGRAM holds, to send only rows that change
+static uint8_t lcd_graphGlyphs[LCD_GRAPH_GLYPHS][LCD_GRAPH_GLYPH_ROWS];
+static uint8_t lcd_graphKnown = 0; // Bit per glyph whose content is known
+
+/**
+ * @brief Load a glyph, sending only the rows from its first to its last
+ * change, like lcd_refresh() does for a row of cells.
+ */
+static void lcd_graphSetGlyph(uint8_t code, const uint8_t rows[LCD_GRAPH_GLYPH_ROWS])
+{
+    int8_t first = -1;
+    int8_t last = -1;
+    uint8_t r;
+
+    for (r = 0; r < LCD_GRAPH_GLYPH_ROWS; r++) {
+        if (!(lcd_graphKnown & (1 << code)) || rows[r] != lcd_graphGlyphs[code][r]) {
+            if (first < 0) {
+                first = r;
+            }
+            last = r;
+        }
+    }
+
+    if (first < 0) {
+        return;
+    }
+
+    lcd_loadGlyph(code, first, &rows[first], last - first + 1);
+    memcpy(lcd_graphGlyphs[code], rows, LCD_GRAPH_GLYPH_ROWS);
+    lcd_graphKnown |= 1 << code;
+}
+
+/**
+ * @brief Nearest distance among the bins that fall into column column of
+ * columns, clamped to 0...range.
+ */
+static int lcd_graphNearest(const int *bins, uint8_t count, uint8_t column,
+                            uint8_t columns, int range)
+{
+    uint16_t i = (uint16_t)column * count / columns;
+    uint16_t end = (uint16_t)(column + 1) * count / columns;
+    int nearest = range;
+
+    for (; i < end; i++) {
+        if (bins[i] < nearest) {
+            nearest = bins[i];
+        }
+    }
+
+    return nearest < 0 ? 0 : nearest;
+}
+
+void lcd_graphBars(const int *bins, uint8_t count, int range)
+{
+    uint8_t rows[LCD_GRAPH_GLYPH_ROWS];
+    uint8_t x;
+    uint8_t y;
+    uint8_t k;
+
+    if (count < LCD_WIDTH || range <= 0) {
+        return;
+    }
+
+    // Glyph k lights the bottom k + 1 rows; unchanged glyphs cost nothing
+    for (k = 0; k < LCD_GRAPH_GLYPH_ROWS - 1; k++) {
+        for (y = 0; y < LCD_GRAPH_GLYPH_ROWS; y++) {
+            rows[y] = (y >= LCD_GRAPH_GLYPH_ROWS - 1 - k) ? 0x1F : 0x00;
+        }
+        lcd_graphSetGlyph(k, rows);
+    }
+
+    for (x = 0; x < LCD_WIDTH; x++) {
+        int nearest = lcd_graphNearest(bins, count, x, LCD_WIDTH, range);
+        int height = (range - nearest) * (LCD_HEIGHT * LCD_GRAPH_GLYPH_ROWS) / range;
+
+        // Fill each cell from the bottom row up
+        for (y = 0; y < LCD_HEIGHT; y++) {
+            int fill = height - (LCD_HEIGHT - 1 - y) * LCD_GRAPH_GLYPH_ROWS;
+
+            if (fill <= 0) {
+                lcd_bufPutc(x, y, ' ');
+            } else if (fill >= LCD_GRAPH_GLYPH_ROWS) {
+                lcd_bufPutc(x, y, LCD_GRAPH_FULL_BLOCK);
+            } else {
+                lcd_bufPutc(x, y, LCD_GRAPH_GLYPH_BASE + fill - 1);
+            }
+        }
+    }
+
+    lcd_refresh();
+}
+
+void lcd_graphStrip(uint8_t row, const int *bins, uint8_t count, int range)
+{
+    uint8_t glyphs[LCD_GRAPH_GLYPHS][LCD_GRAPH_GLYPH_ROWS];
+    uint8_t x0 = (LCD_WIDTH - LCD_GRAPH_GLYPHS) / 2;
+    uint8_t p;
+    uint8_t g;
+
+    if (row >= LCD_HEIGHT || count < LCD_GRAPH_STRIP_WIDTH || range <= 0) {
+        return;
+    }
+
+    memset(glyphs, 0, sizeof(glyphs));
+    for (p = 0; p < LCD_GRAPH_STRIP_WIDTH; p++) {
+        int nearest = lcd_graphNearest(bins, count, p, LCD_GRAPH_STRIP_WIDTH, range);
+
+        if (nearest < range) {
+            // Far at the top row, near at the bottom; bit 4 is the left dot
+            uint8_t y = LCD_GRAPH_GLYPH_ROWS - 1 - nearest * LCD_GRAPH_GLYPH_ROWS / range;
+
+            glyphs[p / 5][y] |= 0x10 >> (p % 5);
+        }
+    }
+
+    for (g = 0; g < LCD_GRAPH_GLYPHS; g++) {
+        lcd_graphSetGlyph(g, glyphs[g]);
+        lcd_bufPutc(x0 + g, row, LCD_GRAPH_GLYPH_BASE + g);
+    }
+
+    // Only sends anything the first time, later frames only change glyphs
+    lcd_refresh();
+}
+
+void lcd_graphInvalidate(void)
+{
+    lcd_graphKnown = 0;
+}
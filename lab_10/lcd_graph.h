@@ -0,0 +1,62 @@
+/*
+ * lcd_graph.h
+ *
+ * Scan data on the LCD, drawn with the controller's eight custom characters
+ * so a sweep can be watched without a laptop on the UART.
+ *
+ * lcd_graphBars() draws the bins as 20 bars over the whole display, nearer
+ * objects as taller bars, 32 pixels high. Partial cells use seven glyphs of
+ * 1 to 7 lit rows and full cells the ROM block, so the glyphs are loaded once
+ * and a new frame only sends the cells that changed.
+ *
+ * lcd_graphStrip() draws the bins as echoes on one row: eight glyphs side by
+ * side give 40 x 8 pixels, one dot per pixel column at the nearest distance in
+ * its bins, far at the top. The cells stay put; a new frame only rewrites the
+ * glyph rows that changed.
+ *
+ * Both views share the glyphs, only one can be on the display at a time. Bins
+ * at or past range count as nothing seen, so a sweep in progress can fill its
+ * unscanned bins with range:
+ *
+ *     for (i = 0; i < 90; i++) avgArray[i] = SCAN_RANGE;
+ *     for (i = 0; i < 90; i++) {
+ *         avgArray[i] = ...;
+ *         lcd_graphBars(avgArray, 90, SCAN_RANGE);
+ *     }
+ *
+ * Bin 0 is drawn on the left.
+ *
+ */
+
+#ifndef LCD_GRAPH_H_
+#define LCD_GRAPH_H_
+
+#include <stdint.h>
+
+#define LCD_GRAPH_GLYPHS 8 // Custom characters of the HD44780
+#define LCD_GRAPH_STRIP_WIDTH (LCD_GRAPH_GLYPHS * 5) // Pixel columns
+
+/**
+ * @brief Draw bins as bars over the whole display, into the framebuffer, then
+ * refresh it.
+ *
+ * @param bins distances, nearer is taller
+ * @param count number of bins, 20 or more
+ * @param range distance of an empty bar, must be above 0
+ */
+void lcd_graphBars(const int *bins, uint8_t count, int range);
+
+/**
+ * @brief Draw bins as echoes on one row, centered. Other rows are left alone.
+ *
+ * @param row 0 indexed row
+ * @param bins distances, nearer is lower
+ * @param count number of bins, 40 or more
+ * @param range distance at or past which nothing is drawn, must be above 0
+ */
+void lcd_graphStrip(uint8_t row, const int *bins, uint8_t count, int range);
+
+/// Forget what is in the custom characters, e.g. after lcd_init()
+void lcd_graphInvalidate(void);
+
+#endif /* LCD_GRAPH_H_ */
@@ -0,0 +1,164 @@
+/*
+ * lcd_scroll.c
+ *
+ * Banner scrolling with the HD44780 display shift and per-row marquees
+ * through the framebuffer. See lcd_scroll.h.
+ *
+ */
+
+#include <string.h>
+#include "lcd_scroll.h"
+#include "lcd.h"
+#include "Timer.h"
+
+typedef struct {
+    const char *text;   // NULL when the row is not scrolling
+    uint16_t length;
+    uint16_t offset;    // Cells the text has moved in from the right edge
+    uint16_t period;
+    uint32_t next;      // timer_getMillis() of the next step
+} lcd_scroll_row_t;
+
+static lcd_scroll_row_t lcd_scrollRows[LCD_HEIGHT];
+
+static uint16_t lcd_scrollBannerPeriod = 0; // 0 when no banner is running
+static uint32_t lcd_scrollBannerNext;
+
+/**
+ * @brief Write the visible window of a row's text into the framebuffer. Cell
+ * x shows character offset - LCD_WIDTH + x, blanks outside the text.
+ */
+static void lcd_scrollDraw(uint8_t row)
+{
+    lcd_scroll_row_t *r = &lcd_scrollRows[row];
+    uint8_t x;
+
+    for (x = 0; x < LCD_WIDTH; x++) {
+        int32_t i = (int32_t)r->offset - LCD_WIDTH + x;
+
+        lcd_bufPutc(x, row, (i >= 0 && i < r->length) ? r->text[i] : ' ');
+    }
+}
+
+static void lcd_scrollStopBanner(void)
+{
+    if (lcd_scrollBannerPeriod) {
+        lcd_scrollBannerPeriod = 0;
+        lcd_home(); // Shift back, DDRAM still holds the banner
+    }
+}
+
+void lcd_scrollStart(uint8_t row, const char *text, uint16_t periodMillis)
+{
+    lcd_scroll_row_t *r;
+
+    if (row >= LCD_HEIGHT || text == NULL) {
+        return;
+    }
+
+    lcd_scrollStopBanner();
+
+    r = &lcd_scrollRows[row];
+    r->text = text;
+    r->length = strlen(text);
+    r->offset = 0;
+    r->period = periodMillis ? periodMillis : 1;
+    r->next = timer_getMillis() + r->period;
+
+    lcd_scrollDraw(row);
+    lcd_refresh();
+}
+
+/**
+ * @brief Put up to 40 characters along one controller line, which is the ring
+ * of two rows the display shift turns.
+ */
+static void lcd_scrollLoadLine(uint8_t row, const char *text)
+{
+    uint8_t i;
+
+    for (i = 0; text != NULL && text[i] != '\0'; i++) {
+        lcd_bufPutc(i % LCD_WIDTH, row + 2 * (i / LCD_WIDTH), text[i]);
+    }
+}
+
+void lcd_scrollBanner(const char *line1, const char *line2, uint16_t periodMillis)
+{
+    lcd_scrollStopAll();
+
+    if (line1 == NULL) {
+        return;
+    }
+
+    // Longer than a DDRAM line would wrap onto itself, scroll rows instead
+    if (strlen(line1) > LCD_DDRAM_LINE ||
+        (line2 != NULL && strlen(line2) > LCD_DDRAM_LINE)) {
+        lcd_bufClear();
+        lcd_scrollStart(0, line1, periodMillis);
+        if (line2 != NULL) {
+            lcd_scrollStart(1, line2, periodMillis);
+        }
+        return;
+    }
+
+    // Loaded once; refresh homes the display and sends the changed cells
+    lcd_bufClear();
+    lcd_scrollLoadLine(0, line1);
+    lcd_scrollLoadLine(1, line2);
+    lcd_refresh();
+
+    lcd_scrollBannerPeriod = periodMillis ? periodMillis : 1;
+    lcd_scrollBannerNext = timer_getMillis() + lcd_scrollBannerPeriod;
+}
+
+void lcd_scrollStop(uint8_t row)
+{
+    if (row < LCD_HEIGHT) {
+        lcd_scrollRows[row].text = NULL;
+    }
+    lcd_scrollStopBanner();
+}
+
+void lcd_scrollStopAll(void)
+{
+    uint8_t row;
+
+    for (row = 0; row < LCD_HEIGHT; row++) {
+        lcd_scrollRows[row].text = NULL;
+    }
+    lcd_scrollStopBanner();
+}
+
+void lcd_scrollPoll(void)
+{
+    uint32_t now = timer_getMillis();
+    uint8_t changed = 0;
+    uint8_t row;
+
+    // A late poll takes one step, not a burst to catch up
+    if (lcd_scrollBannerPeriod && (int32_t)(now - lcd_scrollBannerNext) >= 0) {
+        lcd_scrollBannerNext = now + lcd_scrollBannerPeriod;
+        lcd_shiftDisplay(-1); // One 43 us command, DDRAM is not touched
+    }
+
+    for (row = 0; row < LCD_HEIGHT; row++) {
+        lcd_scroll_row_t *r = &lcd_scrollRows[row];
+
+        if (r->text == NULL || (int32_t)(now - r->next) < 0) {
+            continue;
+        }
+
+        r->next = now + r->period;
+        r->offset++;
+        if (r->offset >= r->length + LCD_WIDTH) {
+            r->offset = 0; // Gone off the left edge, come in again
+        }
+        lcd_scrollDraw(row);
+        changed = 1;
+    }
+
+    // All rows that stepped go out in one pass
+    if (changed) {
+        lcd_refresh();
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * lcd_scroll.h
+ *
+ * Scrolling text on the LCD without redrawing the whole screen each step.
+ *
+ * lcd_scrollBanner() loads one or two messages of up to 40 characters into
+ * the controller's DDRAM once, then every step is a single display shift
+ * command. The controller shifts all rows together and each of its 40
+ * character lines wraps around as a ring over two rows: the first message runs
+ * along rows 1 and 3, the second along rows 2 and 4. The banner owns the
+ * whole display until lcd_scrollStop().
+ *
+ * lcd_scrollStart() runs a marquee on a single row, leaving the others alone,
+ * for text of any length. Each step moves the text one cell in the
+ * framebuffer and lcd_refresh() sends only the cells that changed. Banners
+ * with a message longer than 40 characters fall back to this on rows 1 and 2.
+ *
+ * Steps are taken by lcd_scrollPoll() from the main loop, not from an
+ * interrupt, since the LCD is only ever written from one context:
+ *
+ *     lcd_scrollStart(0, "Scanning for the tallest object", 300);
+ *     while (1) {
+ *         lcd_scrollPoll();
+ *         ...
+ *     }
+ *
+ * Text is not copied, it has to stay in place while it scrolls.
+ *
+ */
+
+#ifndef LCD_SCROLL_H_
+#define LCD_SCROLL_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Scroll text right to left through one row. It enters at the right
+ * edge and starts over once it has left at the left edge.
+ *
+ * @param row 0 indexed row, stops a running banner
+ * @param text message to scroll, not copied
+ * @param periodMillis milliseconds per one cell step
+ */
+void lcd_scrollStart(uint8_t row, const char *text, uint16_t periodMillis);
+
+/**
+ * @brief Scroll the whole display with the controller's display shift. Stops
+ * any row marquees and replaces what is on the screen.
+ *
+ * @param line1 message for rows 1 and 3
+ * @param line2 message for rows 2 and 4, or NULL
+ * @param periodMillis milliseconds per one cell step
+ */
+void lcd_scrollBanner(const char *line1, const char *line2, uint16_t periodMillis);
+
+/**
+ * @brief Stop the marquee on a row, leaving its current text on screen.
+ * Stopping any row also stops a banner, which jumps back to its start.
+ *
+ * @param row 0 indexed row
+ */
+void lcd_scrollStop(uint8_t row);
+
+/// Stop every marquee and the banner
+void lcd_scrollStopAll(void);
+
+/// Take the steps that are due, call this often from the main loop
+void lcd_scrollPoll(void);
+
+#endif /* LCD_SCROLL_H_ */
@@ -7,12 +7,21 @@
 #include "movement.h"
 #include "uart.h"
 #include "open_interface.h"
+#include "clock.h"
+#include "profile.h"
+#include "power.h"
+#include "lcd_graph.h"
+#include "fmt.h"
+#include "telemetry.h"
 #include <math.h>
 
 #define _PART1 0
 #define _PART2 0
 #define _PART3 1
 #define _TEST 0
+#define _BINARY_TELEMETRY 1 //framed records for tools/telemetry_decode.cpp instead of text
+
+#define SCAN_GRAPH_RANGE 100 //cm, bins this far or further show as empty
 
 int calculate_distanceLOG(int adc_value)
 {
@@ -49,6 +58,8 @@ struct Object
 
 int main(void)
 {
+    clock_init(); // 80 MHz, before any driver works out its timing
+    profile_init();
     oi_t *o_int = oi_alloc();
     oi_init(o_int);
     timer_init();
@@ -58,6 +69,9 @@ int main(void)
     adc_init();
     button_init();
     init_button_interrupts();
+    uart_init();
+    uart_interrupt_init(); //telemetry is queued, the scan does not wait on PuTTY
+    power_init(); // after the drivers, sleep keeps their clocks running
 
     extern volatile int button_event;
     extern volatile int button_num;
@@ -98,8 +112,12 @@ int main(void)
     int objectCount = 0;
     struct Object objectList[13];
     bool objMaking = false;
-    char message[30] = "";
+    for (i = 0; i < 90; i++)
+    {
+        avgArray[i] = SCAN_GRAPH_RANGE; //nothing seen yet
+    }
     //180 Degree Scan
+    PROFILE_BEGIN(PROFILE_SCAN);
     for (i = 0; i < 180; i += 2)
     {
         int temp = 0;
@@ -121,8 +139,13 @@ int main(void)
         temp += distance;
 
         avgArray[arrayIdx] = temp / 3;
+#if _BINARY_TELEMETRY
+        telem_sendScan(i, avgArray[arrayIdx], irVal);
+#endif
         arrayIdx++;
+        lcd_graphBars(avgArray, 90, SCAN_GRAPH_RANGE); //live view, sends only changed cells
     }
+    PROFILE_END(PROFILE_SCAN);
 
     for (i = 0; i < 90; i++)
     {
@@ -175,12 +198,24 @@ for (objectListIdx = 0; objectListIdx < objectCount; objectListIdx++) //Might be
             * tan((objectList[objectListIdx].angularWidth * (M_PI / 180)) / 2);
     timer_waitMillis(500);
 
-    sprintf(message, "Object @ Angle:%d Distance:%d LWidth:%.2f\n",
-            objectList[objectListIdx].middlePoint,
-            objectList[objectListIdx].distance,
-            objectList[objectListIdx].linearWidth);
-
-    uart_sendStr(message); //debugging + send to PuTTY
+#if _BINARY_TELEMETRY
+    telem_sendObject(objectListIdx,
+                     objectList[objectListIdx].startAngle,
+                     objectList[objectListIdx].endAngle,
+                     objectList[objectListIdx].middlePoint,
+                     objectList[objectListIdx].distance,
+                     (uint16_t) ((float) objectList[objectListIdx].linearWidth * 10.0f + 0.5f)); //cm to mm
+#else
+    fmt_t report; //straight to the UART, no buffer to overflow
+    fmt_sink(&report, uart_sendChar);
+    fmt_str(&report, "Object @ Angle:");
+    fmt_int(&report, objectList[objectListIdx].middlePoint, 0);
+    fmt_str(&report, " Distance:");
+    fmt_int(&report, objectList[objectListIdx].distance, 0);
+    fmt_str(&report, " LWidth:");
+    fmt_float(&report, objectList[objectListIdx].linearWidth, 2, 0);
+    fmt_char(&report, '\n'); //debugging + send to PuTTY
+#endif
     //Turn angular width into linear width
 
     if (objectList[objectListIdx].linearWidth
@@ -195,15 +230,23 @@ servo_move(abs(180-objectList[smallestWidthIdx].middlePoint)); //Point towards t
 
 if (objectList[smallestWidthIdx].startAngle < 90) //If smallest object is within the right bounded area of the roomba
 {
-    turn_clockwise(o_int, (90 - objectList[smallestWidthIdx].startAngle - 8)); //Turn clockwise the difference between 90
-    move_forward(o_int, (objectList[smallestWidthIdx].distance - 13));
+    turn_clockwise(o_int, (90 - objectList[smallestWidthIdx].startAngle)); //Turn clockwise the difference between 90
+    move_forward(o_int, objectList[smallestWidthIdx].distance);
 }
 else if (objectList[smallestWidthIdx].startAngle > 90) //If smallest object is within the left bounded area of the roomba
 {
     turn_counterclockwise(o_int,
-                          (objectList[smallestWidthIdx].startAngle - 90 - 8));
-    move_forward(o_int, (objectList[smallestWidthIdx].distance - 13));
+                          (objectList[smallestWidthIdx].startAngle - 90));
+    move_forward(o_int, objectList[smallestWidthIdx].distance);
 }
+#if _BINARY_TELEMETRY
+oi_pose_t pose; //where the robot ended up
+oi_getPose(o_int, &pose);
+telem_sendPose(&pose);
+telem_sendSensors(o_int);
+#endif
 #endif
+profile_dump(); //timing of the run to PuTTY, see tools/profile_report.py
+power_dump();
 oi_free(o_int);
 }
@@ -1,76 +1,345 @@
 #include "movement.h"
+#include <math.h>
+
+#ifndef MOVEMENT_HOST
+#include "open_interface.h"
+#include "Timer.h"
+#else
+// Supplied by the simulated robot in tools/motion_sim.c
+void oi_setWheels(int16_t right_wheel, int16_t left_wheel);
+void oi_update(oi_t *self);
+unsigned int timer_getMillis(void);
+#endif
 
 /*
  * @Author Winson Vetsavong Miles Nichols
  * @Date 9/12/2024
  */
 
-void move_forward(oi_t *sensor, int centimeters)
+typedef enum
+{
+    MOTION_DRIVE,
+    MOTION_TURN
+} motion_kind_t;
+
+typedef struct
 {
-    double sum = 0;
-    double milimeters = centimeters * 10;
+    motion_kind_t kind;
+    int32_t target; // microns for drives, millidegrees for turns, signed
+} motion_t;
+
+// Queued moves, motion_queue[motion_head] is the one running
+static motion_t motion_queue[MOTION_QUEUE_SIZE];
+static uint8_t motion_head = 0;
+static uint8_t motion_count = 0;
+
+static uint8_t motion_running = 0; // wheels turned on for the head move
+static int32_t motion_startLeft;   // encoder totals when the head move started
+static int32_t motion_startRight;
+
+// Limits, see motion_setProfile()
+static float motion_maxSpeed = MOTION_MAX_SPEED;
+static float motion_maxTurnSpeed = MOTION_MAX_TURN_SPEED;
+static float motion_accel = MOTION_ACCEL;
 
-    oi_setWheels(100, 100);
+// Heading PID, see motion_setHeadingGains()
+static float motion_kp = MOTION_KP;
+static float motion_ki = MOTION_KI;
+static float motion_kd = MOTION_KD;
 
-    while (sum < milimeters)
+// Profile and PID state of the head move
+static float motion_speed;            // mm/s, always positive
+static unsigned int motion_lastMillis;
+static float motion_integral;
+static int32_t motion_lastError;
+static int16_t motion_lastRight;      // last wheel command, to skip repeats
+static int16_t motion_lastLeft;
+
+// Wheel travel per millidegree of a turn in place: 235 mm wheel base,
+// pi * 117.5 / 180000 mm
+#define MOTION_MM_PER_MDEG 0.0020508f
+
+// Longest time step the profile trusts, in case polls stall
+#define MOTION_MAX_DT 0.1f
+
+static int motion_push(motion_kind_t kind, int32_t target)
+{
+    motion_t *move;
+
+    if (motion_count == MOTION_QUEUE_SIZE)
     {
-        oi_update(sensor);
-        sum += sensor->distance;
+        return 0;
+    }
 
+    move = &motion_queue[(motion_head + motion_count) % MOTION_QUEUE_SIZE];
+    move->kind = kind;
+    move->target = target;
+    motion_count++;
+    return 1;
+}
+
+static void motion_setWheels(int16_t right, int16_t left)
+{
+    if (right != motion_lastRight || left != motion_lastLeft)
+    {
+        oi_setWheels(right, left);
+        motion_lastRight = right;
+        motion_lastLeft = left;
     }
+}
+
+static void motion_begin(oi_t *sensor)
+{
+    motion_startLeft = sensor->odometry.leftTicks;
+    motion_startRight = sensor->odometry.rightTicks;
+    motion_running = 1;
 
-    oi_setWheels(0, 0); // stop
-    return;
+    motion_lastMillis = timer_getMillis();
+    motion_integral = 0;
+    motion_lastError = 0;
 }
 
-void move_backward(oi_t *sensor, int centimeters)
+// Distance covered since the head move started, microns
+static int32_t motion_distance(oi_t *sensor)
+{
+    int32_t left = sensor->odometry.leftTicks - motion_startLeft;
+    int32_t right = sensor->odometry.rightTicks - motion_startRight;
+
+    return (int32_t)(((int64_t)(left + right) * OI_MICRONS_PER_TICK_Q16) >> 17);
+}
+
+// Angle turned since the head move started, millidegrees counterclockwise
+static int32_t motion_angle(oi_t *sensor)
+{
+    int32_t left = sensor->odometry.leftTicks - motion_startLeft;
+    int32_t right = sensor->odometry.rightTicks - motion_startRight;
+
+    return (int32_t)(((int64_t)(right - left) * OI_MILLIDEGREES_PER_TICK_Q16) >> 16);
+}
+
+// Next speed of the trapezoid: accelerate up to the limit, but never faster
+// than what can still be braked to 0 over the remaining distance
+static float motion_profile(float remainingMm, float limit, float dt)
 {
-    int millimeters = centimeters * 10;
-    oi_setWheels(-100, -100);
-    int sum = millimeters;
+    float speed = motion_speed + motion_accel * dt;
+    float braking = sqrtf(2.0f * motion_accel * remainingMm);
 
-    while (sum > 0)
+    if (speed > limit)
     {
-        oi_update(sensor);
-        sum += sensor->distance;
+        speed = limit;
     }
-    oi_setWheels(0, 0); // stop
-    return;
-
+    if (speed > braking)
+    {
+        speed = braking;
+    }
+    if (speed < MOTION_MIN_SPEED)
+    {
+        speed = MOTION_MIN_SPEED;
+    }
+    return speed;
 }
 
-void turn_clockwise(oi_t *sensor, double desiredDegrees)
+// Wheel correction that steers a straight move back to its starting heading,
+// at most MOTION_MAX_CORRECTION either way
+static float motion_headingPid(int32_t error, float dt)
 {
-    double degrees = desiredDegrees * -1;
-    double sum = 0.0;
+    float derivative = 0;
+    float integral = motion_integral + error * dt;
+    float output;
 
-    oi_setWheels(-100, 100);
+    if (dt > 0)
+    {
+        derivative = (error - motion_lastError) / dt;
+    }
+    motion_lastError = error;
+
+    output = motion_kp * error + motion_ki * integral + motion_kd * derivative;
 
-    while (sum > degrees)
+    // Anti-windup: while the output is clipped, only let the integral shrink
+    if (output > MOTION_MAX_CORRECTION)
     {
-        oi_update(sensor);
-        sum += sensor->angle;
+        output = MOTION_MAX_CORRECTION;
+        if (error < 0)
+        {
+            motion_integral = integral;
+        }
     }
+    else if (output < -MOTION_MAX_CORRECTION)
+    {
+        output = -MOTION_MAX_CORRECTION;
+        if (error > 0)
+        {
+            motion_integral = integral;
+        }
+    }
+    else
+    {
+        motion_integral = integral;
+    }
+    return output;
+}
 
-    oi_setWheels(0, 0); // stop
-    return;
+void motion_setProfile(int16_t maxSpeed, int16_t maxTurnSpeed, int16_t accel)
+{
+    motion_maxSpeed = maxSpeed > 500 ? 500 : maxSpeed;
+    motion_maxTurnSpeed = maxTurnSpeed > 500 ? 500 : maxTurnSpeed;
+    motion_accel = accel;
+}
 
+void motion_setHeadingGains(float kp, float ki, float kd)
+{
+    motion_kp = kp;
+    motion_ki = ki;
+    motion_kd = kd;
 }
 
-void turn_counterclockwise(oi_t *sensor, double desiredDegrees)
+int motion_start_forward(int centimeters)
 {
-    double degrees = desiredDegrees;
-    double sum = 0.0;
+    return motion_push(MOTION_DRIVE, centimeters * 10000L);
+}
+
+int motion_start_backward(int centimeters)
+{
+    return motion_push(MOTION_DRIVE, centimeters * -10000L);
+}
+
+int motion_start_turn_clockwise(double degrees)
+{
+    return motion_push(MOTION_TURN, (int32_t)(degrees * -1000.0f));
+}
 
-        oi_setWheels(100, -100);
+int motion_start_turn_counterclockwise(double degrees)
+{
+    return motion_push(MOTION_TURN, (int32_t)(degrees * 1000.0f));
+}
+
+void motion_poll(oi_t *sensor)
+{
+    while (motion_count > 0)
+    {
+        motion_t *move = &motion_queue[motion_head];
+        int32_t angle;
+        int32_t remaining;
+        float remainingMm;
+        float dt;
+        int16_t direction = move->target < 0 ? -1 : 1;
+        unsigned int now;
+
+        if (!motion_running)
+        {
+            motion_begin(sensor);
+        }
+
+        angle = motion_angle(sensor);
+        if (move->kind == MOTION_DRIVE)
+        {
+            remaining = move->target - motion_distance(sensor);
+            remainingMm = direction * remaining * 0.001f;
+        }
+        else
+        {
+            remaining = move->target - angle;
+            remainingMm = direction * remaining * MOTION_MM_PER_MDEG;
+        }
+
+        if (remainingMm > 0)
+        {
+            now = timer_getMillis();
+            dt = (now - motion_lastMillis) * 0.001f;
+            motion_lastMillis = now;
+            if (dt > MOTION_MAX_DT)
+            {
+                dt = MOTION_MAX_DT;
+            }
+
+            if (move->kind == MOTION_DRIVE)
+            {
+                float correction;
+                float speed;
+
+                motion_speed = motion_profile(remainingMm, motion_maxSpeed, dt);
+
+                // Any turn during a straight move is heading error. Slowing the
+                // right wheel turns clockwise whichever way the robot drives.
+                correction = motion_headingPid(angle, dt);
+
+                // Make room for the correction under the OI's wheel limit by
+                // driving slower, so both wheels keep it
+                speed = motion_speed;
+                if (speed + fabsf(correction) > MOTION_WHEEL_LIMIT)
+                {
+                    speed = MOTION_WHEEL_LIMIT - fabsf(correction);
+                }
+                motion_setWheels((int16_t)(direction * speed - correction),
+                                 (int16_t)(direction * speed + correction));
+            }
+            else
+            {
+                motion_speed = motion_profile(remainingMm, motion_maxTurnSpeed, dt);
+                motion_setWheels((int16_t)(direction * motion_speed),
+                                 (int16_t)(-direction * motion_speed));
+            }
+            return; // still going
+        }
 
-        while (sum < degrees)
+        // Done, go straight on to the next move without stopping
+        motion_running = 0;
+        motion_head = (motion_head + 1) % MOTION_QUEUE_SIZE;
+        motion_count--;
+        if (motion_count == 0)
         {
-            oi_update(sensor);
-            sum += sensor->angle;
+            motion_speed = 0;
+            motion_setWheels(0, 0); // stop
         }
+    }
+}
+
+int motion_is_done(void)
+{
+    return motion_count == 0;
+}
+
+void motion_abort(void)
+{
+    motion_count = 0;
+    motion_running = 0;
+    motion_speed = 0;
+    oi_setWheels(0, 0); // stop, even if the wheels were set elsewhere
+    motion_lastRight = 0;
+    motion_lastLeft = 0;
+}
 
-        oi_setWheels(0, 0); // stop
-        return;
+// Run the queue until it is empty
+static void motion_wait(oi_t *sensor)
+{
+    motion_poll(sensor);
+    while (!motion_is_done())
+    {
+        oi_update(sensor);
+        motion_poll(sensor);
+    }
+}
 
+void move_forward(oi_t *sensor, int centimeters)
+{
+    motion_start_forward(centimeters);
+    motion_wait(sensor);
+}
+
+void move_backward(oi_t *sensor, int centimeters)
+{
+    motion_start_backward(centimeters);
+    motion_wait(sensor);
+}
+
+void turn_clockwise(oi_t *sensor, double desiredDegrees)
+{
+    motion_start_turn_clockwise(desiredDegrees);
+    motion_wait(sensor);
+}
+
+void turn_counterclockwise(oi_t *sensor, double desiredDegrees)
+{
+    motion_start_turn_counterclockwise(desiredDegrees);
+    motion_wait(sensor);
 }
@@ -1,7 +1,26 @@
 #ifndef MOVEMENT_H_
 #define MOVEMENT_H_
 
-#include "open_interface.h"
+#include "oi_sensors.h"
+
+// Most moves that can wait in the motion queue, including the one running
+#define MOTION_QUEUE_SIZE 8
+
+// Default velocity profile, see motion_setProfile()
+#define MOTION_MAX_SPEED 300      // mm/s, straight moves
+#define MOTION_MAX_TURN_SPEED 150 // mm/s per wheel, turns
+#define MOTION_ACCEL 400          // mm/s^2, speeding up and slowing down
+#define MOTION_MIN_SPEED 20       // mm/s, crawl speed at the very end of a move
+#define MOTION_WHEEL_LIMIT 500    // mm/s, most the OI takes for a wheel
+#define MOTION_MAX_CORRECTION 100 // mm/s, most the heading PID adds or takes off
+
+// Default heading PID for straight moves, error in millidegrees, output in
+// mm/s taken off one wheel and added to the other
+#define MOTION_KP 0.02f
+#define MOTION_KI 0.005f
+#define MOTION_KD 0.0f
+
+// Blocking moves, each returns once the robot has stopped
 
 void move_forward(oi_t *sensor, int centimeters);
 
@@ -11,6 +30,47 @@ void turn_clockwise(oi_t *sensor, double degrees);
 
 void turn_counterclockwise(oi_t *sensor, double degrees);
 
+// Non-blocking moves. motion_start_*() queue a move and return at once, it
+// starts when the moves queued before it are done. Returns 0 if the queue is
+// full. Call motion_poll() after every sensor update (oi_update() or a new
+// frame from oi_streamUpdate()) to drive the queue. tools/motion_sim.c runs
+// them against a simulated robot.
+//
+//     motion_start_turn_clockwise(45);
+//     motion_start_forward(50);
+//     while (!motion_is_done()) {
+//         if (oi_streamUpdate(sensor)) {
+//             motion_poll(sensor);
+//         }
+//         ... scan, send telemetry ...
+//     }
+
+int motion_start_forward(int centimeters);
+
+int motion_start_backward(int centimeters);
+
+int motion_start_turn_clockwise(double degrees);
+
+int motion_start_turn_counterclockwise(double degrees);
+
+// Progress is measured from the encoder totals, so calling this more than once
+// per update, or skipping updates, is fine. Do not reset the pose mid move.
+void motion_poll(oi_t *sensor);
+
+// Every move ramps up to its top speed at accel and slows down again so it
+// reaches 0 right at the target (trapezoidal profile). Takes effect on the next
+// move. maxSpeed is capped at 500 mm/s, the robot's limit.
+void motion_setProfile(int16_t maxSpeed, int16_t maxTurnSpeed, int16_t accel);
+
+// Gains of the loop that keeps straight moves on their starting heading
+void motion_setHeadingGains(float kp, float ki, float kd);
+
+// 1 once every queued move has finished
+int motion_is_done(void);
+
+// Stop the wheels and drop every queued move, e.g. on a bump
+void motion_abort(void);
+
 
 
 #endif /* MOVEMENT_H_ */
@@ -0,0 +1,86 @@
+/*
+ * oi_odometry.c
+ *
+ * Encoder odometry with Q16 constants, see oi_odometry.h.
+ *
+ */
+
+#include <math.h>
+#include "oi_odometry.h"
+
+#define OI_RADIANS_PER_MILLIDEGREE (3.14159265f / 180000.0f)
+
+/**
+ * @brief Convert the encoder change since the previous call of oi_update into
+ * distanceMicrons/angleMillidegrees using only integer math, and advance the
+ * pose. The Cortex-M4F FPU is single precision, so the old double formulas
+ * were software emulated.
+ *
+ * distance = (left + right) / 2 * 72pi / 508.8 mm
+ * angle    = (right - left) * 72pi / 508.8 / 235 rad
+ *          = (right - left) * 72 * 180 / (508.8 * 235) deg (pi cancels)
+ *
+ * @param self Sensor data pointer
+ */
+void oi_odometryUpdate(oi_t *self)
+{
+    oi_odometry_t *odo = &self->odometry;
+    int32_t heading;
+    float midHeading;
+
+    // ignore the first run, such that we do not have prevLeft or right=0, this
+    // would give a very large distance moved. Gets processed during oi_init()
+    if (!odo->primed) {
+        odo->prevLeft = self->leftEncoderCount;
+        odo->prevRight = self->rightEncoderCount;
+        odo->primed = 1;
+    }
+
+    // int16_t subtraction handles the counters wrapping around
+    int16_t leftEncoderDiff = self->leftEncoderCount - odo->prevLeft;
+    int16_t rightEncoderDiff = self->rightEncoderCount - odo->prevRight;
+    odo->prevLeft = self->leftEncoderCount;
+    odo->prevRight = self->rightEncoderCount;
+    odo->leftTicks += leftEncoderDiff;
+    odo->rightTicks += rightEncoderDiff;
+
+    // Average of both wheels: the sum of the ticks, halved by the extra shift
+    self->distanceMicrons = (int32_t)(((int64_t)(leftEncoderDiff + rightEncoderDiff)
+                                       * OI_MICRONS_PER_TICK_Q16) >> 17);
+    self->angleMillidegrees = (int32_t)(((int64_t)(rightEncoderDiff - leftEncoderDiff)
+                                         * OI_MILLIDEGREES_PER_TICK_Q16) >> 16);
+
+    // Heading comes from the tick totals, so rounding never accumulates
+    heading = odo->headingOffset +
+              (int32_t)(((int64_t)(odo->rightTicks - odo->leftTicks)
+                         * OI_MILLIDEGREES_PER_TICK_Q16) >> 16);
+
+    // Move along the average of the old and new heading
+    midHeading = (self->pose.heading + heading) * (0.5f * OI_RADIANS_PER_MILLIDEGREE);
+    self->pose.x += (int32_t)(self->distanceMicrons * cosf(midHeading));
+    self->pose.y += (int32_t)(self->distanceMicrons * sinf(midHeading));
+    self->pose.heading = heading;
+
+#if OI_DOUBLE_ODOMETRY
+    self->distance = self->distanceMicrons * 0.001;
+    self->angle = self->angleMillidegrees * 0.001;
+#endif
+}
+
+/// Copy the current pose
+void oi_getPose(const oi_t *self, oi_pose_t *pose)
+{
+    *pose = self->pose;
+}
+
+/// Restart dead reckoning from the given pose
+void oi_resetPose(oi_t *self, int32_t x, int32_t y, int32_t heading)
+{
+    self->odometry.leftTicks = 0;
+    self->odometry.rightTicks = 0;
+    self->odometry.headingOffset = heading;
+
+    self->pose.x = x;
+    self->pose.y = y;
+    self->pose.heading = heading;
+}
@@ -0,0 +1,34 @@
+/*
+ * oi_odometry.h
+ *
+ * Dead reckoning from the Create's wheel encoders in integer math: the
+ * distance and angle moved since the previous sensor update, and a pose
+ * integrated over them. Nothing here touches the hardware;
+ * tools/odometry_bench.c checks the results against the double formulas they
+ * replaced and compares the cost of both on the host.
+ *
+ */
+
+#ifndef OI_ODOMETRY_H_
+#define OI_ODOMETRY_H_
+
+#include "oi_sensors.h"
+
+/// \brief Fill in distanceMicrons/angleMillidegrees from the change in the
+/// encoder counts and advance the pose. Called by the sensor updates once both
+/// encoder packets have been decoded; the first call only takes the counts.
+void oi_odometryUpdate(oi_t *self);
+
+/// \brief Copy the dead reckoning pose out of self
+/// The pose is integrated from the encoder counts on every sensor update, so
+/// callers no longer need to sum distance/angle themselves.
+void oi_getPose(const oi_t *self, oi_pose_t *pose);
+
+/// \brief Set the current pose, e.g. oi_resetPose(self, 0, 0, 0) makes the
+/// current position the origin facing along +x
+/// \param x position in um
+/// \param y position in um
+/// \param heading in millidegrees, counter-clockwise positive
+void oi_resetPose(oi_t *self, int32_t x, int32_t y, int32_t heading);
+
+#endif /* OI_ODOMETRY_H_ */
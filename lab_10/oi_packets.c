@@ -0,0 +1,370 @@
+/*
+ * oi_packets.c
+ *
+ * Create 2 sensor packet table and the generic decoder that walks it.
+ * Packet layout from the iRobot Create 2 Open Interface specification.
+ *
+ */
+
+#include "oi_packets.h"
+
+// Group id that may appear inside a stream frame
+#define OI_GROUP100_ID 100
+
+// One store function per destination field of oi_t
+#define OI_STORE(field) \
+    static void oi_store_##field(oi_t *self, int32_t value) { self->field = value; }
+
+OI_STORE(wheelDropLeft)
+OI_STORE(wheelDropRight)
+OI_STORE(bumpLeft)
+OI_STORE(bumpRight)
+OI_STORE(wallSensor)
+OI_STORE(cliffLeft)
+OI_STORE(cliffFrontLeft)
+OI_STORE(cliffFrontRight)
+OI_STORE(cliffRight)
+OI_STORE(virtualWall)
+OI_STORE(overcurrentLeftWheel)
+OI_STORE(overcurrentRightWheel)
+OI_STORE(overcurrentMainBrush)
+OI_STORE(overcurrentSideBrush)
+OI_STORE(dirtDetect)
+OI_STORE(infraredCharOmni)
+OI_STORE(buttonClock)
+OI_STORE(buttonSchedule)
+OI_STORE(buttonDay)
+OI_STORE(buttonHour)
+OI_STORE(buttonMinute)
+OI_STORE(buttonDock)
+OI_STORE(buttonSpot)
+OI_STORE(buttonClean)
+OI_STORE(chargingState)
+OI_STORE(batteryVoltage)
+OI_STORE(batteryCurrent)
+OI_STORE(batteryTemperature)
+OI_STORE(batteryCharge)
+OI_STORE(batteryCapacity)
+OI_STORE(wallSignal)
+OI_STORE(cliffLeftSignal)
+OI_STORE(cliffFrontLeftSignal)
+OI_STORE(cliffFrontRightSignal)
+OI_STORE(cliffRightSignal)
+OI_STORE(chargingSourcesAvailable)
+OI_STORE(oiMode)
+OI_STORE(songNumber)
+OI_STORE(songPlaying)
+OI_STORE(numberOfStreamPackets)
+OI_STORE(requestedVelocity)
+OI_STORE(requestedRadius)
+OI_STORE(requestedRightVelocity)
+OI_STORE(requestedLeftVelocity)
+OI_STORE(leftEncoderCount)
+OI_STORE(rightEncoderCount)
+OI_STORE(lightBumperRight)
+OI_STORE(lightBumperFrontRight)
+OI_STORE(lightBumperCenterRight)
+OI_STORE(lightBumperCenterLeft)
+OI_STORE(lightBumperFrontLeft)
+OI_STORE(lightBumperLeft)
+OI_STORE(lightBumpLeftSignal)
+OI_STORE(lightBumpFrontLeftSignal)
+OI_STORE(lightBumpCenterLeftSignal)
+OI_STORE(lightBumpCenterRightSignal)
+OI_STORE(lightBumpFrontRightSignal)
+OI_STORE(lightBumpRightSignal)
+OI_STORE(infraredCharLeft)
+OI_STORE(infraredCharRight)
+OI_STORE(leftMotorCurrent)
+OI_STORE(rightMotorCurrent)
+OI_STORE(mainBrushMotorCurrent)
+OI_STORE(sideBrushMotorCurrent)
+OI_STORE(stasis)
+
+#define OI_VALUE(field)         { 0, oi_store_##field }
+#define OI_FLAG(mask, field)    { mask, oi_store_##field }
+
+// Packets that split into several flags
+static const oi_field_t oi_bumpFields[] = {
+    OI_FLAG(0x08, wheelDropLeft),
+    OI_FLAG(0x04, wheelDropRight),
+    OI_FLAG(0x02, bumpLeft),
+    OI_FLAG(0x01, bumpRight)
+};
+
+static const oi_field_t oi_overcurrentFields[] = {
+    OI_FLAG(0x10, overcurrentLeftWheel),
+    OI_FLAG(0x08, overcurrentRightWheel),
+    OI_FLAG(0x04, overcurrentMainBrush),
+    OI_FLAG(0x01, overcurrentSideBrush)
+};
+
+static const oi_field_t oi_buttonFields[] = {
+    OI_FLAG(0x80, buttonClock),
+    OI_FLAG(0x40, buttonSchedule),
+    OI_FLAG(0x20, buttonDay),
+    OI_FLAG(0x10, buttonHour),
+    OI_FLAG(0x08, buttonMinute),
+    OI_FLAG(0x04, buttonDock),
+    OI_FLAG(0x02, buttonSpot),
+    OI_FLAG(0x01, buttonClean)
+};
+
+static const oi_field_t oi_lightBumperFields[] = {
+    OI_FLAG(0x20, lightBumperRight),
+    OI_FLAG(0x10, lightBumperFrontRight),
+    OI_FLAG(0x08, lightBumperCenterRight),
+    OI_FLAG(0x04, lightBumperCenterLeft),
+    OI_FLAG(0x02, lightBumperFrontLeft),
+    OI_FLAG(0x01, lightBumperLeft)
+};
+
+// Packets that map to a single field
+static const oi_field_t oi_wallField[] = { OI_VALUE(wallSensor) };
+static const oi_field_t oi_cliffLeftField[] = { OI_VALUE(cliffLeft) };
+static const oi_field_t oi_cliffFrontLeftField[] = { OI_VALUE(cliffFrontLeft) };
+static const oi_field_t oi_cliffFrontRightField[] = { OI_VALUE(cliffFrontRight) };
+static const oi_field_t oi_cliffRightField[] = { OI_VALUE(cliffRight) };
+static const oi_field_t oi_virtualWallField[] = { OI_VALUE(virtualWall) };
+static const oi_field_t oi_dirtDetectField[] = { OI_VALUE(dirtDetect) };
+static const oi_field_t oi_irOmniField[] = { OI_VALUE(infraredCharOmni) };
+static const oi_field_t oi_chargingStateField[] = { OI_VALUE(chargingState) };
+static const oi_field_t oi_voltageField[] = { OI_VALUE(batteryVoltage) };
+static const oi_field_t oi_currentField[] = { OI_VALUE(batteryCurrent) };
+static const oi_field_t oi_temperatureField[] = { OI_VALUE(batteryTemperature) };
+static const oi_field_t oi_chargeField[] = { OI_VALUE(batteryCharge) };
+static const oi_field_t oi_capacityField[] = { OI_VALUE(batteryCapacity) };
+static const oi_field_t oi_wallSignalField[] = { OI_VALUE(wallSignal) };
+static const oi_field_t oi_cliffLeftSignalField[] = { OI_VALUE(cliffLeftSignal) };
+static const oi_field_t oi_cliffFrontLeftSignalField[] = { OI_VALUE(cliffFrontLeftSignal) };
+static const oi_field_t oi_cliffFrontRightSignalField[] = { OI_VALUE(cliffFrontRightSignal) };
+static const oi_field_t oi_cliffRightSignalField[] = { OI_VALUE(cliffRightSignal) };
+static const oi_field_t oi_chargingSourcesField[] = { OI_VALUE(chargingSourcesAvailable) };
+static const oi_field_t oi_oiModeField[] = { OI_VALUE(oiMode) };
+static const oi_field_t oi_songNumberField[] = { OI_VALUE(songNumber) };
+static const oi_field_t oi_songPlayingField[] = { OI_VALUE(songPlaying) };
+static const oi_field_t oi_streamPacketsField[] = { OI_VALUE(numberOfStreamPackets) };
+static const oi_field_t oi_velocityField[] = { OI_VALUE(requestedVelocity) };
+static const oi_field_t oi_radiusField[] = { OI_VALUE(requestedRadius) };
+static const oi_field_t oi_rightVelocityField[] = { OI_VALUE(requestedRightVelocity) };
+static const oi_field_t oi_leftVelocityField[] = { OI_VALUE(requestedLeftVelocity) };
+static const oi_field_t oi_leftEncoderField[] = { OI_VALUE(leftEncoderCount) };
+static const oi_field_t oi_rightEncoderField[] = { OI_VALUE(rightEncoderCount) };
+static const oi_field_t oi_lightBumpLeftField[] = { OI_VALUE(lightBumpLeftSignal) };
+static const oi_field_t oi_lightBumpFrontLeftField[] = { OI_VALUE(lightBumpFrontLeftSignal) };
+static const oi_field_t oi_lightBumpCenterLeftField[] = { OI_VALUE(lightBumpCenterLeftSignal) };
+static const oi_field_t oi_lightBumpCenterRightField[] = { OI_VALUE(lightBumpCenterRightSignal) };
+static const oi_field_t oi_lightBumpFrontRightField[] = { OI_VALUE(lightBumpFrontRightSignal) };
+static const oi_field_t oi_lightBumpRightField[] = { OI_VALUE(lightBumpRightSignal) };
+static const oi_field_t oi_irLeftField[] = { OI_VALUE(infraredCharLeft) };
+static const oi_field_t oi_irRightField[] = { OI_VALUE(infraredCharRight) };
+static const oi_field_t oi_leftMotorCurrentField[] = { OI_VALUE(leftMotorCurrent) };
+static const oi_field_t oi_rightMotorCurrentField[] = { OI_VALUE(rightMotorCurrent) };
+static const oi_field_t oi_mainBrushCurrentField[] = { OI_VALUE(mainBrushMotorCurrent) };
+static const oi_field_t oi_sideBrushCurrentField[] = { OI_VALUE(sideBrushMotorCurrent) };
+static const oi_field_t oi_stasisField[] = { OI_VALUE(stasis) };
+
+#define OI_PACKET(id, offset, width, flags, fields) \
+    { id, offset, width, flags, sizeof(fields) / sizeof(fields[0]), fields }
+#define OI_IGNORED(id, offset, width) { id, offset, width, 0, 0, 0 }
+#define OI_GROUP(id) { id, 0, 0, 0, 0, 0 }
+
+// Indexed by packet id
+static const oi_packet_t oi_packetTable[OI_PACKET_STASIS + 1] = {
+    OI_GROUP(0), OI_GROUP(1), OI_GROUP(2), OI_GROUP(3),
+    OI_GROUP(4), OI_GROUP(5), OI_GROUP(6),
+    OI_PACKET(OI_PACKET_BUMPS_WHEELDROPS,  0, 1, 0, oi_bumpFields),
+    OI_PACKET(OI_PACKET_WALL,              1, 1, 0, oi_wallField),
+    OI_PACKET(OI_PACKET_CLIFF_LEFT,        2, 1, 0, oi_cliffLeftField),
+    OI_PACKET(OI_PACKET_CLIFF_FRONT_LEFT,  3, 1, 0, oi_cliffFrontLeftField),
+    OI_PACKET(OI_PACKET_CLIFF_FRONT_RIGHT, 4, 1, 0, oi_cliffFrontRightField),
+    OI_PACKET(OI_PACKET_CLIFF_RIGHT,       5, 1, 0, oi_cliffRightField),
+    OI_PACKET(OI_PACKET_VIRTUAL_WALL,      6, 1, 0, oi_virtualWallField),
+    OI_PACKET(OI_PACKET_OVERCURRENTS,      7, 1, 0, oi_overcurrentFields),
+    OI_PACKET(OI_PACKET_DIRT_DETECT,       8, 1, 0, oi_dirtDetectField),
+    OI_IGNORED(16,                         9, 1),
+    OI_PACKET(OI_PACKET_IR_OMNI,          10, 1, 0, oi_irOmniField),
+    OI_PACKET(OI_PACKET_BUTTONS,          11, 1, 0, oi_buttonFields),
+    OI_IGNORED(19,                        12, 2), // distance, see encoders
+    OI_IGNORED(20,                        14, 2), // angle, see encoders
+    OI_PACKET(OI_PACKET_CHARGING_STATE,   16, 1, 0, oi_chargingStateField),
+    OI_PACKET(OI_PACKET_VOLTAGE,          17, 2, 0, oi_voltageField),
+    OI_PACKET(OI_PACKET_CURRENT,          19, 2, OI_PACKET_SIGNED, oi_currentField),
+    OI_PACKET(OI_PACKET_TEMPERATURE,      21, 1, OI_PACKET_SIGNED, oi_temperatureField),
+    OI_PACKET(OI_PACKET_BATTERY_CHARGE,   22, 2, 0, oi_chargeField),
+    OI_PACKET(OI_PACKET_BATTERY_CAPACITY, 24, 2, 0, oi_capacityField),
+    OI_PACKET(OI_PACKET_WALL_SIGNAL,      26, 2, 0, oi_wallSignalField),
+    OI_PACKET(OI_PACKET_CLIFF_LEFT_SIGNAL,         28, 2, 0, oi_cliffLeftSignalField),
+    OI_PACKET(OI_PACKET_CLIFF_FRONT_LEFT_SIGNAL,   30, 2, 0, oi_cliffFrontLeftSignalField),
+    OI_PACKET(OI_PACKET_CLIFF_FRONT_RIGHT_SIGNAL,  32, 2, 0, oi_cliffFrontRightSignalField),
+    OI_PACKET(OI_PACKET_CLIFF_RIGHT_SIGNAL,        34, 2, 0, oi_cliffRightSignalField),
+    OI_IGNORED(32,                        36, 1),
+    OI_IGNORED(33,                        37, 2),
+    OI_PACKET(OI_PACKET_CHARGING_SOURCES, 39, 1, 0, oi_chargingSourcesField),
+    OI_PACKET(OI_PACKET_OI_MODE,          40, 1, 0, oi_oiModeField),
+    OI_PACKET(OI_PACKET_SONG_NUMBER,      41, 1, 0, oi_songNumberField),
+    OI_PACKET(OI_PACKET_SONG_PLAYING,     42, 1, 0, oi_songPlayingField),
+    OI_PACKET(OI_PACKET_STREAM_PACKETS,   43, 1, 0, oi_streamPacketsField),
+    OI_PACKET(OI_PACKET_REQUESTED_VELOCITY,        44, 2, OI_PACKET_SIGNED, oi_velocityField),
+    OI_PACKET(OI_PACKET_REQUESTED_RADIUS,          46, 2, OI_PACKET_SIGNED, oi_radiusField),
+    OI_PACKET(OI_PACKET_REQUESTED_RIGHT_VELOCITY,  48, 2, OI_PACKET_SIGNED, oi_rightVelocityField),
+    OI_PACKET(OI_PACKET_REQUESTED_LEFT_VELOCITY,   50, 2, OI_PACKET_SIGNED, oi_leftVelocityField),
+    OI_PACKET(OI_PACKET_LEFT_ENCODER,     52, 2, 0, oi_leftEncoderField),
+    OI_PACKET(OI_PACKET_RIGHT_ENCODER,    54, 2, 0, oi_rightEncoderField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMPER,     56, 1, 0, oi_lightBumperFields),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_LEFT,          57, 2, 0, oi_lightBumpLeftField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_FRONT_LEFT,    59, 2, 0, oi_lightBumpFrontLeftField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_CENTER_LEFT,   61, 2, 0, oi_lightBumpCenterLeftField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_CENTER_RIGHT,  63, 2, 0, oi_lightBumpCenterRightField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_FRONT_RIGHT,   65, 2, 0, oi_lightBumpFrontRightField),
+    OI_PACKET(OI_PACKET_LIGHT_BUMP_RIGHT,         67, 2, 0, oi_lightBumpRightField),
+    OI_PACKET(OI_PACKET_IR_LEFT,          69, 1, 0, oi_irLeftField),
+    OI_PACKET(OI_PACKET_IR_RIGHT,         70, 1, 0, oi_irRightField),
+    OI_PACKET(OI_PACKET_LEFT_MOTOR_CURRENT,   71, 2, OI_PACKET_SIGNED, oi_leftMotorCurrentField),
+    OI_PACKET(OI_PACKET_RIGHT_MOTOR_CURRENT,  73, 2, OI_PACKET_SIGNED, oi_rightMotorCurrentField),
+    OI_PACKET(OI_PACKET_MAIN_BRUSH_CURRENT,   75, 2, OI_PACKET_SIGNED, oi_mainBrushCurrentField),
+    OI_PACKET(OI_PACKET_SIDE_BRUSH_CURRENT,   77, 2, OI_PACKET_SIGNED, oi_sideBrushCurrentField),
+    OI_PACKET(OI_PACKET_STASIS,           79, 1, 0, oi_stasisField)
+};
+
+const oi_packet_t *oi_packets_find(uint8_t id)
+{
+    if (id > OI_PACKET_STASIS || oi_packetTable[id].width == 0) {
+        return 0;
+    }
+    return &oi_packetTable[id];
+}
+
+uint8_t oi_packets_size(uint8_t id)
+{
+    const oi_packet_t *packet = oi_packets_find(id);
+    return packet ? packet->width : 0;
+}
+
+/// Decode a known packet, no lookup or inUse check
+static void oi_packets_apply(oi_t *self, const oi_packet_t *packet, const uint8_t data[])
+{
+    int32_t value;
+    uint8_t i;
+
+    // Sensor data is big-endian
+    if (packet->width == 2) {
+        value = (data[0] << 8) | data[1];
+        if (packet->flags & OI_PACKET_SIGNED) {
+            value = (int16_t)value;
+        }
+    } else {
+        value = data[0];
+        if (packet->flags & OI_PACKET_SIGNED) {
+            value = (int8_t)value;
+        }
+    }
+
+    for (i = 0; i < packet->fieldCount; i++) {
+        const oi_field_t *field = &packet->fields[i];
+        field->store(self, field->mask ? !!(value & field->mask) : value);
+    }
+}
+
+uint64_t oi_packets_decode(oi_t *self, uint8_t id, const uint8_t data[], uint64_t inUse)
+{
+    const oi_packet_t *packet = oi_packets_find(id);
+
+    if (!packet || !(inUse & OI_PACKET_BIT(id))) {
+        return 0;
+    }
+
+    oi_packets_apply(self, packet, data);
+    return OI_PACKET_BIT(id);
+}
+
+uint64_t oi_packets_decodeGroup100(oi_t *self, const uint8_t data[], uint64_t inUse)
+{
+    uint64_t decoded = 0;
+    uint8_t id;
+
+    for (id = OI_PACKET_BUMPS_WHEELDROPS; id <= OI_PACKET_STASIS; id++) {
+        const oi_packet_t *packet = &oi_packetTable[id];
+
+        if (packet->fieldCount && (inUse & OI_PACKET_BIT(id))) {
+            oi_packets_apply(self, packet, data + packet->offset);
+            decoded |= OI_PACKET_BIT(id);
+        }
+    }
+
+    return decoded;
+}
+
+uint64_t oi_packets_decodeList(oi_t *self, const oi_queryList_t *list, const uint8_t response[],
+                               uint64_t inUse)
+{
+    uint64_t decoded = 0;
+    uint8_t i;
+
+    for (i = 0; i < list->count; i++) {
+        decoded |= oi_packets_decode(self, list->ids[i], response + list->offsets[i], inUse);
+    }
+
+    return decoded;
+}
+
+uint64_t oi_packets_decodeStream(oi_t *self, const uint8_t payload[], uint8_t length,
+                                 uint64_t inUse)
+{
+    uint64_t decoded = 0;
+    uint8_t i = 0;
+
+    while (i < length) {
+        uint8_t id = payload[i++];
+        uint8_t size;
+
+        if (id == OI_GROUP100_ID) {
+            size = OI_GROUP100_SIZE;
+        } else {
+            size = oi_packets_size(id);
+        }
+
+        if (size == 0 || i + size > length) {
+            // Unknown id or truncated packet, the frame does not match the table
+            return 0;
+        }
+
+        if (id == OI_GROUP100_ID) {
+            decoded |= oi_packets_decodeGroup100(self, payload + i, inUse);
+        } else {
+            decoded |= oi_packets_decode(self, id, payload + i, inUse);
+        }
+
+        i += size;
+    }
+
+    return decoded;
+}
+
+/// Fill in the response length and offsets of a query list
+int oi_queryListInit(oi_queryList_t *list, const uint8_t ids[], uint8_t count)
+{
+    uint8_t i;
+
+    if (count == 0 || count > OI_QUERY_MAX_PACKETS) {
+        return 0;
+    }
+
+    list->count = count;
+    list->responseLength = 0;
+
+    for (i = 0; i < count; i++) {
+        uint8_t size = oi_packets_size(ids[i]);
+
+        if (size == 0) {
+            list->count = 0;
+            return 0;
+        }
+
+        list->ids[i] = ids[i];
+        list->offsets[i] = list->responseLength;
+        list->responseLength += size;
+    }
+
+    return 1;
+}
@@ -0,0 +1,76 @@
+/*
+ * oi_packets.h
+ *
+ * Table driven decoder for Create 2 sensor packets. The layout of every
+ * packet (id, offset in group 100, width, signedness, bit masks and the oi_t
+ * field it lands in) is described once in oi_packets.c, and the same table is
+ * used for group 100 replies, query lists and stream frames.
+ *
+ * Decoding can be limited to the packets a program actually reads by passing
+ * a mask built with OI_PACKET_BIT() (see oi_sensors.h); everything else is
+ * skipped.
+ *
+ * Nothing here touches the hardware, tools/oi_packets_test.c checks the
+ * decoder on the host against golden packets.
+ *
+ */
+
+#ifndef OI_PACKETS_H_
+#define OI_PACKETS_H_
+
+#include "oi_sensors.h"
+
+/// Bytes in a group 100 reply, packets 7 - 58
+#define OI_GROUP100_SIZE 80
+
+/// Packet is a two's complement value
+#define OI_PACKET_SIGNED 0x01
+
+/// Stores one decoded value into a field of oi_t (bitfields cannot be
+/// addressed, so every destination gets a small store function)
+typedef void (*oi_store_t)(oi_t *self, int32_t value);
+
+/// One oi_t field filled from a packet
+typedef struct {
+    uint8_t mask;       // bits to test, the field gets 0 or 1; 0 = whole value
+    oi_store_t store;
+} oi_field_t;
+
+/// Layout of one sensor packet
+typedef struct {
+    uint8_t id;
+    uint8_t offset;     // where the packet starts in a group 100 reply
+    uint8_t width;      // bytes on the wire, 0 for unknown ids and groups
+    uint8_t flags;      // OI_PACKET_SIGNED
+    uint8_t fieldCount;
+    const oi_field_t *fields;
+} oi_packet_t;
+
+/// \brief Look up a packet by id
+/// \return the table entry, or 0 (NULL) if the id is not a single packet
+const oi_packet_t *oi_packets_find(uint8_t id);
+
+/// \brief Size in bytes of a single packet, 0 if unknown
+uint8_t oi_packets_size(uint8_t id);
+
+/// \brief Decode one packet into self if it is in inUse
+/// \return OI_PACKET_BIT(id) if it was decoded, 0 otherwise
+uint64_t oi_packets_decode(oi_t *self, uint8_t id, const uint8_t data[], uint64_t inUse);
+
+/// \brief Decode a group 100 reply (packets 7 - 58, 80 bytes)
+/// \return mask of the packets that were decoded
+uint64_t oi_packets_decodeGroup100(oi_t *self, const uint8_t data[], uint64_t inUse);
+
+/// \brief Decode the response to a query list, see oi_queryListInit()
+/// \return mask of the packets that were decoded
+uint64_t oi_packets_decodeList(oi_t *self, const oi_queryList_t *list, const uint8_t response[],
+                               uint64_t inUse);
+
+/// \brief Decode the payload of a stream frame: [id][data][id][data]...
+/// Group id 100 is accepted as one of the ids.
+/// \return mask of the packets that were decoded, 0 if the payload does not
+/// match the packet table
+uint64_t oi_packets_decodeStream(oi_t *self, const uint8_t payload[], uint8_t length,
+                                 uint64_t inUse);
+
+#endif /* OI_PACKETS_H_ */
@@ -0,0 +1,266 @@
+/*
+ * oi_script.c
+ *
+ * Open Interface motion scripts, see oi_script.h.
+ *
+ */
+
+#include "oi_script.h"
+
+// Script commands, same values as in open_interface.c
+#define OI_SCRIPT_OP_DRIVE_WHEELS 145
+#define OI_SCRIPT_OP_WAIT_TIME 155
+#define OI_SCRIPT_OP_WAIT_DISTANCE 156
+#define OI_SCRIPT_OP_WAIT_ANGLE 157
+
+/// Append one command, the whole command or nothing
+static int oi_script_append(oi_script_t *script, const uint8_t command[], uint8_t size)
+{
+    if (script->overflow || script->length + size > OI_SCRIPT_MAX_BYTES) {
+        script->overflow = 1;
+        return 0;
+    }
+
+    memcpy(script->bytes + script->length, command, size);
+    script->length += size;
+    return 1;
+}
+
+/// Command with one signed 16 bit argument, high byte first
+static int oi_script_appendWord(oi_script_t *script, uint8_t opcode, int16_t value)
+{
+    uint8_t command[3];
+
+    command[0] = opcode;
+    command[1] = (uint8_t)((uint16_t)value >> 8);
+    command[2] = (uint8_t)value;
+    return oi_script_append(script, command, sizeof(command));
+}
+
+static int16_t oi_script_readWord(const oi_script_t *script, uint8_t at)
+{
+    return (int16_t)((script->bytes[at] << 8) | script->bytes[at + 1]);
+}
+
+void oi_script_init(oi_script_t *script)
+{
+    script->length = 0;
+    script->overflow = 0;
+    script->state = OI_SCRIPT_IDLE;
+    script->pc = 0;
+    script->waiting = 0;
+    script->done = 0;
+}
+
+int oi_script_drive(oi_script_t *script, int16_t right_wheel, int16_t left_wheel)
+{
+    uint8_t command[5];
+
+    command[0] = OI_SCRIPT_OP_DRIVE_WHEELS;
+    command[1] = (uint8_t)((uint16_t)right_wheel >> 8);
+    command[2] = (uint8_t)right_wheel;
+    command[3] = (uint8_t)((uint16_t)left_wheel >> 8);
+    command[4] = (uint8_t)left_wheel;
+    return oi_script_append(script, command, sizeof(command));
+}
+
+int oi_script_stop(oi_script_t *script)
+{
+    return oi_script_drive(script, 0, 0);
+}
+
+int oi_script_waitDistance(oi_script_t *script, int16_t millimeters)
+{
+    return oi_script_appendWord(script, OI_SCRIPT_OP_WAIT_DISTANCE, millimeters);
+}
+
+int oi_script_waitAngle(oi_script_t *script, int16_t degrees)
+{
+    return oi_script_appendWord(script, OI_SCRIPT_OP_WAIT_ANGLE, degrees);
+}
+
+int oi_script_waitTime(oi_script_t *script, uint8_t tenths)
+{
+    uint8_t command[2];
+
+    command[0] = OI_SCRIPT_OP_WAIT_TIME;
+    command[1] = tenths;
+    return oi_script_append(script, command, sizeof(command));
+}
+
+int oi_script_forward(oi_script_t *script, int16_t speed, int16_t millimeters)
+{
+    if (speed < 0) {
+        speed = -speed;
+    }
+    if (millimeters < 0) {
+        speed = -speed;
+    }
+
+    return oi_script_drive(script, speed, speed) &&
+           oi_script_waitDistance(script, millimeters) &&
+           oi_script_stop(script);
+}
+
+int oi_script_turn(oi_script_t *script, int16_t speed, int16_t degrees)
+{
+    if (speed < 0) {
+        speed = -speed;
+    }
+    if (degrees < 0) {
+        speed = -speed;
+    }
+
+    // Counterclockwise: right wheel forward, left wheel back
+    return oi_script_drive(script, speed, -speed) &&
+           oi_script_waitAngle(script, degrees) &&
+           oi_script_stop(script);
+}
+
+/// Execute commands until the next wait or the end of the script
+static void oi_script_run(oi_script_t *script)
+{
+    while (!script->waiting && script->pc < script->length) {
+        uint8_t pc = script->pc;
+
+        switch (script->bytes[pc]) {
+        case OI_SCRIPT_OP_DRIVE_WHEELS:
+#if !OI_NATIVE_SCRIPTS
+            oi_setWheels(oi_script_readWord(script, pc + 1),
+                         oi_script_readWord(script, pc + 3));
+#endif
+            script->pc += 5;
+            break;
+
+        case OI_SCRIPT_OP_WAIT_DISTANCE:
+            script->target = oi_script_readWord(script, pc + 1) * 1000L;
+            script->waiting = OI_SCRIPT_OP_WAIT_DISTANCE;
+            script->pc += 3;
+            break;
+
+        case OI_SCRIPT_OP_WAIT_ANGLE:
+            script->target = oi_script_readWord(script, pc + 1) * 1000L;
+            script->waiting = OI_SCRIPT_OP_WAIT_ANGLE;
+            script->pc += 3;
+            break;
+
+        case OI_SCRIPT_OP_WAIT_TIME:
+            script->target = script->bytes[pc + 1] * 100L;
+            script->waitStart = timer_getMillis();
+            script->waiting = OI_SCRIPT_OP_WAIT_TIME;
+            script->pc += 2;
+            break;
+
+        default:
+            // The builder never writes anything else
+            script->pc = script->length;
+            break;
+        }
+
+        script->progress = 0;
+        script->lastStep = 0;
+    }
+
+    if (!script->waiting && script->pc >= script->length) {
+        script->state = OI_SCRIPT_DONE;
+        if (script->done) {
+            script->done(script);
+        }
+    }
+}
+
+/// \brief Add the motion of the latest sensor update to the running wait
+/// \return 1 if the wait is over
+static int oi_script_waitOver(oi_script_t *script, const oi_t *self)
+{
+    int32_t step;
+    int32_t expected;
+
+    switch (script->waiting) {
+    case OI_SCRIPT_OP_WAIT_TIME:
+        return (int32_t)(timer_getMillis() - script->waitStart) >= script->target;
+
+    case OI_SCRIPT_OP_WAIT_DISTANCE:
+        step = self->distanceMicrons;
+        break;
+
+    case OI_SCRIPT_OP_WAIT_ANGLE:
+        step = self->angleMillidegrees;
+        break;
+
+    default:
+        return 1;
+    }
+
+    script->progress += step;
+    script->lastStep = step;
+
+    // Stop half a frame early: the next frame would land about as far past
+    // the target as this one is short of it
+    expected = script->progress + step / 2;
+
+    return script->target >= 0 ? expected >= script->target
+                               : expected <= script->target;
+}
+
+int oi_script_start(oi_script_t *script, oi_t *self, oi_scriptDone_t done)
+{
+    if (script->overflow || script->length == 0) {
+        return 0;
+    }
+
+    script->pc = 0;
+    script->waiting = 0;
+    script->done = done;
+    script->state = OI_SCRIPT_RUNNING;
+
+#if OI_NATIVE_SCRIPTS
+    oi_loadScript(script->bytes, script->length);
+    oi_playScript();
+#endif
+
+    // Throw away motion from before the start
+    if (oi_isStreaming()) {
+        oi_streamUpdate(self);
+    }
+
+    oi_script_run(script);
+    return 1;
+}
+
+int oi_script_poll(oi_script_t *script, oi_t *self)
+{
+    if (script->state != OI_SCRIPT_RUNNING) {
+        return 0;
+    }
+
+    if (oi_isStreaming()) {
+        if (!oi_streamUpdate(self)) {
+            // No new frame, only a time wait can have finished
+            if (script->waiting != OI_SCRIPT_OP_WAIT_TIME) {
+                return 1;
+            }
+        }
+    } else {
+        oi_update(self);
+    }
+
+    if (oi_script_waitOver(script, self)) {
+        script->waiting = 0;
+        oi_script_run(script);
+    }
+
+    return script->state == OI_SCRIPT_RUNNING;
+}
+
+void oi_script_abort(oi_script_t *script)
+{
+    oi_setWheels(0, 0);
+    script->waiting = 0;
+    script->state = OI_SCRIPT_IDLE;
+}
+
+int oi_script_isDone(const oi_script_t *script)
+{
+    return script->state == OI_SCRIPT_DONE;
+}
@@ -0,0 +1,113 @@
+/*
+ * oi_script.h
+ *
+ * Builds motion scripts out of drive / wait / stop steps, encoded exactly as
+ * the Open Interface script commands (152 - 158), and runs them.
+ *
+ * The Create 2 firmware dropped the script opcodes, so by default a script is
+ * run here: oi_script_poll() steps through the encoded bytes on every sensor
+ * frame (15 ms with oi_startStream()), sends each drive command and checks the
+ * waits against the encoder distance and angle. Between polls the program is
+ * free to scan, talk over UART and so on.
+ *
+ * Builds with OI_NATIVE_SCRIPTS set to 1 also upload the script to the robot
+ * (opcode 152) and play it (153), for the original Create which executes the
+ * waits itself. The local runner then only follows along to report completion.
+ *
+ * Example:
+ *
+ *     oi_script_t script;
+ *     oi_script_init(&script);
+ *     oi_script_turn(&script, 150, -90);      // clockwise quarter turn
+ *     oi_script_forward(&script, 200, 500);   // 50 cm
+ *     oi_script_start(&script, sensor, 0);
+ *     while (oi_script_poll(&script, sensor)) {
+ *         ... scan ...
+ *     }
+ *
+ */
+
+#ifndef OI_SCRIPT_H_
+#define OI_SCRIPT_H_
+
+#include "open_interface.h"
+
+#ifndef OI_NATIVE_SCRIPTS
+#define OI_NATIVE_SCRIPTS 0
+#endif
+
+/// Script length limit of the Open Interface
+#define OI_SCRIPT_MAX_BYTES 100
+
+typedef enum {
+    OI_SCRIPT_IDLE,
+    OI_SCRIPT_RUNNING,
+    OI_SCRIPT_DONE
+} oi_scriptState_t;
+
+struct oi_script;
+
+/// Called from oi_script_poll() when the last step finished
+typedef void (*oi_scriptDone_t)(struct oi_script *script);
+
+typedef struct oi_script {
+    uint8_t bytes[OI_SCRIPT_MAX_BYTES];
+    uint8_t length;
+    uint8_t overflow;           // a step did not fit, the script is refused
+
+    // Runner
+    oi_scriptState_t state;
+    uint8_t pc;                 // next byte to execute
+    uint8_t waiting;            // opcode of the wait in progress, 0 if none
+    int32_t target;             // microns, millidegrees or milliseconds
+    int32_t progress;
+    int32_t lastStep;           // progress made by the last sensor frame
+    unsigned int waitStart;     // timer_getMillis() when a time wait started
+    oi_scriptDone_t done;
+} oi_script_t;
+
+/// Start an empty script
+void oi_script_init(oi_script_t *script);
+
+/// \brief Set the wheel velocities, -500 to 500 mm/s
+/// \return 0 if the script is full
+int oi_script_drive(oi_script_t *script, int16_t right_wheel, int16_t left_wheel);
+
+/// \brief Stop both wheels
+int oi_script_stop(oi_script_t *script);
+
+/// \brief Wait until the robot has driven millimeters (negative when backing up)
+int oi_script_waitDistance(oi_script_t *script, int16_t millimeters);
+
+/// \brief Wait until the robot has turned degrees, counterclockwise positive
+int oi_script_waitAngle(oi_script_t *script, int16_t degrees);
+
+/// \brief Wait for tenths of a second
+int oi_script_waitTime(oi_script_t *script, uint8_t tenths);
+
+/// \brief Drive straight millimeters at speed mm/s, then stop
+/// Negative millimeters back up.
+int oi_script_forward(oi_script_t *script, int16_t speed, int16_t millimeters);
+
+/// \brief Turn in place by degrees at speed mm/s, then stop
+/// Positive degrees turn counterclockwise.
+int oi_script_turn(oi_script_t *script, int16_t speed, int16_t degrees);
+
+/// \brief Start running a script
+/// \param done optional, called once the script finished
+/// \return 0 if the script overflowed or is empty
+int oi_script_start(oi_script_t *script, oi_t *self, oi_scriptDone_t done);
+
+/// \brief Advance a running script by one sensor update
+/// Uses oi_streamUpdate() while streaming and returns at once if no new frame
+/// arrived; otherwise it falls back to oi_update(), which blocks.
+/// \return 1 while the script is still running
+int oi_script_poll(oi_script_t *script, oi_t *self);
+
+/// \brief Stop the wheels and abandon the script
+void oi_script_abort(oi_script_t *script);
+
+/// \return 1 once the script has finished
+int oi_script_isDone(const oi_script_t *script);
+
+#endif /* OI_SCRIPT_H_ */
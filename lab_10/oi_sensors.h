@@ -0,0 +1,227 @@
+/*
+ * oi_sensors.h
+ *
+ * Create 2 sensor packet ids, the oi_t the sensor data is decoded into and
+ * query lists, apart from open_interface.h so the packet decoder (oi_packets.c)
+ * and the odometry (oi_odometry.c) need no hardware headers and build on the
+ * host.
+ *
+ */
+
+#ifndef OI_SENSORS_H_
+#define OI_SENSORS_H_
+
+#include <stdint.h>
+
+/// Create 2 sensor packet ids, for use with query lists
+#define OI_PACKET_BUMPS_WHEELDROPS      7
+#define OI_PACKET_WALL                  8
+#define OI_PACKET_CLIFF_LEFT            9
+#define OI_PACKET_CLIFF_FRONT_LEFT      10
+#define OI_PACKET_CLIFF_FRONT_RIGHT     11
+#define OI_PACKET_CLIFF_RIGHT           12
+#define OI_PACKET_VIRTUAL_WALL          13
+#define OI_PACKET_OVERCURRENTS          14
+#define OI_PACKET_DIRT_DETECT           15
+#define OI_PACKET_IR_OMNI               17
+#define OI_PACKET_BUTTONS               18
+#define OI_PACKET_CHARGING_STATE        21
+#define OI_PACKET_VOLTAGE               22
+#define OI_PACKET_CURRENT               23
+#define OI_PACKET_TEMPERATURE           24
+#define OI_PACKET_BATTERY_CHARGE        25
+#define OI_PACKET_BATTERY_CAPACITY      26
+#define OI_PACKET_WALL_SIGNAL           27
+#define OI_PACKET_CLIFF_LEFT_SIGNAL     28
+#define OI_PACKET_CLIFF_FRONT_LEFT_SIGNAL   29
+#define OI_PACKET_CLIFF_FRONT_RIGHT_SIGNAL  30
+#define OI_PACKET_CLIFF_RIGHT_SIGNAL    31
+#define OI_PACKET_CHARGING_SOURCES      34
+#define OI_PACKET_OI_MODE               35
+#define OI_PACKET_SONG_NUMBER           36
+#define OI_PACKET_SONG_PLAYING          37
+#define OI_PACKET_STREAM_PACKETS        38
+#define OI_PACKET_REQUESTED_VELOCITY    39
+#define OI_PACKET_REQUESTED_RADIUS      40
+#define OI_PACKET_REQUESTED_RIGHT_VELOCITY  41
+#define OI_PACKET_REQUESTED_LEFT_VELOCITY   42
+#define OI_PACKET_LEFT_ENCODER          43
+#define OI_PACKET_RIGHT_ENCODER         44
+#define OI_PACKET_LIGHT_BUMPER          45
+#define OI_PACKET_LIGHT_BUMP_LEFT       46
+#define OI_PACKET_LIGHT_BUMP_FRONT_LEFT     47
+#define OI_PACKET_LIGHT_BUMP_CENTER_LEFT    48
+#define OI_PACKET_LIGHT_BUMP_CENTER_RIGHT   49
+#define OI_PACKET_LIGHT_BUMP_FRONT_RIGHT    50
+#define OI_PACKET_LIGHT_BUMP_RIGHT      51
+#define OI_PACKET_IR_LEFT               52
+#define OI_PACKET_IR_RIGHT              53
+#define OI_PACKET_LEFT_MOTOR_CURRENT    54
+#define OI_PACKET_RIGHT_MOTOR_CURRENT   55
+#define OI_PACKET_MAIN_BRUSH_CURRENT    56
+#define OI_PACKET_SIDE_BRUSH_CURRENT    57
+#define OI_PACKET_STASIS                58
+
+/// \brief Set to 1 for the old double distance (mm) and angle (degrees) fields
+/// in oi_t, for code written against them. They are derived from the integer
+/// distanceMicrons/angleMillidegrees after every update, which costs software
+/// double math on the single precision FPU, so they are off by default.
+#ifndef OI_DOUBLE_ODOMETRY
+#define OI_DOUBLE_ODOMETRY 0
+#endif
+
+/// Wheel travel per encoder tick, 72pi / 508.8 mm = 444.565 um, in Q16
+#define OI_MICRONS_PER_TICK_Q16 29135012L
+
+/// Heading change per tick of (right - left) encoder difference over the
+/// 235 mm wheel base, 72 * 180 / (508.8 * 235) deg = 108.390 mdeg, in Q16
+#define OI_MILLIDEGREES_PER_TICK_Q16 7103460L
+
+/// Mask bit for one packet id, see oi_setPacketsInUse()
+#define OI_PACKET_BIT(id) ((uint64_t)1 << (id))
+
+/// Decode every packet
+#define OI_PACKETS_ALL 0xFFFFFFFFFFFFFFFFULL
+
+/// Most packets a query list can hold
+#define OI_QUERY_MAX_PACKETS 16
+
+/// Dead reckoning position of the robot, see oi_getPose()
+typedef struct {
+    int32_t x;          // um along the heading the pose was reset with
+    int32_t y;          // um, to the left of that heading
+    int32_t heading;    // millidegrees, counter-clockwise positive, not wrapped
+} oi_pose_t;
+
+/// Encoder bookkeeping behind the pose, internal to open_interface.c
+typedef struct {
+    int16_t prevLeft;       // encoder counts at the previous update
+    int16_t prevRight;
+    uint8_t primed;         // prevLeft/prevRight hold a real reading
+    int32_t leftTicks;      // unwrapped ticks since the last pose reset
+    int32_t rightTicks;
+    int32_t headingOffset;  // heading the pose was reset to
+} oi_odometry_t;
+
+/// iRobot Create Sensor Data
+typedef struct {
+    //Boolean sensor values
+    uint32_t wheelDropLeft : 1;
+    uint32_t wheelDropRight : 1;
+    uint32_t bumpLeft : 1;
+    uint32_t bumpRight : 1;
+    uint32_t cliffLeft : 1;
+    uint32_t cliffFrontLeft : 1;
+    uint32_t cliffFrontRight : 1;
+    uint32_t cliffRight : 1;
+
+    uint32_t lightBumperRight : 1;
+    uint32_t lightBumperFrontRight : 1;
+    uint32_t lightBumperCenterRight : 1;
+    uint32_t lightBumperCenterLeft : 1;
+    uint32_t lightBumperFrontLeft : 1;
+    uint32_t lightBumperLeft : 1;
+
+    uint32_t wallSensor : 1;
+    uint32_t virtualWall : 1;
+
+    uint32_t overcurrentLeftWheel : 1;
+    uint32_t overcurrentRightWheel : 1;
+    uint32_t overcurrentMainBrush : 1;
+    uint32_t overcurrentSideBrush : 1;
+
+    uint32_t buttonClock : 1;
+    uint32_t buttonSchedule : 1;
+    uint32_t buttonDay : 1;
+    uint32_t buttonHour : 1;
+    uint32_t buttonMinute : 1;
+    uint32_t buttonDock : 1;
+    uint32_t buttonSpot : 1;
+    uint32_t buttonClean : 1;
+
+    //Cliff sensors
+    uint16_t cliffLeftSignal;
+    uint16_t cliffFrontLeftSignal;
+    uint16_t cliffFrontRightSignal;
+    uint16_t cliffRightSignal;
+
+    //Light bump sensors
+    uint16_t lightBumpLeftSignal;
+    uint16_t lightBumpFrontLeftSignal;
+    uint16_t lightBumpCenterLeftSignal;
+    uint16_t lightBumpCenterRightSignal;
+    uint16_t lightBumpFrontRightSignal;
+    uint16_t lightBumpRightSignal;
+
+    //Misc sensors
+    uint16_t wallSignal;
+    uint8_t dirtDetect;
+
+    //Power
+    int16_t leftMotorCurrent;
+    int16_t rightMotorCurrent;
+    int16_t mainBrushMotorCurrent;
+    int16_t sideBrushMotorCurrent;
+
+    //Motion sensors, change since the previous update
+    int32_t distanceMicrons;
+    int32_t angleMillidegrees;
+#if OI_DOUBLE_ODOMETRY
+    double distance;    // mm, same as distanceMicrons
+    double angle;       // degrees, same as angleMillidegrees
+#endif
+    int8_t requestedVelocity;
+    int8_t requestedRadius;
+    int16_t requestedRightVelocity;
+    int16_t requestedLeftVelocity;
+    int16_t leftEncoderCount;
+    int16_t rightEncoderCount;
+
+    //Pose integrated from the encoders, survives across updates
+    oi_pose_t pose;
+    oi_odometry_t odometry;
+
+    //Information from the infrared beacon sensors
+    char infraredCharOmni;
+    char infraredCharLeft;
+    char infraredCharRight;
+
+    //Battery information
+    uint8_t chargingState;
+    uint8_t chargingSourcesAvailable;
+    uint16_t batteryVoltage;
+    int16_t batteryCurrent;
+    uint8_t batteryTemperature;
+    uint16_t batteryCharge;
+    uint16_t batteryCapacity;
+
+    //Music
+    uint8_t songNumber;
+    uint8_t songPlaying;
+
+    //Misc
+    uint8_t oiMode;
+    uint8_t numberOfStreamPackets;
+    uint8_t stasis;
+
+} oi_t;
+
+/// A precomputed sensor query list, see oi_queryListInit()
+typedef struct {
+    uint8_t count;                          // number of packets
+    uint8_t ids[OI_QUERY_MAX_PACKETS];      // packet ids in request order
+    uint8_t offsets[OI_QUERY_MAX_PACKETS];  // where each packet starts in the response
+    uint8_t responseLength;                 // total bytes the robot answers with
+} oi_queryList_t;
+
+/// \brief Build a query list for a subset of sensor packets (opcode 149)
+/// For example {OI_PACKET_BUMPS_WHEELDROPS, OI_PACKET_LEFT_ENCODER,
+/// OI_PACKET_RIGHT_ENCODER} is answered with 5 bytes instead of 80. The
+/// response length and parse offsets are computed once here.
+/// \param list list to fill in
+/// \param ids packet ids (7 - 58) in the order they should be requested
+/// \param count number of ids, at most OI_QUERY_MAX_PACKETS
+/// \return 1 on success, 0 if count is too large or an id is unknown
+int oi_queryListInit(oi_queryList_t *list, const uint8_t ids[], uint8_t count);
+
+#endif /* OI_SENSORS_H_ */
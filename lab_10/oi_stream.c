@@ -0,0 +1,66 @@
+/*
+ * oi_stream.c
+ *
+ * Header/length/checksum state machine for the Create 2 sensor stream.
+ *
+ */
+
+#include "oi_stream.h"
+
+void oi_stream_init(oi_stream_t *stream)
+{
+    stream->state = OI_STREAM_WAIT_HEADER;
+    stream->length = 0;
+    stream->index = 0;
+    stream->sum = 0;
+    stream->frames = 0;
+    stream->badChecksum = 0;
+    stream->badLength = 0;
+}
+
+int oi_stream_feed(oi_stream_t *stream, uint8_t byte)
+{
+    switch (stream->state) {
+    case OI_STREAM_WAIT_HEADER:
+        if (byte == OI_STREAM_HEADER) {
+            stream->sum = byte;
+            stream->state = OI_STREAM_WAIT_LENGTH;
+        }
+        break;
+
+    case OI_STREAM_WAIT_LENGTH:
+        if (byte == 0 || byte > OI_STREAM_MAX_PAYLOAD) {
+            // Not a real header, a 19 in the middle of some data
+            stream->badLength++;
+            stream->state = (byte == OI_STREAM_HEADER) ? OI_STREAM_WAIT_LENGTH
+                                                       : OI_STREAM_WAIT_HEADER;
+            stream->sum = OI_STREAM_HEADER;
+            break;
+        }
+        stream->length = byte;
+        stream->index = 0;
+        stream->sum += byte;
+        stream->state = OI_STREAM_PAYLOAD;
+        break;
+
+    case OI_STREAM_PAYLOAD:
+        stream->payload[stream->index++] = byte;
+        stream->sum += byte;
+        if (stream->index == stream->length) {
+            stream->state = OI_STREAM_CHECKSUM;
+        }
+        break;
+
+    case OI_STREAM_CHECKSUM:
+        stream->state = OI_STREAM_WAIT_HEADER;
+        if ((uint8_t)(stream->sum + byte) == 0) {
+            stream->frames++;
+            return 1;
+        }
+        // Lost sync; the next header byte starts over
+        stream->badChecksum++;
+        break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * oi_stream.h
+ *
+ * Frame decoder for the Create 2 sensor stream (opcode 148). Once streaming
+ * is started the robot sends a frame every 15 ms:
+ *
+ *   [19] [n-bytes] [packet id 1] [data 1] ... [packet id k] [data k] [checksum]
+ *
+ * n-bytes counts everything between itself and the checksum, and the low byte
+ * of the sum of every byte in the frame (header and checksum included) is 0.
+ *
+ * The decoder is fed one byte at a time and does not touch any hardware, so it
+ * can be run on the host against a recorded byte stream; tools/oi_stream_test.c
+ * does that.
+ *
+ */
+
+#ifndef OI_STREAM_H_
+#define OI_STREAM_H_
+
+#include <stdint.h>
+
+#define OI_STREAM_HEADER 19
+
+// Largest n-bytes value accepted. Group 100 plus its id is 81 bytes.
+#define OI_STREAM_MAX_PAYLOAD 128
+
+typedef enum {
+    OI_STREAM_WAIT_HEADER,
+    OI_STREAM_WAIT_LENGTH,
+    OI_STREAM_PAYLOAD,
+    OI_STREAM_CHECKSUM
+} oi_streamState_t;
+
+typedef struct {
+    oi_streamState_t state;
+    uint8_t length;     // n-bytes of the frame being received
+    uint8_t index;      // payload bytes received so far
+    uint8_t sum;        // running checksum of the frame
+    uint8_t payload[OI_STREAM_MAX_PAYLOAD];
+
+    // Statistics
+    uint16_t frames;    // frames with a good checksum
+    uint16_t badChecksum;
+    uint16_t badLength;
+} oi_stream_t;
+
+/// Reset the decoder to hunt for a header and clear its statistics
+void oi_stream_init(oi_stream_t *stream);
+
+/// \brief Feed one received byte into the decoder
+/// \return 1 when this byte completed a frame with a valid checksum; the frame
+/// is then available in stream->payload[0 .. stream->length - 1] until the next
+/// call. Returns 0 otherwise.
+int oi_stream_feed(oi_stream_t *stream, uint8_t byte);
+
+#endif /* OI_STREAM_H_ */
@@ -0,0 +1,89 @@
+/*
+ * oneshot.c
+ *
+ * TIMER2A one-shot delays, see oneshot.h.
+ *
+ */
+
+#include <inc/tm4c123gh6pm.h>
+#include "driverlib/interrupt.h"
+#include "clock.h"
+#include "oneshot.h"
+
+static void (*volatile oneshot_callback)(void) = 0;
+static uint8_t oneshot_ready = 0;
+
+void oneshot_init(void)
+{
+    if (oneshot_ready) {
+        return;
+    }
+
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2; // Turn on clock to TIMER2
+    while (!(SYSCTL_PRTIMER_R & SYSCTL_PRTIMER_R2));
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;           // Disable TIMER2 for setup
+    TIMER2_CFG_R = TIMER_CFG_32_BIT_TIMER;     // A alone, 32 bits of cycles
+    TIMER2_TAMR_R = TIMER_TAMR_TAMR_1_SHOT;    // One-shot, countdown mode
+    TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+    TIMER2_IMR_R |= TIMER_IMR_TATOIM;
+    NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT23_M) | (1 << NVIC_PRI5_INT23_S);
+    IntRegister(INT_TIMER2A, oneshot_handler);
+    NVIC_EN0_R |= 1 << (INT_TIMER2A - 16);     // TIMER2A is IRQ 23
+
+    oneshot_ready = 1;
+}
+
+int oneshot_start(uint32_t nanos, void (*f)(void))
+{
+    uint64_t cycles;
+    bool wasDisabled;
+    int started = 0;
+
+    if (!oneshot_ready) {
+        oneshot_init();
+    }
+
+    // Round up, a delay may end late but not early
+    cycles = ((uint64_t)nanos * clock_getHz() + 999999999) / 1000000000;
+    if (cycles == 0) {
+        cycles = 1;
+    }
+
+    wasDisabled = IntMasterDisable();
+    if (!oneshot_callback) {
+        oneshot_callback = f;
+        TIMER2_TAILR_R = (uint32_t)cycles;
+        TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+        TIMER2_CTL_R |= TIMER_CTL_TAEN;         // Clears itself at the timeout
+        started = 1;
+    }
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+
+    return started;
+}
+
+int oneshot_busy(void)
+{
+    return oneshot_callback != 0;
+}
+
+void oneshot_cancel(void)
+{
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
+    TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+    oneshot_callback = 0;
+}
+
+void oneshot_handler(void)
+{
+    void (*f)(void) = oneshot_callback;
+
+    TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+    oneshot_callback = 0; // free before f runs, so f can start the next one
+
+    if (f) {
+        f();
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * oneshot.h
+ *
+ * One-shot delays on TIMER2A, counting system clock cycles (12.5 ns at
+ * 80 MHz). oneshot_start() returns at once and the callback runs from the
+ * TIMER2A interrupt when the time is up, so a short pulse, like the PING
+ * trigger, costs two interrupts instead of a busy wait. A callback may start
+ * the next delay, to chain the steps of a pulse train.
+ *
+ * The interrupt runs at a high priority (1), so the delay only ends late by
+ * the interrupt entry, never early. For blocking delays use
+ * timer_waitMicros()/timer_waitNanos().
+ *
+ */
+
+#ifndef ONESHOT_H_
+#define ONESHOT_H_
+
+#include <stdint.h>
+
+/// Turn on TIMER2, done by the first oneshot_start()
+void oneshot_init(void);
+
+/// \brief Call f from the TIMER2A interrupt nanos from now
+/// \return 0 if a delay is already running
+int oneshot_start(uint32_t nanos, void (*f)(void));
+
+/// Returns 1 while a delay is running
+int oneshot_busy(void);
+
+/// Stop the running delay without calling its callback
+void oneshot_cancel(void);
+
+/// TIMER2A interrupt
+void oneshot_handler(void);
+
+#endif /* ONESHOT_H_ */
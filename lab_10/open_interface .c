@@ -16,6 +16,11 @@
  */
 
 #include "open_interface.h"
+#include "oi_packets.h"
+#include "udma.h"
+#include "clock.h"
+#include "profile.h"
+#include "power.h"
 
 #define OI_OPCODE_START 128
 #define OI_OPCODE_BAUD 129
@@ -50,6 +55,9 @@
 #define OI_OPCODE_WAIT_ANGLE 157
 #define OI_OPCODE_WAIT_EVENT 158
 
+// Longest script the robot stores
+#define OI_SCRIPT_LIMIT 100
+
 #define OI_OPCODE_RESET 7 // RESET ROOMBA - GO TO
 #define OI_OPCODE_STOP 173
 #define OI_OPCODE_SCHEDULE 167
@@ -82,6 +90,50 @@
 
 #define SENSOR_PACKET_SIZE 80
 
+// Bytes buffered between the UART4 interrupt and oi_streamUpdate(). Holds
+// three group 100 frames so a slow main loop only loses stale data.
+#define OI_RX_BUFFER_SIZE 256
+
+static uint8_t oi_rxStorage[OI_RX_BUFFER_SIZE];
+static ringbuf_t oi_rxBuffer;
+static oi_stream_t oi_stream;
+static volatile uint8_t oi_streaming = 0;
+
+// Polled replies (group 100, query lists) are read by uDMA channel 18
+static volatile uint8_t oi_rxDmaDone = 1;
+
+// Longest sleep while waiting for a frame or a DMA reply. The UART4 interrupt
+// wakes us first; this only bounds the wait if it fires just before the WFI.
+#define OI_SLEEP_MICROS 1000
+
+static void oi_sleep(void)
+{
+    power_sleepUntil(timer_getMicros64() + OI_SLEEP_MICROS);
+}
+
+// Packets decoded by every update, see oi_setPacketsInUse()
+static uint64_t oi_packetsInUse = OI_PACKETS_ALL;
+
+// Both encoders are needed to update distance, angle and pose
+#define OI_ENCODER_PACKETS (OI_PACKET_BIT(OI_PACKET_LEFT_ENCODER) | \
+                            OI_PACKET_BIT(OI_PACKET_RIGHT_ENCODER))
+
+// Commands are queued as whole frames, [length][bytes...], and drained by the
+// UART4 TX interrupt. Frames in the preempt lane (drive and mode commands) go
+// out before any queued normal frame such as songs and LEDs.
+#define OI_TX_BUFFER_SIZE 256
+#define OI_TX_PREEMPT_BUFFER_SIZE 64
+
+#define OI_LANE_NORMAL 0
+#define OI_LANE_PREEMPT 1
+
+static uint8_t oi_txStorage[OI_TX_BUFFER_SIZE];
+static uint8_t oi_txPreemptStorage[OI_TX_PREEMPT_BUFFER_SIZE];
+static ringbuf_t oi_txBuffer;
+static ringbuf_t oi_txPreemptBuffer;
+static ringbuf_t *oi_txLane = 0;         // lane of the frame being sent
+static uint8_t oi_txRemaining = 0;       // bytes left of that frame
+
 float motor_cal_factor_L = 1.00;
 float motor_cal_factor_R = 1.00;
 
@@ -100,6 +152,19 @@ void oi_uartFastMode(void);
 /// internal function
 void oi_uartSendChar(char data);
 
+/// Feed queued commands into the TX FIFO
+/// internal function
+static void oi_uartTxPump(void);
+
+/// \brief Queue a complete command so it is never interleaved with another one
+/// Only waits if the queue is full.
+/// internal function
+static void oi_uartSendFrame(const uint8_t frame[], uint8_t length, int lane);
+
+/// Wait until every queued command has left the UART
+/// internal function
+static void oi_uartFlush(void);
+
 /// transmit character array
 /// internal function
 void uart_sendStr(const char *theData);
@@ -108,6 +173,14 @@ void uart_sendStr(const char *theData);
 /// internal function
 char oi_uartReceive(void);
 
+/// \brief Read a reply of known length with uDMA, arm before sending the query
+/// internal function
+static void oi_uartReceiveDma(uint8_t buffer[], uint16_t length);
+
+/// Wait for oi_uartReceiveDma() to finish
+/// internal function
+static void oi_uartWaitDma(void);
+
 /// Parse data from iRobot into oi_t struct
 void oi_parsePacket(oi_t *self, uint8_t packet[]);
 
@@ -115,10 +188,9 @@ void oi_parsePacket(oi_t *self, uint8_t packet[]);
 /// internal function
 void oi_uartSendBuff(const uint8_t theData[], uint8_t theSize);
 
-/// Helper function to convert big-endian integer from pointer into little
-/// endian integer
+/// Update odometry if both encoder packets were among the decoded packets
 /// internal function
-int16_t oi_parseInt(uint8_t *theInt);
+static void oi_afterDecode(oi_t *self, uint64_t decoded);
 
 /// Allocate and clear all memory for OI Struct
 oi_t *oi_alloc()
@@ -140,9 +212,9 @@ void oi_init_noupdate()
 {
     timer_init();
     oi_uartInit();
-    oi_uartSendChar(OI_OPCODE_START);
-
-    oi_uartSendChar(OI_OPCODE_FULL); // Use full mode, unrestricted control
+    // Use full mode, unrestricted control
+    const uint8_t start[] = {OI_OPCODE_START, OI_OPCODE_FULL};
+    oi_uartSendFrame(start, sizeof(start), OI_LANE_PREEMPT);
     oi_setLeds(1, 1, 7, 255);
 
     oi_shutoff_init(); // allows for pushbutton SW2 on PF0 to kill oi
@@ -167,131 +239,202 @@ void oi_init(oi_t *self)
 
 void oi_close()
 {
+    const uint8_t stop = OI_OPCODE_STOP;
+
     oi_setWheels(0, 0);
-    oi_uartSendChar(OI_OPCODE_STOP);
+    oi_uartSendFrame(&stop, 1, OI_LANE_PREEMPT);
+    oi_uartFlush(); // make sure the robot hears it before we return
 }
 
 /// Update all sensor and store in oi_t struct
 void oi_update(oi_t *self)
 {
     uint8_t sensorBuffer[SENSOR_PACKET_SIZE];
+    PROFILE_BEGIN(PROFILE_OI_UPDATE);
 
-    // Query list of sensors
-    oi_uartSendChar(OI_OPCODE_SENSORS);
-    oi_uartSendChar(OI_SENSOR_PACKET_GROUP100);
-
-    // Read all the sensor data
-    uint8_t i;
-    for (i = 0; i < SENSOR_PACKET_SIZE; i++) {
-        // read each sensor byte
-        sensorBuffer[i] = oi_uartReceive();
+    if (oi_streaming) {
+        // The robot sends a frame every 15ms on its own, just wait for it
+        while (!oi_streamUpdate(self)) {
+            oi_sleep();
+        }
+        PROFILE_END(PROFILE_OI_UPDATE);
+        return;
     }
 
+    // Query list of sensors, the reply is read by uDMA
+    const uint8_t query[] = {OI_OPCODE_SENSORS, OI_SENSOR_PACKET_GROUP100};
+    oi_uartReceiveDma(sensorBuffer, SENSOR_PACKET_SIZE);
+    oi_uartSendFrame(query, sizeof(query), OI_LANE_NORMAL);
+    oi_uartWaitDma();
+
     // Parse the sensor data into the struct
     oi_parsePacket(self, sensorBuffer);
 
     timer_waitMillis(25); // reduces USART errors that occur when continuously
                           // transmitting/receiving min wait time=15ms
+    PROFILE_END(PROFILE_OI_UPDATE);
 }
 
-void oi_parsePacket(oi_t *self, uint8_t packet[])
+/// Query a subset of the sensors and update only their fields
+void oi_updateList(oi_t *self, const oi_queryList_t *list)
 {
-    self->wheelDropLeft = !!(packet[0] & 0x08);
-    self->wheelDropRight = !!(packet[0] & 0x04);
-    self->bumpLeft = !!(packet[0] & 0x02);
-    self->bumpRight = packet[0] & 0x01;
+    uint8_t response[OI_QUERY_MAX_PACKETS * 2];
+    uint8_t query[OI_QUERY_MAX_PACKETS + 2];
+    uint64_t decoded;
 
-    self->wallSensor = packet[1];
+    if (oi_streaming || list->count == 0) {
+        return;
+    }
 
-    self->cliffLeft = packet[2];
-    self->cliffFrontLeft = packet[3];
-    self->cliffFrontRight = packet[4];
-    self->cliffRight = packet[5];
+    query[0] = OI_OPCODE_QUERY_LIST;
+    query[1] = list->count;
+    memcpy(query + 2, list->ids, list->count);
+    oi_uartReceiveDma(response, list->responseLength);
+    oi_uartSendFrame(query, list->count + 2, OI_LANE_NORMAL);
+    oi_uartWaitDma();
 
-    self->virtualWall = packet[6];
+    decoded = oi_packets_decodeList(self, list, response, oi_packetsInUse);
+    oi_afterDecode(self, decoded);
 
-    self->overcurrentLeftWheel = !!(packet[7] & 0x10);
-    self->overcurrentRightWheel = !!(packet[7] & 0x08);
-    self->overcurrentMainBrush = !!(packet[7] & 0x04);
-    self->overcurrentSideBrush = packet[7] & 0x01;
+    // No wait here: the robot refreshes its sensors every 15ms, callers that
+    // loop faster than that just read the same values again.
+}
 
-    self->dirtDetect = packet[8];
+/// Choose which packets get decoded
+void oi_setPacketsInUse(uint64_t mask)
+{
+    oi_packetsInUse = mask;
+}
 
-    // Byte 9 unused
+/// Get the RX path ready for stream frames
+static void oi_prepareStream(void)
+{
+    oi_stream_init(&oi_stream);
+    ringbuf_init(&oi_rxBuffer, oi_rxStorage, OI_RX_BUFFER_SIZE);
 
-    self->infraredCharOmni = packet[10];
+    // Throw away anything left over from polled mode
+    while (!(UART4_FR_R & UART_FR_RXFE)) {
+        (void)UART4_DR_R;
+    }
 
-    self->buttonClock = !!(packet[11] & 0x80);
-    self->buttonSchedule = !!(packet[11] & 0x40);
-    self->buttonDay = !!(packet[11] & 0x20);
-    self->buttonHour = !!(packet[11] & 0x10);
-    self->buttonMinute = !!(packet[11] & 0x08);
-    self->buttonDock = !!(packet[11] & 0x04);
-    self->buttonSpot = !!(packet[11] & 0x02);
-    self->buttonClean = packet[11] & 0x01;
+    UART4_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+    oi_streaming = 1;
+    UART4_IM_R |= UART_IM_RXIM | UART_IM_RTIM; // FIFO level and RX timeout
+}
 
-    self->chargingState = packet[16];
-    self->batteryVoltage = oi_parseInt(packet + 17);
-    self->batteryCurrent = oi_parseInt(packet + 19);
-    self->batteryTemperature = packet[21];
-    self->batteryCharge = oi_parseInt(packet + 22);
-    self->batteryCapacity = oi_parseInt(packet + 24);
+/// Start streaming group 100, bytes are collected by oi_uartHandler()
+void oi_startStream(void)
+{
+    // opcode, number of packets, packet ids
+    const uint8_t stream[] = {OI_OPCODE_STREAM, 1, OI_SENSOR_PACKET_GROUP100};
 
-    self->wallSignal = oi_parseInt(packet + 26);
+    oi_prepareStream();
+    oi_uartSendFrame(stream, sizeof(stream), OI_LANE_NORMAL);
+}
 
-    self->cliffLeftSignal = oi_parseInt(packet + 28);
-    self->cliffFrontLeftSignal = oi_parseInt(packet + 30);
-    self->cliffFrontRightSignal = oi_parseInt(packet + 32);
-    self->cliffRightSignal = oi_parseInt(packet + 34);
+/// Start streaming only the packets of a query list
+void oi_startStreamList(const oi_queryList_t *list)
+{
+    uint8_t stream[OI_QUERY_MAX_PACKETS + 2];
 
-    // Bytes 36-38 unused
+    if (list->count == 0) {
+        return;
+    }
 
-    self->chargingSourcesAvailable = packet[39];
-    self->oiMode = packet[40];
+    stream[0] = OI_OPCODE_STREAM;
+    stream[1] = list->count;
+    memcpy(stream + 2, list->ids, list->count);
 
-    self->songNumber = packet[41];
-    self->songPlaying = packet[42];
+    oi_prepareStream();
+    oi_uartSendFrame(stream, list->count + 2, OI_LANE_NORMAL);
+}
 
-    self->numberOfStreamPackets = packet[43];
+/// Pause the stream and return to polled updates
+void oi_stopStream(void)
+{
+    const uint8_t pause[] = {OI_OPCODE_DO_STREAM, 0}; // 0 = pause
 
-    self->requestedVelocity = oi_parseInt(packet + 44);
-    self->requestedRadius = oi_parseInt(packet + 46);
-    self->requestedRightVelocity = oi_parseInt(packet + 48);
-    self->requestedLeftVelocity = oi_parseInt(packet + 50);
-    self->leftEncoderCount = oi_parseInt(packet + 52);
-    self->rightEncoderCount = oi_parseInt(packet + 54);
+    oi_uartSendFrame(pause, sizeof(pause), OI_LANE_NORMAL);
 
-    self->lightBumperRight = !!(packet[56] & 0x20);
-    self->lightBumperFrontRight = !!(packet[56] & 0x10);
-    self->lightBumperCenterRight = !!(packet[56] & 0x08);
-    self->lightBumperCenterLeft = !!(packet[56] & 0x04);
-    self->lightBumperFrontLeft = !!(packet[56] & 0x02);
-    self->lightBumperLeft = packet[56] & 0x01;
+    UART4_IM_R &= ~(UART_IM_RXIM | UART_IM_RTIM);
+    oi_streaming = 0;
+
+    // Let a frame that was already on the wire finish, then drop it
+    timer_waitMillis(15);
+    while (!(UART4_FR_R & UART_FR_RXFE)) {
+        (void)UART4_DR_R;
+    }
+}
 
-    self->lightBumpLeftSignal = oi_parseInt(packet + 57);
-    self->lightBumpFrontLeftSignal = oi_parseInt(packet + 59);
-    self->lightBumpCenterLeftSignal = oi_parseInt(packet + 61);
-    self->lightBumpCenterRightSignal = oi_parseInt(packet + 63);
-    self->lightBumpFrontRightSignal = oi_parseInt(packet + 65);
-    self->lightBumpRightSignal = oi_parseInt(packet + 67);
+int oi_isStreaming(void)
+{
+    return oi_streaming;
+}
 
-    self->infraredCharLeft = packet[69];
-    self->infraredCharRight = packet[70];
+/**
+ * Decode everything the UART4 interrupt has buffered since the last call.
+ * Only the newest complete frame is parsed so the encoder based distance and
+ * angle cover the whole time since the previous update.
+ *
+ * @param self sensor struct to update
+ * @return 1 if self was updated with a new frame, 0 if nothing new arrived
+ */
+int oi_streamUpdate(oi_t *self)
+{
+    uint8_t latest[OI_STREAM_MAX_PAYLOAD];
+    uint8_t latestLength = 0;
+    uint64_t decoded;
+    uint8_t byte;
+
+    while (ringbuf_get(&oi_rxBuffer, &byte)) {
+        if (oi_stream_feed(&oi_stream, byte)) {
+            latestLength = oi_stream.length;
+            memcpy(latest, oi_stream.payload, latestLength);
+        }
+    }
 
-    self->leftMotorCurrent = oi_parseInt(packet + 71);
-    self->rightMotorCurrent = oi_parseInt(packet + 73);
-    self->mainBrushMotorCurrent = oi_parseInt(packet + 75);
-    self->sideBrushMotorCurrent = oi_parseInt(packet + 77);
+    if (latestLength == 0) {
+        return 0;
+    }
 
-    self->stasis = packet[79];
+    decoded = oi_packets_decodeStream(self, latest, latestLength, oi_packetsInUse);
+    oi_afterDecode(self, decoded);
 
-    self->distance = oi_getDistance(self);
-    self->angle = oi_getDegrees(self);
+    return 1;
 }
 
-inline int16_t oi_parseInt(uint8_t *theInt)
+/// UART4 interrupt, moves received bytes from the FIFO into oi_rxBuffer and
+/// queued commands into the TX FIFO. Also reports uDMA reads as done.
+void oi_uartHandler(void)
 {
-    return (theInt[0] << 8) | theInt[1];
+    udma_service(1UL << UDMA_CH_UART4_RX);
+
+    if (UART4_MIS_R & UART_MIS_TXMIS) {
+        UART4_ICR_R = UART_ICR_TXIC;
+        oi_uartTxPump();
+    }
+
+    if (UART4_MIS_R & (UART_MIS_RXMIS | UART_MIS_RTMIS)) {
+        UART4_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+
+        while (!(UART4_FR_R & UART_FR_RXFE)) {
+            // Bytes with framing/overrun errors are kept, the frame checksum
+            // rejects them
+            ringbuf_put(&oi_rxBuffer, UART4_DR_R & 0xFF);
+        }
+    }
+}
+
+void oi_parsePacket(oi_t *self, uint8_t packet[])
+{
+    oi_afterDecode(self, oi_packets_decodeGroup100(self, packet, oi_packetsInUse));
+}
+
+static void oi_afterDecode(oi_t *self, uint64_t decoded)
+{
+    if ((decoded & OI_ENCODER_PACKETS) == OI_ENCODER_PACKETS) {
+        oi_odometryUpdate(self);
+    }
 }
 
 /// \brief Set the LEDS on the Create
@@ -301,17 +444,21 @@ inline int16_t oi_parseInt(uint8_t *theInt)
 /// \param power_intensity (0-255) 0=off, 255=full intensity
 void oi_setLeds(uint8_t play_led, uint8_t advance_led, uint8_t power_color, uint8_t power_intensity)
 {
+    uint8_t leds[4];
+
     // LED Opcode
-    oi_uartSendChar(OI_OPCODE_LEDS);
+    leds[0] = OI_OPCODE_LEDS;
 
     // Set the Play and Advance LEDs
-    oi_uartSendChar(advance_led << 3 && play_led << 2);
+    leds[1] = advance_led << 3 && play_led << 2;
 
     // Set the power led color
-    oi_uartSendChar(power_color);
+    leds[2] = power_color;
 
     // Set the power led intensity
-    oi_uartSendChar(power_intensity);
+    leds[3] = power_intensity;
+
+    oi_uartSendFrame(leds, sizeof(leds), OI_LANE_NORMAL);
 }
 
 /// \brief Set direction and speed of the robot's wheels
@@ -319,13 +466,18 @@ void oi_setLeds(uint8_t play_led, uint8_t advance_led, uint8_t power_color, uint
 /// \param linear velocity in mm/s values range from -500 -> 500 of left wheel
 void oi_setWheels(int16_t right_wheel, int16_t left_wheel)
 {
+    uint8_t drive[5];
+
     right_wheel = right_wheel * motor_cal_factor_R;
     left_wheel = left_wheel * motor_cal_factor_L;
-    oi_uartSendChar(OI_OPCODE_DRIVE_WHEELS);
-    oi_uartSendChar(right_wheel >> 8);
-    oi_uartSendChar(right_wheel & 0xff);
-    oi_uartSendChar(left_wheel >> 8);
-    oi_uartSendChar(left_wheel & 0xff);
+    drive[0] = OI_OPCODE_DRIVE_WHEELS;
+    drive[1] = right_wheel >> 8;
+    drive[2] = right_wheel & 0xff;
+    drive[3] = left_wheel >> 8;
+    drive[4] = left_wheel & 0xff;
+
+    // Drive commands skip ahead of queued songs and LEDs
+    oi_uartSendFrame(drive, sizeof(drive), OI_LANE_PREEMPT);
 }
 
 /// \brief Load song sequence
@@ -335,20 +487,52 @@ void oi_setWheels(int16_t right_wheel, int16_t left_wheel)
 /// \param A pointer to a sequence of durations that correspond to the notes
 void oi_loadSong(int song_index, int num_notes, unsigned char *notes, unsigned char *duration)
 {
+    uint8_t song[3 + 2 * 16];
     int i;
-    oi_uartSendChar(OI_OPCODE_SONG);
-    oi_uartSendChar(song_index);
-    oi_uartSendChar(num_notes);
+
+    if (num_notes > 16) {
+        num_notes = 16;
+    }
+
+    song[0] = OI_OPCODE_SONG;
+    song[1] = song_index;
+    song[2] = num_notes;
     for (i = 0; i < num_notes; i++) {
-        oi_uartSendChar(notes[i]);
-        oi_uartSendChar(duration[i]);
+        song[3 + 2 * i] = notes[i];
+        song[4 + 2 * i] = duration[i];
     }
+
+    oi_uartSendFrame(song, 3 + 2 * num_notes, OI_LANE_NORMAL);
 }
 
 /// Plays a given song; use oi_load_song(...) first
 void oi_play_song(int index) {
-    oi_uartSendChar(OI_OPCODE_PLAY);
-    oi_uartSendChar(index);
+    uint8_t play[2];
+
+    play[0] = OI_OPCODE_PLAY;
+    play[1] = index;
+    oi_uartSendFrame(play, sizeof(play), OI_LANE_NORMAL);
+}
+
+void oi_loadScript(const uint8_t script[], uint8_t length)
+{
+    uint8_t frame[2 + OI_SCRIPT_LIMIT];
+
+    if (length > OI_SCRIPT_LIMIT) {
+        return;
+    }
+
+    frame[0] = OI_OPCODE_SCRIPT;
+    frame[1] = length;
+    memcpy(frame + 2, script, length);
+    oi_uartSendFrame(frame, length + 2, OI_LANE_NORMAL);
+}
+
+void oi_playScript(void)
+{
+    const uint8_t play = OI_OPCODE_PLAY_SCRIPT;
+
+    oi_uartSendFrame(&play, 1, OI_LANE_NORMAL);
 }
 
 /// Runs default go charge program; robot will search for dock
@@ -373,11 +557,11 @@ void go_charge(void) {
 /// internal function
 void oi_uartInit(void)
 {
-    // Calculated Baudrate for 115200;
-    uint16_t iBRD = 0x08; // BRD=SYSCLK/((ClkDiv)(BaudRate)), HSE=0 ClkDiv=16,
-                          // BaudRate=115,200
-    uint16_t fBRD =
-        44; // Fractional remainder is 0.6805, DIVFRAC = (.6805)(64)+0.5 = 44
+    // Baudrate for 115200: BRD=SYSCLK/((ClkDiv)(BaudRate)), HSE=0 ClkDiv=16,
+    // DIVFRAC = (fraction)(64)+0.5. 8 + 44/64 at 16MHz, 43 + 26/64 at 80MHz
+    uint32_t divisor = clock_baudDivisor(115200);
+    uint16_t iBRD = divisor >> 6;
+    uint16_t fBRD = divisor & 0x3F;
 
     SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R2; // enable GPIO Port C
 
@@ -395,8 +579,22 @@ void oi_uartInit(void)
     UART4_IBRD_R = iBRD;
     UART4_FBRD_R = fBRD;
 
-    UART4_LCRH_R = UART_LCRH_WLEN_8; // 8 bit, 1 stop, no parity, no FIFO
+    UART4_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // 8 bit, 1 stop, no parity, FIFO
     UART4_CC_R = UART_CC_CS_SYSCLK;  // Use System Clock
+
+    ringbuf_init(&oi_txBuffer, oi_txStorage, OI_TX_BUFFER_SIZE);
+    ringbuf_init(&oi_txPreemptBuffer, oi_txPreemptStorage, OI_TX_PREEMPT_BUFFER_SIZE);
+    oi_txRemaining = 0;
+
+    // RX interrupts are only unmasked while streaming, see oi_startStream().
+    // TX interrupts are unmasked while queued commands are waiting.
+    UART4_IFLS_R = UART_IFLS_RX4_8 | UART_IFLS_TX4_8;
+    UART4_IM_R = 0;
+    udma_init();
+    udma_assignChannel(UDMA_CH_UART4_RX, UDMA_ENC_UART4);
+    IntRegister(INT_UART4, oi_uartHandler);
+    NVIC_PRI15_R = (NVIC_PRI15_R & ~NVIC_PRI15_INTA_M) | (1 << NVIC_PRI15_INTA_S);
+    NVIC_EN1_R |= (1 << 28); // UART4 is IRQ 60
     UART4_CTL_R = UART_CTL_RXE | UART_CTL_TXE |
                   UART_CTL_UARTEN; // Enable Rx, Tx and UART module
 }
@@ -405,12 +603,106 @@ void oi_uartInit(void)
 /// internal function
 void oi_uartSendChar(char data)
 {
-    while ((UART4_FR_R & UART_FR_TXFF) != 0); // holds until no data in transmit buffer
+    // Goes through the queue so it stays in order with queued frames
+    oi_uartSendFrame((const uint8_t *)&data, 1, OI_LANE_NORMAL);
+}
+
+/**
+ * Move queued bytes into the TX FIFO until it is full or both lanes are empty.
+ * A new frame is only started once the previous one is complete, and the
+ * preempt lane is always checked first. Runs in the UART4 interrupt, or with
+ * interrupts disabled from oi_uartSendFrame()/oi_uartFlush().
+ */
+static void oi_uartTxPump(void)
+{
+    uint8_t byte;
+
+    while (!(UART4_FR_R & UART_FR_TXFF)) {
+        if (oi_txRemaining == 0) {
+            if (ringbuf_get(&oi_txPreemptBuffer, &oi_txRemaining)) {
+                oi_txLane = &oi_txPreemptBuffer;
+            } else if (ringbuf_get(&oi_txBuffer, &oi_txRemaining)) {
+                oi_txLane = &oi_txBuffer;
+            } else {
+                // Nothing left, no need for TX interrupts until the next frame
+                UART4_IM_R &= ~UART_IM_TXIM;
+                return;
+            }
+        }
+
+        ringbuf_get(oi_txLane, &byte);
+        UART4_DR_R = byte;
+        oi_txRemaining--;
+    }
+
+    // FIFO full, continue when it drains below the TX trigger level
+    UART4_IM_R |= UART_IM_TXIM;
+}
+
+static void oi_uartSendFrame(const uint8_t frame[], uint8_t length, int lane)
+{
+    ringbuf_t *rb = (lane == OI_LANE_PREEMPT) ? &oi_txPreemptBuffer : &oi_txBuffer;
+    bool wasDisabled;
+    uint8_t i;
+
+    // Interrupts are off while the frame is copied so a command sent from an
+    // ISR (like oi_close() from the shutoff button) cannot land in the middle
+    wasDisabled = IntMasterDisable();
+
+    while (ringbuf_space(rb) < length + 1) {
+        // Queue full; push bytes out by hand since this may be running inside
+        // an ISR that the UART4 interrupt cannot preempt
+        oi_uartTxPump();
+    }
+
+    ringbuf_put(rb, length);
+    for (i = 0; i < length; i++) {
+        ringbuf_put(rb, frame[i]);
+    }
+
+    // Start sending right away, the TX interrupt takes over once the FIFO fills
+    oi_uartTxPump();
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
+
+static void oi_uartFlush(void)
+{
+    bool wasDisabled = IntMasterDisable();
+
+    while (oi_txRemaining || ringbuf_count(&oi_txPreemptBuffer) ||
+           ringbuf_count(&oi_txBuffer)) {
+        oi_uartTxPump();
+    }
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+
+    while (UART4_FR_R & UART_FR_BUSY); // last byte shifted out
+}
+
+static void oi_rxDmaComplete(uint8_t channel, void *buffer, uint16_t length)
+{
+    UART4_DMACTL_R &= ~UART_DMACTL_RXDMAE; // stream mode reads the FIFO itself
+    oi_rxDmaDone = 1;
+}
 
-    UART4_DR_R = data; // puts data in transmission buffer
+static void oi_uartReceiveDma(uint8_t buffer[], uint16_t length)
+{
+    oi_rxDmaDone = 0;
+    udma_startRx(UDMA_CH_UART4_RX, (volatile uint32_t *)&UART4_DR_R, buffer, length,
+                 oi_rxDmaComplete);
+    UART4_DMACTL_R |= UART_DMACTL_RXDMAE;
+}
 
-    // For debugging
-    // timer_waitMicros(1000);
+static void oi_uartWaitDma(void)
+{
+    while (!oi_rxDmaDone) {
+        oi_sleep();
+    }
 }
 
 char oi_uartReceive(void)
@@ -441,11 +733,7 @@ void oi_uartSendStr(const char *theData)
 
 void oi_uartSendBuff(const uint8_t theData[], uint8_t theSize)
 {
-    int i;
-
-    for (i = 0; i < theSize; i++) {
-        oi_uartSendChar(theData[i]);
-    }
+    oi_uartSendFrame(theData, theSize, OI_LANE_NORMAL);
 }
 
 char *oi_checkFirmware()
@@ -515,88 +803,6 @@ void GPIOF_Handler(void)
     }
 }
 
-/**
- * Get the moved degrees from the previous call of oi_update
- * @author Isaac Rex
- *
- * @param self oi sensor
- */
-static double oi_getDegrees(oi_t *self)
-{
-    return oi_getRadians(self) * 180.00 / M_PI;
-}
-
-/**
- * @brief Get the moved radians from the previous call of oi_update
- * @author Isaac Rex
- *
- * @param self Sensor data pointer
- * @return double number of radians turned since last call of oi_update
- */
-static double oi_getRadians(oi_t *self)
-{
-    static int first_pass = 1;
-    static int prevLeft = 0;
-    static int prevRight = 0;
-
-    if ((self->leftEncoderCount == prevLeft) &&
-        (self->rightEncoderCount == prevRight)) {
-        prevLeft = self->leftEncoderCount;
-        prevRight = self->rightEncoderCount;
-        return 0;
-    }
-    // ignore the first run, such that we do not have prevLeft or right=0, this
-    // would give a very large degree moved.
-    else if (first_pass) {
-        // Gets processed durint oi_init()
-        prevLeft = self->leftEncoderCount;
-        prevRight = self->rightEncoderCount;
-        first_pass = 0;
-        return 0;
-    }
-
-    // get distance moved in mm for the left and right wheel
-    // equation: ticks * (1/508.8)*72pi
-    int16_t leftEncoderDiff = self->leftEncoderCount - prevLeft;
-    int16_t rightEncoderDiff = self->rightEncoderCount - prevRight;
-    // 508.8 encoder ticks per wheel revolution, wheel is 72π mm diameter
-    double distLeft = (leftEncoderDiff) * (72.00 * M_PI / 508.8);
-    double distRight = (rightEncoderDiff) * (72.00 * M_PI / 508.8);
-    prevLeft = self->leftEncoderCount;
-    prevRight = self->rightEncoderCount;
-
-    // Radians = (distanceRight - distanceLeft) / wheel-base (per datatsheet)
-    double radians = (distRight - distLeft) / 235.00;
-    return (radians);
-}
-
-/**
- * @brief Returns the average distance traveled by each wheel since the last
- * call to oi_update
- * @author Isaac Rex
- *
- * @param self oi sensor
- * @return double average distance travled by each wheel since last call to oi_update()
- */
-static double oi_getDistance(oi_t *self)
-{
-    static int prevLeft = 0;
-    static int prevRight = 0;
-
-    // get distance moved in mm for the left and right wheel
-    // equation: ticks * (1/508.8)*72pi
-    // update the previous values to be correct
-    int16_t leftEncoderDiff = self->leftEncoderCount - prevLeft;
-    int16_t rightEncoderDiff = self->rightEncoderCount - prevRight;
-    double distLeft = (leftEncoderDiff) * (72 * M_PI / 508.8);
-    double distRight = (rightEncoderDiff) * (72 * M_PI / 508.8);
-    prevLeft = self->leftEncoderCount;
-    prevRight = self->rightEncoderCount;
-
-    // Total distance is average of both wheels' distance
-    return (distLeft + distRight) / 2.00;
-}
-
 /**
  * @brief Sets the calibration factor for each of the motors. Defualt is 1
  * @author Isaac Rex
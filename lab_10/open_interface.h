@@ -22,6 +22,10 @@
 #include "Timer.h"
 #include <inc/tm4c123gh6pm.h>
 #include "lcd.h"
+#include "ringbuf.h"
+#include "oi_stream.h"
+#include "oi_sensors.h"
+#include "oi_odometry.h"
 
 
 #define M_PI 3.14159265358979323846
@@ -34,101 +38,6 @@
 #define BIT6        0x40
 #define BIT7        0x80
 
-/// iRobot Create Sensor Data
-typedef struct {
-    //Boolean sensor values
-    uint32_t wheelDropLeft : 1;
-    uint32_t wheelDropRight : 1;
-    uint32_t bumpLeft : 1;
-    uint32_t bumpRight : 1;
-    uint32_t cliffLeft : 1;
-    uint32_t cliffFrontLeft : 1;
-    uint32_t cliffFrontRight : 1;
-    uint32_t cliffRight : 1;
-
-    uint32_t lightBumperRight : 1;
-    uint32_t lightBumperFrontRight : 1;
-    uint32_t lightBumperCenterRight : 1;
-    uint32_t lightBumperCenterLeft : 1;
-    uint32_t lightBumperFrontLeft : 1;
-    uint32_t lightBumperLeft : 1;
-
-    uint32_t wallSensor : 1;
-    uint32_t virtualWall : 1;
-
-    uint32_t overcurrentLeftWheel : 1;
-    uint32_t overcurrentRightWheel : 1;
-    uint32_t overcurrentMainBrush : 1;
-    uint32_t overcurrentSideBrush : 1;
-
-    uint32_t buttonClock : 1;
-    uint32_t buttonSchedule : 1;
-    uint32_t buttonDay : 1;
-    uint32_t buttonHour : 1;
-    uint32_t buttonMinute : 1;
-    uint32_t buttonDock : 1;
-    uint32_t buttonSpot : 1;
-    uint32_t buttonClean : 1;
-
-    //Cliff sensors
-    uint16_t cliffLeftSignal;
-    uint16_t cliffFrontLeftSignal;
-    uint16_t cliffFrontRightSignal;
-    uint16_t cliffRightSignal;
-
-    //Light bump sensors
-    uint16_t lightBumpLeftSignal;
-    uint16_t lightBumpFrontLeftSignal;
-    uint16_t lightBumpCenterLeftSignal;
-    uint16_t lightBumpCenterRightSignal;
-    uint16_t lightBumpFrontRightSignal;
-    uint16_t lightBumpRightSignal;
-
-    //Misc sensors
-    uint16_t wallSignal;
-    uint8_t dirtDetect;
-
-    //Power
-    int16_t leftMotorCurrent;
-    int16_t rightMotorCurrent;
-    int16_t mainBrushMotorCurrent;
-    int16_t sideBrushMotorCurrent;
-
-    //Motion sensors
-    double distance;
-    double angle;
-    int8_t requestedVelocity;
-    int8_t requestedRadius;
-    int16_t requestedRightVelocity;
-    int16_t requestedLeftVelocity;
-    int16_t leftEncoderCount;
-    int16_t rightEncoderCount;
-
-    //Information from the infrared beacon sensors
-    char infraredCharOmni;
-    char infraredCharLeft;
-    char infraredCharRight;
-
-    //Battery information
-    uint8_t chargingState;
-    uint8_t chargingSourcesAvailable;
-    uint16_t batteryVoltage;
-    int16_t batteryCurrent;
-    uint8_t batteryTemperature;
-    uint16_t batteryCharge;
-    uint16_t batteryCapacity;
-
-    //Music
-    uint8_t songNumber;
-    uint8_t songPlaying;
-
-    //Misc
-    uint8_t oiMode;
-    uint8_t numberOfStreamPackets;
-    uint8_t stasis;
-
-} oi_t;
-
 
 ///Allocate and clear all memory for OI Struct
 oi_t * oi_alloc();
@@ -145,6 +54,40 @@ void oi_close();
 ///Update sensor data
 void oi_update(oi_t *self);
 
+/// \brief Query only the packets in list and update just those fields of self
+/// distance and angle are updated when both encoder packets are in the list.
+/// Does nothing while the sensor stream is running.
+void oi_updateList(oi_t *self, const oi_queryList_t *list);
+
+/// \brief Only decode the packets in mask, all others keep their last value
+/// e.g. OI_PACKET_BIT(OI_PACKET_BUMPS_WHEELDROPS) |
+/// OI_PACKET_BIT(OI_PACKET_LEFT_ENCODER) | OI_PACKET_BIT(OI_PACKET_RIGHT_ENCODER).
+/// distance, angle and the pose need both encoder packets. Default is
+/// OI_PACKETS_ALL.
+void oi_setPacketsInUse(uint64_t mask);
+
+/// \brief Stream the packets of a query list instead of group 100
+void oi_startStreamList(const oi_queryList_t *list);
+
+/// \brief Start streaming sensor group 100 every 15 ms (opcode 148)
+/// Received bytes are buffered by the UART4 interrupt; call oi_streamUpdate()
+/// to pick up the newest frame. While streaming, oi_update() waits for the next
+/// frame instead of querying the robot.
+void oi_startStream(void);
+
+/// Stop the sensor stream and go back to polled oi_update()
+void oi_stopStream(void);
+
+/// \brief Non-blocking: decode any buffered stream bytes into self
+/// \return 1 if a new sensor frame was parsed into self, 0 otherwise
+int oi_streamUpdate(oi_t *self);
+
+/// \brief Returns 1 while the sensor stream is running
+int oi_isStreaming(void);
+
+/// UART4 interrupt handler, buffers stream bytes
+void oi_uartHandler(void);
+
 /// \brief Set the LEDS on the Create
 /// \param play_led 0=off, 1=on
 /// \param advance_led 0=off, 1=on
@@ -169,6 +112,13 @@ void oi_loadSong(int song_index, int num_notes, unsigned char  *notes, unsigned
 /// \param An integer value from 0 - 15 that is a previously establish song index
 void oi_play_song(int index);
 
+/// \brief Store a script on the robot (opcode 152), see oi_script.h
+/// Only the original Create runs scripts, the Create 2 ignores these bytes.
+void oi_loadScript(const uint8_t script[], uint8_t length);
+
+/// \brief Run the stored script (opcode 153)
+void oi_playScript(void);
+
 /// Calls in built in demo to send the iRobot to an open home base
 /// This will cause the iRobot to enter the Passive state
 void go_charge(void);
@@ -181,15 +131,6 @@ void oi_shutoff_init(void);
 //used to handle interrupt to shut off OI
 void GPIOF_Handler(void);
 
-//used to get the current moved degrees from encoder count
-static double oi_getDegrees(oi_t *self);
-
-// Get the number of radians moved since last call
-static double oi_getRadians(oi_t *self);
-
-// Gets the distance moved since the last call to getDistance
-static double oi_getDistance(oi_t *self);
-
 // Sets the calibration factor for the motors. Defualt is 1
 void oi_setMotorCalibration(double left, double right);
 
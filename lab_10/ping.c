@@ -1,6 +1,17 @@
 #include "ping.h"
 #include "Timer.h"
 #include "lcd.h"
+#include "clock.h"
+#include "profile.h"
+#include "power.h"
+#include "oneshot.h"
+
+// Low time before and high time of the trigger pulse (5 us typical)
+#define PING_PULSE_NANOS 5000
+
+// Longest sleep between checks for the echo. The capture interrupt wakes us
+// right away; this only bounds the wait if the echo lands just before the WFI.
+#define PING_SLEEP_MICROS 1000
 
 volatile unsigned long START_TIME = 0;
 volatile unsigned long END_TIME = 0;
@@ -8,6 +19,9 @@ volatile enum{LOW, HIGH, DONE} STATE = LOW;
 int count = 0;
 bool intflag = true;
 
+static void ping_triggerHigh(void);
+static void ping_triggerEnd(void);
+
 void ping_init (void){
 
     SYSCTL_RCGCGPIO_R |= 0x02;
@@ -38,17 +52,33 @@ void ping_init (void){
     TIMER3_CTL_R |= 0x100;
 }
 
+/// Run the next step of the trigger pulse PING_PULSE_NANOS from now, from the
+/// TIMER2A one-shot, or right here after a busy wait if it is in use
+static void ping_after(void (*step)(void)){
+    if (!oneshot_start(PING_PULSE_NANOS, step)) {
+        timer_waitNanos(PING_PULSE_NANOS);
+        step();
+    }
+}
+
 void ping_trigger (void){
     STATE = LOW;
     TIMER3_CTL_R &= ~0x100;
-    TIMER3_IMR_R = ~0x400;
+    TIMER3_IMR_R &= ~0x400;
     GPIO_PORTB_AFSEL_R &= ~0x08;
     GPIO_PORTB_DIR_R |= 0x08;
 
     GPIO_PORTB_DATA_R &= ~0x08;
-    timer_waitMicros(5);
+    ping_after(ping_triggerHigh); // returns before the pulse is sent
+}
+
+static void ping_triggerHigh(void){
     GPIO_PORTB_DATA_R |= 0x08;
-    timer_waitMicros(5);
+    ping_after(ping_triggerEnd);
+}
+
+/// Pulse sent, hand the pin back to TIMER3B to time the echo
+static void ping_triggerEnd(void){
     GPIO_PORTB_DATA_R &= ~0x08;
 
     GPIO_PORTB_DIR_R &= ~0x08;
@@ -76,8 +106,11 @@ void TIMER3B_Handler(void){
 }
 
 float ping_getDistance (void){
+    PROFILE_BEGIN(PROFILE_PING);
     ping_trigger();
-    while (STATE != DONE) {}; //wait for pulse
+    while (STATE != DONE) { //wait for pulse
+        power_sleepUntil(timer_getMicros64() + PING_SLEEP_MICROS);
+    }
     float timeDif = 0; //width
     int overflow = (END_TIME > START_TIME);
     if (START_TIME > END_TIME) {
@@ -90,8 +123,9 @@ float ping_getDistance (void){
 //        lcd_printf("Distance Cm: %.2f \nOverflow: %d \nWidth: %d", timeDif, count, START_TIME-END_TIME);
 
     }
-    timeDif /= 16000000;
+    timeDif /= clock_getHz();
     timeDif = (timeDif/2)*343*100;
 //    lcd_printf("Distance Cm: %.2f \nOverflow: %d \nWidth: %d", timeDif, count, START_TIME-END_TIME);
+    PROFILE_END(PROFILE_PING);
     return timeDif;
 }
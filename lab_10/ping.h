@@ -8,6 +8,8 @@
 
 void ping_init(void);
 
+/// Start a reading and return; the trigger pulse is finished by the TIMER2A
+/// one-shot and the echo timed by TIMER3B
 void ping_trigger(void);
 
 void TIMER3B_Handler(void);
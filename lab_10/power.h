@@ -0,0 +1,74 @@
+/*
+ * power.h
+ *
+ * Sleeping instead of spinning. power_sleepUntil() puts the core to sleep
+ * (WFI) until the WTIMER5 match at a deadline or any other interrupt, and
+ * keeps count of the time spent asleep so the idle share of a run can be
+ * reported.
+ *
+ * Waiting for something an interrupt sets needs the check and the sleep under
+ * one lock; otherwise an interrupt that comes in after the check is served
+ * before the sleep and nothing wakes it:
+ *
+ *     bool was = power_lock();
+ *     while (!done) {
+ *         power_sleepLocked(POWER_FOREVER);
+ *     }
+ *     power_unlock(was);
+ *
+ * With power_init() the clocks of peripherals that are not needed while the
+ * core sleeps (the ADC) are stopped during sleep; everything a driver turned
+ * on keeps running. Peripherals no driver turned on stay off, as they are out
+ * of reset.
+ *
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Deadline for power_sleepUntil() that only an interrupt ends
+#define POWER_FOREVER 0xFFFFFFFFFFFFFFFFULL
+
+/// Turn on sleep mode clock gating and start counting idle time
+void power_init(void);
+
+/// \brief Sleep until timer_getMicros64() reaches micros or an interrupt fires
+/// Returns at once if micros already passed. Interrupts are served after the
+/// wake up, before this returns. Safe for deadlines; a wait on an interrupt
+/// set flag either re-checks within a bounded micros or uses power_lock().
+void power_sleepUntil(uint64_t micros);
+
+/// Sleep until the next interrupt. Only for callers that get woken anyway,
+/// like the rtos idle thread, whose wake up pends PendSV, or the sched idle
+/// hook, which is called under the lock after its last check.
+void power_idle(void);
+
+/// Mask interrupts for a check followed by power_sleepLocked(). Returns the
+/// previous state for power_unlock().
+bool power_lock(void);
+
+/// \brief Sleep like power_sleepUntil() with power_lock() held
+/// Interrupts that woke the core are served before this returns, still under
+/// the lock, so the caller's next check sees what they did. Not for ISRs.
+void power_sleepLocked(uint64_t micros);
+
+/// Undo power_lock()
+void power_unlock(bool wasDisabled);
+
+/// Microseconds spent asleep since power_init() or power_resetStats()
+uint64_t power_idleMicros(void);
+
+/// Share of the time since power_init() or power_resetStats() spent asleep
+uint8_t power_idlePercent(void);
+
+/// Start a new measurement window
+void power_resetStats(void);
+
+/// \brief Print the idle share over UART1:
+/// IDLE <percent> <idle us> <total us>
+void power_dump(void);
+
+#endif /* POWER_H_ */
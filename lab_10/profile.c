@@ -0,0 +1,115 @@
+/*
+ * profile.c
+ *
+ * DWT cycle counter zones, see profile.h.
+ *
+ */
+
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+#include <string.h>
+#include "uart.h"
+#include "clock.h"
+#include "fmt.h"
+
+// Debug and trace registers
+#define PROFILE_DEMCR (*((volatile uint32_t *)0xE000EDFC))
+#define PROFILE_DEMCR_TRCENA 0x01000000
+#define PROFILE_DWT_CTRL (*((volatile uint32_t *)0xE0001000))
+#define PROFILE_DWT_CTRL_CYCCNTENA 0x00000001
+#define PROFILE_DWT_LAR (*((volatile uint32_t *)0xE0001FB0))
+#define PROFILE_DWT_UNLOCK 0xC5ACCE55
+
+static const char *const profile_names[PROFILE_ZONE_COUNT] = {
+    "oi_update",
+    "lcd_printf",
+    "adc_read",
+    "ping_getDistance",
+    "scan",
+};
+
+static profile_stats_t profile_stats[PROFILE_ZONE_COUNT];
+
+void profile_init(void)
+{
+    PROFILE_DEMCR |= PROFILE_DEMCR_TRCENA;
+    PROFILE_DWT_LAR = PROFILE_DWT_UNLOCK;
+    PROFILE_CYCCNT = 0;
+    PROFILE_DWT_CTRL |= PROFILE_DWT_CTRL_CYCCNTENA;
+
+    profile_reset();
+}
+
+void profile_reset(void)
+{
+    memset(profile_stats, 0, sizeof(profile_stats));
+}
+
+void profile_record(profile_zone_t zone, uint32_t cycles)
+{
+    profile_stats_t *stats = &profile_stats[zone];
+    uint8_t bucket = 0;
+    uint32_t rest = cycles >> 2;
+
+    while (rest && bucket < PROFILE_HIST_BUCKETS - 1) {
+        rest >>= 2;
+        bucket++;
+    }
+
+    if (stats->count == 0 || cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->count++;
+    stats->total += cycles;
+    stats->hist[bucket]++;
+}
+
+const profile_stats_t *profile_get(profile_zone_t zone)
+{
+    return &profile_stats[zone];
+}
+
+void profile_dump(void)
+{
+    fmt_t f;
+    uint8_t zone;
+    uint8_t i;
+
+    fmt_sink(&f, uart_sendChar);
+
+    for (zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        const profile_stats_t *stats = &profile_stats[zone];
+
+        if (stats->count == 0) {
+            continue;
+        }
+
+        fmt_str(&f, "PROF ");
+        fmt_str(&f, profile_names[zone]);
+        fmt_char(&f, ' ');
+        fmt_uint(&f, stats->count, 0);
+        fmt_char(&f, ' ');
+        fmt_uint(&f, stats->min, 0);
+        fmt_char(&f, ' ');
+        fmt_uint(&f, stats->max, 0);
+        fmt_char(&f, ' ');
+        fmt_uint(&f, (uint32_t)(stats->total / stats->count), 0);
+        fmt_char(&f, ' ');
+        fmt_u64(&f, stats->total, 0);
+        fmt_char(&f, ' ');
+        fmt_uint(&f, clock_cyclesPerMicro(), 0);
+
+        for (i = 0; i < PROFILE_HIST_BUCKETS; i++) {
+            fmt_char(&f, ' ');
+            fmt_uint(&f, stats->hist[i], 0);
+        }
+        fmt_str(&f, "\r\n");
+    }
+}
+
+#endif
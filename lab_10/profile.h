@@ -0,0 +1,87 @@
+/*
+ * profile.h
+ *
+ * Cycle-accurate timing of code zones with the Cortex-M4 DWT cycle counter.
+ *
+ *     PROFILE_BEGIN(PROFILE_ADC_READ);
+ *     ... code to time ...
+ *     PROFILE_END(PROFILE_ADC_READ);
+ *
+ * Every zone keeps count, min, max, total and a histogram of its run times.
+ * profile_dump() prints them over UART1, one line per zone, for
+ * tools/profile_report.py to sort and render.
+ *
+ * Build with PROFILE_ENABLED set to 1 to turn it on. Otherwise the macros
+ * compile to nothing and profile.c is empty.
+ *
+ * Zones must not nest with themselves, and are meant for the main loop: a
+ * zone timed from an ISR can be torn by another one.
+ *
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 0
+#endif
+
+/// Zones, add new ones before PROFILE_ZONE_COUNT and name them in profile.c
+typedef enum {
+    PROFILE_OI_UPDATE,
+    PROFILE_LCD_PRINTF,
+    PROFILE_ADC_READ,
+    PROFILE_PING,
+    PROFILE_SCAN,
+    PROFILE_ZONE_COUNT
+} profile_zone_t;
+
+/// Histogram buckets, bucket i counts run times of 4^i to 4^(i+1) - 1 cycles
+#define PROFILE_HIST_BUCKETS 16
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;           // cycles
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROFILE_HIST_BUCKETS];
+} profile_stats_t;
+
+#if PROFILE_ENABLED
+
+/// DWT cycle counter
+#define PROFILE_CYCCNT (*((volatile uint32_t *)0xE0001004))
+
+#define PROFILE_BEGIN(zone) uint32_t profile_start_##zone = PROFILE_CYCCNT
+#define PROFILE_END(zone) profile_record(zone, PROFILE_CYCCNT - profile_start_##zone)
+
+/// Turn on the cycle counter and clear every zone
+void profile_init(void);
+
+/// Add one run time to a zone
+void profile_record(profile_zone_t zone, uint32_t cycles);
+
+/// Clear every zone
+void profile_reset(void);
+
+/// Statistics of a zone
+const profile_stats_t *profile_get(profile_zone_t zone);
+
+/// \brief Print every zone that ran over UART1:
+/// PROF <name> <count> <min> <max> <mean> <total> <cycles/us> <hist 0> ... <hist 15>
+void profile_dump(void);
+
+#else
+
+#define PROFILE_BEGIN(zone)
+#define PROFILE_END(zone)
+
+#define profile_init()
+#define profile_reset()
+#define profile_dump()
+
+#endif
+
+#endif /* PROFILE_H_ */
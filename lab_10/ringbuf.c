@@ -0,0 +1,61 @@
+/*
+ * ringbuf.c
+ *
+ * Lock-free SPSC byte ring buffer. head and tail are free running 16-bit
+ * counters; the difference between them is the fill level, so the whole
+ * buffer can be used without wasting a slot.
+ *
+ */
+
+#include "ringbuf.h"
+
+void ringbuf_init(ringbuf_t *rb, uint8_t *storage, uint16_t size)
+{
+    rb->data = storage;
+    rb->mask = size - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->dropped = 0;
+}
+
+void ringbuf_clear(ringbuf_t *rb)
+{
+    rb->tail = rb->head;
+}
+
+int ringbuf_put(ringbuf_t *rb, uint8_t byte)
+{
+    uint16_t head = rb->head;
+
+    if ((uint16_t)(head - rb->tail) > rb->mask) {
+        rb->dropped++;
+        return 0;
+    }
+
+    rb->data[head & rb->mask] = byte;
+    rb->head = head + 1; // publish only after the byte is stored
+    return 1;
+}
+
+int ringbuf_get(ringbuf_t *rb, uint8_t *byte)
+{
+    uint16_t tail = rb->tail;
+
+    if (tail == rb->head) {
+        return 0;
+    }
+
+    *byte = rb->data[tail & rb->mask];
+    rb->tail = tail + 1; // release the slot only after it was read
+    return 1;
+}
+
+uint16_t ringbuf_count(const ringbuf_t *rb)
+{
+    return (uint16_t)(rb->head - rb->tail);
+}
+
+uint16_t ringbuf_space(const ringbuf_t *rb)
+{
+    return (uint16_t)(rb->mask + 1) - ringbuf_count(rb);
+}
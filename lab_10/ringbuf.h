@@ -0,0 +1,44 @@
+/*
+ * ringbuf.h
+ *
+ * Lock-free single-producer/single-consumer byte ring buffer. One side
+ * (usually an ISR) only calls ringbuf_put(), the other side only calls
+ * ringbuf_get(), so neither needs to mask interrupts.
+ *
+ * Storage is supplied by the caller and its size must be a power of two.
+ * No hardware headers are used so the buffer can be exercised on the host.
+ *
+ */
+
+#ifndef RINGBUF_H_
+#define RINGBUF_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t *data;           // caller supplied storage
+    uint16_t mask;           // size - 1, size must be a power of two
+    volatile uint16_t head;  // next write index, owned by the producer
+    volatile uint16_t tail;  // next read index, owned by the consumer
+    volatile uint16_t dropped; // bytes lost because the buffer was full
+} ringbuf_t;
+
+/// Attach storage of the given size (power of two, max 32768) and empty the buffer
+void ringbuf_init(ringbuf_t *rb, uint8_t *storage, uint16_t size);
+
+/// Discard everything in the buffer. Only safe while the producer is idle.
+void ringbuf_clear(ringbuf_t *rb);
+
+/// Producer side: store one byte. Returns 0 and counts a drop if full.
+int ringbuf_put(ringbuf_t *rb, uint8_t byte);
+
+/// Consumer side: take one byte. Returns 0 if the buffer was empty.
+int ringbuf_get(ringbuf_t *rb, uint8_t *byte);
+
+/// Number of bytes waiting to be read
+uint16_t ringbuf_count(const ringbuf_t *rb);
+
+/// Number of bytes that can still be written
+uint16_t ringbuf_space(const ringbuf_t *rb);
+
+#endif /* RINGBUF_H_ */
@@ -0,0 +1,393 @@
+/*
+ * rtos.c
+ *
+ * Preemptive kernel, see rtos.h. Everything here runs with interrupts locked
+ * through rtos_port_lock(); a switch is only requested by setting rtos_next,
+ * the port performs it once the lock is released.
+ *
+ */
+
+#include "rtos_port.h"
+#include "rtos.h"
+
+#define RTOS_STACK_FILL 0xDEADBEEFUL
+
+// What a blocked thread waits for
+#define RTOS_WAIT_MUTEX 1
+#define RTOS_WAIT_RECEIVE 2
+#define RTOS_WAIT_SEND 3
+
+rtos_thread_t *volatile rtos_current = 0;
+rtos_thread_t *volatile rtos_next = 0;
+
+static rtos_thread_t *rtos_threads[RTOS_MAX_THREADS];
+static uint8_t rtos_threadCount = 0;
+static volatile uint32_t rtos_tickCount = 0;
+static uint8_t rtos_running = 0;
+static void (*rtos_idleHook)(void) = 0;
+
+static rtos_thread_t rtos_idle;
+static uint32_t rtos_idleStack[RTOS_IDLE_STACK_WORDS];
+
+/// \brief Pick the thread to run and request a switch if it changed
+/// \param rotate give other ready threads of the same priority a turn
+static void rtos_schedule(uint8_t rotate)
+{
+    rtos_thread_t *current = rtos_current;
+    rtos_thread_t *best = 0;
+    uint8_t start = 0;
+    uint8_t i;
+
+    if (!rtos_running) {
+        return;
+    }
+
+    for (i = 0; i < rtos_threadCount; i++) {
+        if (rtos_threads[i] == current) {
+            start = i;
+        }
+    }
+
+    if (!rotate && current->state == RTOS_READY) {
+        best = current;
+    }
+
+    // Look at the others first, starting after the current one, so a tie goes
+    // to whoever is next in line
+    for (i = 1; i <= rtos_threadCount; i++) {
+        rtos_thread_t *thread = rtos_threads[(start + i) % rtos_threadCount];
+
+        if (thread->state == RTOS_READY && (!best || thread->priority > best->priority)) {
+            best = thread;
+        }
+    }
+
+    // Never 0, the idle thread is always ready
+    rtos_next = best;
+    if (best != current) {
+        rtos_port_switch();
+    }
+}
+
+static void rtos_wake(rtos_thread_t *thread, int8_t result)
+{
+    thread->state = RTOS_READY;
+    thread->waitingOn = 0;
+    thread->timed = 0;
+    thread->result = result;
+}
+
+/// Highest priority thread blocked on object for kind, 0 if none
+static rtos_thread_t *rtos_findWaiter(const void *object, uint8_t kind)
+{
+    rtos_thread_t *best = 0;
+    uint8_t i;
+
+    for (i = 0; i < rtos_threadCount; i++) {
+        rtos_thread_t *thread = rtos_threads[i];
+
+        if (thread->state == RTOS_BLOCKED && thread->waitingOn == object &&
+            thread->waitKind == kind && (!best || thread->priority > best->priority)) {
+            best = thread;
+        }
+    }
+
+    return best;
+}
+
+/// \brief Block the running thread, called locked; returns unlocked
+/// \return RTOS_OK if it was woken, RTOS_TIMEOUT if the timeout ran out
+static int rtos_block(const void *object, uint8_t kind, uint32_t timeout, uint32_t lock)
+{
+    rtos_thread_t *self = rtos_current;
+
+    self->state = object ? RTOS_BLOCKED : RTOS_SLEEPING;
+    self->waitingOn = object;
+    self->waitKind = kind;
+    self->timed = timeout != RTOS_FOREVER;
+    self->wakeTick = rtos_tickCount + timeout;
+    self->result = RTOS_TIMEOUT;
+    rtos_schedule(0);
+    rtos_port_unlock(lock); // switches away here until woken
+
+    return self->result;
+}
+
+static void rtos_exit(void)
+{
+    uint32_t lock = rtos_port_lock();
+
+    rtos_current->state = RTOS_FINISHED;
+    rtos_schedule(0);
+    rtos_port_unlock(lock);
+
+    while (1);
+}
+
+static void rtos_idleThread(void *arg)
+{
+    while (1) {
+        if (rtos_idleHook) {
+            rtos_idleHook();
+        }
+    }
+}
+
+void rtos_init(void)
+{
+    rtos_threadCount = 0;
+    rtos_running = 0;
+    rtos_tickCount = 0;
+    rtos_threadCreate(&rtos_idle, rtos_idleThread, 0, rtos_idleStack,
+                      RTOS_IDLE_STACK_WORDS, 0);
+}
+
+int rtos_threadCreate(rtos_thread_t *thread, void (*entry)(void *), void *arg,
+                      uint32_t *stack, uint16_t stackWords, uint8_t priority)
+{
+    uint32_t lock;
+    uint16_t i;
+
+    if (stackWords < RTOS_MIN_STACK_WORDS && thread != &rtos_idle) {
+        return 0;
+    }
+
+    for (i = 0; i < stackWords; i++) {
+        stack[i] = RTOS_STACK_FILL;
+    }
+
+    thread->stack = stack;
+    thread->stackWords = stackWords;
+    thread->priority = priority;
+    thread->basePriority = priority;
+    thread->waitingOn = 0;
+    thread->timed = 0;
+    thread->sp = rtos_port_initStack(stack + stackWords, entry, arg, rtos_exit);
+
+    lock = rtos_port_lock();
+    if (rtos_threadCount == RTOS_MAX_THREADS) {
+        rtos_port_unlock(lock);
+        return 0;
+    }
+    thread->state = RTOS_READY;
+    rtos_threads[rtos_threadCount++] = thread;
+    rtos_schedule(0);
+    rtos_port_unlock(lock);
+
+    return 1;
+}
+
+void rtos_start(void)
+{
+    rtos_thread_t *best = &rtos_idle;
+    uint8_t i;
+
+    for (i = 0; i < rtos_threadCount; i++) {
+        if (rtos_threads[i]->priority > best->priority) {
+            best = rtos_threads[i];
+        }
+    }
+
+    rtos_port_lock();
+    rtos_next = best;
+    rtos_running = 1;
+    rtos_port_start();
+}
+
+rtos_thread_t *rtos_self(void)
+{
+    return rtos_current;
+}
+
+uint32_t rtos_ticks(void)
+{
+    return rtos_tickCount;
+}
+
+void rtos_sleep(uint32_t ticks)
+{
+    if (ticks == 0) {
+        rtos_yield();
+        return;
+    }
+
+    rtos_block(0, 0, ticks, rtos_port_lock());
+}
+
+void rtos_yield(void)
+{
+    uint32_t lock = rtos_port_lock();
+
+    rtos_schedule(1);
+    rtos_port_unlock(lock);
+}
+
+void rtos_setIdleHook(void (*idle)(void))
+{
+    rtos_idleHook = idle;
+}
+
+uint16_t rtos_stackUnused(const rtos_thread_t *thread)
+{
+    uint16_t unused = 0;
+
+    // The stack grows down, the untouched words are at the bottom
+    while (unused < thread->stackWords && thread->stack[unused] == RTOS_STACK_FILL) {
+        unused++;
+    }
+
+    return unused;
+}
+
+void rtos_tick(void)
+{
+    uint32_t lock = rtos_port_lock();
+    uint8_t i;
+
+    rtos_tickCount++;
+
+    for (i = 0; i < rtos_threadCount; i++) {
+        rtos_thread_t *thread = rtos_threads[i];
+
+        if ((thread->state == RTOS_SLEEPING || (thread->state == RTOS_BLOCKED && thread->timed)) &&
+            (int32_t)(rtos_tickCount - thread->wakeTick) >= 0) {
+            rtos_wake(thread, thread->state == RTOS_SLEEPING ? RTOS_OK : RTOS_TIMEOUT);
+        }
+    }
+
+    rtos_schedule(1);
+    rtos_port_unlock(lock);
+}
+
+void rtos_mutexInit(rtos_mutex_t *mutex)
+{
+    mutex->owner = 0;
+}
+
+int rtos_mutexLock(rtos_mutex_t *mutex, uint32_t timeout)
+{
+    uint32_t lock = rtos_port_lock();
+    rtos_thread_t *self = rtos_current;
+
+    // No thread to own it before rtos_start(), nor one to block
+    if (!rtos_running) {
+        rtos_port_unlock(lock);
+        return RTOS_ERROR;
+    }
+
+    if (!mutex->owner) {
+        mutex->owner = self;
+        rtos_port_unlock(lock);
+        return RTOS_OK;
+    }
+
+    if (timeout == 0) {
+        rtos_port_unlock(lock);
+        return RTOS_TIMEOUT;
+    }
+
+    // Priority inheritance: a middle priority thread must not keep the owner
+    // from getting to the unlock
+    if (mutex->owner->priority < self->priority) {
+        mutex->owner->priority = self->priority;
+    }
+
+    // On RTOS_OK the unlock already made this thread the owner
+    return rtos_block(mutex, RTOS_WAIT_MUTEX, timeout, lock);
+}
+
+int rtos_mutexUnlock(rtos_mutex_t *mutex)
+{
+    uint32_t lock = rtos_port_lock();
+    rtos_thread_t *self = rtos_current;
+    rtos_thread_t *waiter;
+
+    if (!rtos_running || mutex->owner != self) {
+        rtos_port_unlock(lock);
+        return RTOS_ERROR;
+    }
+
+    self->priority = self->basePriority;
+
+    waiter = rtos_findWaiter(mutex, RTOS_WAIT_MUTEX);
+    mutex->owner = waiter;
+    if (waiter) {
+        rtos_wake(waiter, RTOS_OK);
+    }
+
+    rtos_schedule(0);
+    rtos_port_unlock(lock);
+    return RTOS_OK;
+}
+
+void rtos_queueInit(rtos_queue_t *queue, uint32_t items[], uint16_t size)
+{
+    queue->items = items;
+    queue->size = size;
+    queue->head = 0;
+    queue->count = 0;
+}
+
+int rtos_queueSend(rtos_queue_t *queue, uint32_t message, uint32_t timeout)
+{
+    uint32_t lock = rtos_port_lock();
+    rtos_thread_t *receiver = rtos_findWaiter(queue, RTOS_WAIT_RECEIVE);
+
+    if (receiver) {
+        // Only possible while the queue is empty, hand it over directly
+        receiver->message = message;
+        rtos_wake(receiver, RTOS_OK);
+        rtos_schedule(0);
+    } else if (queue->count < queue->size) {
+        queue->items[(queue->head + queue->count) % queue->size] = message;
+        queue->count++;
+    } else if (timeout == 0 || !rtos_running) {
+        rtos_port_unlock(lock);
+        return RTOS_TIMEOUT;
+    } else {
+        // The receiver that makes room copies the message in
+        rtos_current->message = message;
+        return rtos_block(queue, RTOS_WAIT_SEND, timeout, lock);
+    }
+
+    rtos_port_unlock(lock);
+    return RTOS_OK;
+}
+
+int rtos_queueReceive(rtos_queue_t *queue, uint32_t *message, uint32_t timeout)
+{
+    uint32_t lock = rtos_port_lock();
+    rtos_thread_t *self = rtos_current;
+    rtos_thread_t *sender;
+    int result;
+
+    if (queue->count) {
+        *message = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->size;
+        queue->count--;
+
+        // Room again, take the message of a blocked sender
+        sender = rtos_findWaiter(queue, RTOS_WAIT_SEND);
+        if (sender) {
+            queue->items[(queue->head + queue->count) % queue->size] = sender->message;
+            queue->count++;
+            rtos_wake(sender, RTOS_OK);
+            rtos_schedule(0);
+        }
+
+        rtos_port_unlock(lock);
+        return RTOS_OK;
+    }
+
+    if (timeout == 0 || !rtos_running) {
+        rtos_port_unlock(lock);
+        return RTOS_TIMEOUT;
+    }
+
+    result = rtos_block(queue, RTOS_WAIT_RECEIVE, timeout, lock);
+    if (result == RTOS_OK) {
+        *message = self->message;
+    }
+
+    return result;
+}
@@ -0,0 +1,145 @@
+/*
+ * rtos.h
+ *
+ * Small preemptive kernel: fixed priority threads on caller supplied static
+ * stacks, round-robin between threads of equal priority on every SysTick,
+ * sleeping, mutexes with priority inheritance and message queues. Context
+ * switches happen in PendSV, so an ISR can wake a thread and the switch
+ * happens as soon as the ISR returns.
+ *
+ * The kernel itself (rtos.c) only talks to the hardware through rtos_port.h,
+ * so the scheduling rules can be built against another port, e.g. one that
+ * runs threads on a host; tools/rtos_port_pthread.c is one, and
+ * tools/rtos_test.c checks the kernel on it.
+ *
+ *     static uint32_t sweepStack[256];
+ *     static rtos_thread_t sweep;
+ *
+ *     rtos_init();
+ *     rtos_threadCreate(&sweep, sweep_thread, 0, sweepStack, 256, 2);
+ *     rtos_threadCreate(&drive, drive_thread, 0, driveStack, 256, 3);
+ *     rtos_start();   // does not return
+ *
+ * The drivers are not thread safe: share the LCD, UART and so on between
+ * threads through a mutex.
+ *
+ */
+
+#ifndef RTOS_H_
+#define RTOS_H_
+
+#include <stdint.h>
+
+#define RTOS_MAX_THREADS 8
+
+/// SysTick rate, sleeps and timeouts are in ticks
+#define RTOS_TICK_HZ 1000
+
+/// Timeout that never expires
+#define RTOS_FOREVER 0xFFFFFFFFUL
+
+/// Stack of the idle thread, in words
+#define RTOS_IDLE_STACK_WORDS 64
+
+/// Smallest stack rtos_threadCreate() accepts: room for a full context with
+/// the floating point registers and a little more
+#define RTOS_MIN_STACK_WORDS 96
+
+// Results of the blocking calls
+#define RTOS_OK 0
+#define RTOS_TIMEOUT (-1)
+#define RTOS_ERROR (-2)
+
+typedef enum {
+    RTOS_READY,
+    RTOS_SLEEPING,
+    RTOS_BLOCKED,
+    RTOS_FINISHED
+} rtos_state_t;
+
+typedef struct rtos_thread {
+    uint32_t *sp;               // saved stack pointer, must stay first (rtos_port.asm)
+    uint32_t *stack;            // lowest word of the stack
+    uint16_t stackWords;
+    uint8_t priority;           // current, raised while holding a contended mutex
+    uint8_t basePriority;
+    rtos_state_t state;
+    const void *waitingOn;      // mutex or queue while RTOS_BLOCKED
+    uint8_t waitKind;
+    uint8_t timed;              // wakeTick applies
+    int8_t result;              // RTOS_OK or RTOS_TIMEOUT for the last wait
+    uint32_t wakeTick;
+    uint32_t message;           // queue item being handed over
+} rtos_thread_t;
+
+typedef struct {
+    rtos_thread_t *owner;       // 0 when free
+} rtos_mutex_t;
+
+typedef struct {
+    uint32_t *items;            // caller supplied storage
+    uint16_t size;
+    uint16_t head;
+    uint16_t count;
+} rtos_queue_t;
+
+/// Set up the kernel and the idle thread, before any other call
+void rtos_init(void);
+
+/// \brief Add a thread, also allowed once the kernel runs
+/// \param stack caller owned, e.g. a static array; stackWords >=
+/// RTOS_MIN_STACK_WORDS
+/// \param priority higher numbers run first, 0 is the idle thread's
+/// \return 0 if RTOS_MAX_THREADS are in use or the stack is too small
+int rtos_threadCreate(rtos_thread_t *thread, void (*entry)(void *), void *arg,
+                      uint32_t *stack, uint16_t stackWords, uint8_t priority);
+
+/// \brief Start the SysTick and switch to the highest priority thread
+/// The caller's own stack is abandoned, this does not return.
+void rtos_start(void);
+
+/// Thread that is running
+rtos_thread_t *rtos_self(void);
+
+/// Ticks since rtos_start()
+uint32_t rtos_ticks(void);
+
+/// Block the calling thread for ticks SysTicks
+void rtos_sleep(uint32_t ticks);
+
+/// Let another ready thread of the same priority run
+void rtos_yield(void);
+
+/// Called by the idle thread in a loop, e.g. to sleep until the next interrupt
+void rtos_setIdleHook(void (*idle)(void));
+
+/// Words of a thread's stack that were never written, to size stacks
+uint16_t rtos_stackUnused(const rtos_thread_t *thread);
+
+void rtos_mutexInit(rtos_mutex_t *mutex);
+
+/// \brief Wait up to timeout ticks for the mutex, not from ISRs
+/// The owner runs at the waiter's priority until it unlocks. Holding more
+/// than one contended mutex at a time is not supported: the first unlock
+/// drops the owner back to its base priority.
+/// \return RTOS_OK, RTOS_TIMEOUT, or RTOS_ERROR before rtos_start()
+int rtos_mutexLock(rtos_mutex_t *mutex, uint32_t timeout);
+
+/// \brief Release a mutex held by the caller, the highest priority waiter gets it
+/// \return RTOS_ERROR if the caller is not the owner, or before rtos_start()
+int rtos_mutexUnlock(rtos_mutex_t *mutex);
+
+/// \param items storage for size messages
+void rtos_queueInit(rtos_queue_t *queue, uint32_t items[], uint16_t size);
+
+/// \brief Add a message, waiting up to timeout ticks for room
+/// From an ISR pass a timeout of 0.
+/// \return RTOS_OK, or RTOS_TIMEOUT if the queue stayed full
+int rtos_queueSend(rtos_queue_t *queue, uint32_t message, uint32_t timeout);
+
+/// \brief Take the oldest message, waiting up to timeout ticks for one
+/// From an ISR pass a timeout of 0.
+/// \return RTOS_OK, or RTOS_TIMEOUT if the queue stayed empty
+int rtos_queueReceive(rtos_queue_t *queue, uint32_t *message, uint32_t timeout);
+
+#endif /* RTOS_H_ */
@@ -0,0 +1,64 @@
+;
+; rtos_port.asm
+;
+; Context switch of the Cortex-M4F port, see rtos_port.h. A thread's saved
+; context sits on its own stack; rtos_thread_t.sp points at it.
+;
+
+        .thumb
+
+        .global rtos_current
+        .global rtos_next
+        .global __STACK_TOP
+        .global rtos_port_pendSvHandler
+        .global rtos_port_startFirst
+
+        .text
+
+currentAddr:    .word   rtos_current
+nextAddr:       .word   rtos_next
+stackTopAddr:   .word   __STACK_TOP
+
+; The hardware already pushed r0 - r3, r12, lr, pc and xPSR (and s0 - s15 if
+; the thread used the FPU). Push the rest, r4 - r11, EXC_RETURN and s16 - s31,
+; save the stack pointer in rtos_current, then undo all that for rtos_next.
+rtos_port_pendSvHandler: .asmfunc
+        CPSID   I
+        MRS     r0, PSP
+        TST     lr, #0x10               ; bit 4 clear: FPU context in the frame
+        IT      EQ
+        VSTMDBEQ r0!, {s16-s31}
+        STMDB   r0!, {r4-r11, lr}
+        LDR     r1, currentAddr
+        LDR     r2, [r1]
+        STR     r0, [r2]                ; rtos_current->sp
+
+        LDR     r3, nextAddr
+        LDR     r2, [r3]
+        STR     r2, [r1]                ; rtos_current = rtos_next
+        LDR     r0, [r2]
+        LDMIA   r0!, {r4-r11, lr}
+        TST     lr, #0x10
+        IT      EQ
+        VLDMIAEQ r0!, {s16-s31}
+        MSR     PSP, r0
+        CPSIE   I
+        BX      lr
+        .endasmfunc
+
+; void rtos_port_startFirst(uint32_t *stackTop)
+; Move thread mode onto the process stack at stackTop, give the interrupts the
+; whole main stack back and let the pending PendSV switch to the first thread.
+rtos_port_startFirst: .asmfunc
+        MSR     PSP, r0
+        MOVS    r0, #2                  ; CONTROL.SPSEL, FPCA cleared
+        MSR     CONTROL, r0
+        ISB
+        LDR     r1, stackTopAddr
+        MSR     MSP, r1
+        CPSIE   I
+startHalt:
+        B       startHalt               ; not reached
+        .endasmfunc
+
+        .end
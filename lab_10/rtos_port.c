@@ -0,0 +1,94 @@
+/*
+ * rtos_port.c
+ *
+ * Cortex-M4F port of the kernel, see rtos_port.h. Threads run on the process
+ * stack (PSP); interrupts and the kernel's own handlers keep the main stack.
+ * PendSV and SysTick run at the lowest priority, so a switch never interrupts
+ * another handler. Both are in the vector table of tm4c123gh6pm_startup_ccs.c.
+ *
+ */
+
+#include <stdbool.h>
+#include <inc/tm4c123gh6pm.h>
+#include "driverlib/interrupt.h"
+#include "clock.h"
+#include "rtos_port.h"
+
+// Thumb state bit of the initial xPSR
+#define RTOS_PORT_XPSR 0x01000000UL
+
+// EXC_RETURN: back to thread mode on the PSP, no floating point context
+#define RTOS_PORT_EXC_RETURN 0xFFFFFFFDUL
+
+// Where the old context goes on the first switch, enough for an exception
+// frame with floating point state
+static uint32_t rtos_port_startStack[64];
+static rtos_thread_t rtos_port_startThread;
+
+/// Switch to the process stack at stackTop and let the pending PendSV run
+/// (rtos_port.asm)
+extern void rtos_port_startFirst(uint32_t *stackTop);
+
+uint32_t *rtos_port_initStack(uint32_t *stackTop, void (*entry)(void *), void *arg,
+                              void (*exit)(void))
+{
+    // The exception frame has to be 8 byte aligned
+    uint32_t *sp = (uint32_t *)((uintptr_t)stackTop & ~7UL);
+
+    // Popped by the hardware on exception return
+    *--sp = RTOS_PORT_XPSR;
+    *--sp = (uint32_t)(uintptr_t)entry;     // pc
+    *--sp = (uint32_t)(uintptr_t)exit;      // lr, where entry returns to
+    *--sp = 0;                              // r12
+    *--sp = 0;                              // r3
+    *--sp = 0;                              // r2
+    *--sp = 0;                              // r1
+    *--sp = (uint32_t)(uintptr_t)arg;       // r0
+
+    // Popped by rtos_port_pendSvHandler: EXC_RETURN then r11 - r4
+    *--sp = RTOS_PORT_EXC_RETURN;
+    sp -= 8;
+
+    return sp;
+}
+
+uint32_t rtos_port_lock(void)
+{
+    return IntMasterDisable();
+}
+
+void rtos_port_unlock(uint32_t wasLocked)
+{
+    if (!wasLocked) {
+        IntMasterEnable();
+    }
+}
+
+void rtos_port_switch(void)
+{
+    NVIC_INT_CTRL_R = NVIC_INT_CTRL_PEND_SV;
+}
+
+void rtos_port_start(void)
+{
+    NVIC_SYS_PRI3_R = (NVIC_SYS_PRI3_R & ~(NVIC_SYS_PRI3_TICK_M | NVIC_SYS_PRI3_PENDSV_M)) |
+                      (7UL << NVIC_SYS_PRI3_TICK_S) | (7UL << NVIC_SYS_PRI3_PENDSV_S);
+
+    NVIC_ST_CTRL_R = 0;
+    NVIC_ST_RELOAD_R = clock_getHz() / RTOS_TICK_HZ - 1;
+    NVIC_ST_CURRENT_R = 0;
+    NVIC_ST_CTRL_R = NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN | NVIC_ST_CTRL_ENABLE;
+
+    // The first switch saves the caller's context into the scratch thread and
+    // never comes back to it
+    rtos_current = &rtos_port_startThread;
+    rtos_port_switch();
+    rtos_port_startFirst(rtos_port_startStack + 64);
+
+    while (1);
+}
+
+void rtos_port_sysTickHandler(void)
+{
+    rtos_tick();
+}
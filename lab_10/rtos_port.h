@@ -0,0 +1,48 @@
+/*
+ * rtos_port.h
+ *
+ * What the kernel in rtos.c needs from the processor. rtos_port.c and
+ * rtos_port.asm implement it for the Cortex-M4F with PendSV and SysTick,
+ * tools/rtos_port_pthread.c with pthreads on a host.
+ *
+ */
+
+#ifndef RTOS_PORT_H_
+#define RTOS_PORT_H_
+
+#include <stdint.h>
+#include "rtos.h"
+
+/// Thread running now and the one PendSV switches to, shared with the switch
+/// code
+extern rtos_thread_t *volatile rtos_current;
+extern rtos_thread_t *volatile rtos_next;
+
+/// \brief Lay out an initial context so the first switch to the thread
+/// starts entry(arg); exit is called if entry returns
+/// \return the thread's initial stack pointer
+uint32_t *rtos_port_initStack(uint32_t *stackTop, void (*entry)(void *), void *arg,
+                              void (*exit)(void));
+
+/// Interrupts off, returns whether they already were
+uint32_t rtos_port_lock(void);
+
+/// Undo rtos_port_lock()
+void rtos_port_unlock(uint32_t wasLocked);
+
+/// Switch to rtos_next once no interrupt is running and interrupts are on
+void rtos_port_switch(void);
+
+/// Start the tick and switch to rtos_next, does not return
+void rtos_port_start(void);
+
+/// Kernel side of the tick: wakes sleepers and rotates equal priorities
+void rtos_tick(void);
+
+/// SysTick interrupt, calls rtos_tick()
+void rtos_port_sysTickHandler(void);
+
+/// PendSV interrupt, saves rtos_current and restores rtos_next (rtos_port.asm)
+void rtos_port_pendSvHandler(void);
+
+#endif /* RTOS_PORT_H_ */
@@ -0,0 +1,225 @@
+/*
+ * sched.c
+ *
+ * Cooperative scheduler, see sched.h.
+ *
+ */
+
+#include "sched_port.h"
+#include "sched.h"
+
+#define SCHED_QUEUE_MASK (SCHED_QUEUE_SIZE - 1)
+
+typedef struct {
+    sched_handler_t handler;
+    uint8_t priority;
+    volatile uint8_t head; // free running, like ringbuf_t; ISRs post
+    volatile uint8_t tail;
+    sched_event_t queue[SCHED_QUEUE_SIZE];
+} sched_task_t;
+
+typedef struct {
+    int8_t task;        // SCHED_INVALID when unused
+    uint16_t signal;
+    int32_t value;
+    uint32_t remaining; // ticks until the next post
+    uint32_t period;    // 0 for a single post
+} sched_timer_t;
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_taskCount = 0;
+static sched_timer_t sched_timers[SCHED_MAX_TIMERS];
+static uint8_t sched_timersReady = 0;
+static void (*sched_idle)(void) = 0;
+static volatile uint32_t sched_droppedEvents = 0;
+
+static void sched_initTimers(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+        sched_timers[i].task = SCHED_INVALID;
+    }
+    sched_timersReady = 1;
+}
+
+int sched_addTask(sched_handler_t handler, uint8_t priority)
+{
+    sched_task_t *task;
+
+    if (sched_taskCount == SCHED_MAX_TASKS) {
+        return SCHED_INVALID;
+    }
+
+    task = &sched_tasks[sched_taskCount];
+    task->handler = handler;
+    task->priority = priority;
+    task->head = 0;
+    task->tail = 0;
+    return sched_taskCount++;
+}
+
+int sched_post(int task, uint16_t signal, int32_t value)
+{
+    sched_task_t *t;
+    uint32_t lock;
+    int posted = 0;
+
+    if (task < 0 || task >= sched_taskCount) {
+        return 0;
+    }
+    t = &sched_tasks[task];
+
+    // Several ISRs may post to the same task
+    lock = sched_port_lock();
+    if ((uint8_t)(t->head - t->tail) < SCHED_QUEUE_SIZE) {
+        t->queue[t->head & SCHED_QUEUE_MASK].signal = signal;
+        t->queue[t->head & SCHED_QUEUE_MASK].value = value;
+        t->head++;
+        posted = 1;
+    } else {
+        sched_droppedEvents++;
+    }
+    sched_port_unlock(lock);
+
+    return posted;
+}
+
+static int sched_addTimer(int task, uint16_t signal, int32_t value, uint32_t ticks,
+                          uint32_t period)
+{
+    uint32_t lock;
+    int id = SCHED_INVALID;
+    uint8_t i;
+
+    if (!sched_timersReady) {
+        sched_initTimers();
+    }
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    lock = sched_port_lock();
+    for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+        sched_timer_t *timer = &sched_timers[i];
+
+        if (timer->task == SCHED_INVALID) {
+            timer->signal = signal;
+            timer->value = value;
+            timer->remaining = ticks;
+            timer->period = period;
+            timer->task = task; // last, the entry is live from here on
+            id = i;
+            break;
+        }
+    }
+    sched_port_unlock(lock);
+
+    return id;
+}
+
+int sched_postAfter(int task, uint16_t signal, int32_t value, uint32_t ticks)
+{
+    return sched_addTimer(task, signal, value, ticks, 0);
+}
+
+int sched_postEvery(int task, uint16_t signal, int32_t value, uint32_t period)
+{
+    return sched_addTimer(task, signal, value, period, period);
+}
+
+void sched_cancel(int timer)
+{
+    if (timer >= 0 && timer < SCHED_MAX_TIMERS) {
+        sched_timers[timer].task = SCHED_INVALID;
+    }
+}
+
+void sched_setIdleHook(void (*idle)(void))
+{
+    sched_idle = idle;
+}
+
+void sched_tick(void)
+{
+    uint8_t i;
+
+    if (!sched_timersReady) {
+        return;
+    }
+
+    for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+        sched_timer_t *timer = &sched_timers[i];
+
+        if (timer->task == SCHED_INVALID || --timer->remaining) {
+            continue;
+        }
+
+        sched_post(timer->task, timer->signal, timer->value);
+        if (timer->period) {
+            timer->remaining = timer->period;
+        } else {
+            timer->task = SCHED_INVALID;
+        }
+    }
+}
+
+void sched_start(void)
+{
+    sched_port_startTick(sched_tick);
+}
+
+/// Highest priority task with an event waiting, or 0
+static sched_task_t *sched_ready(void)
+{
+    sched_task_t *best = 0;
+    uint8_t i;
+
+    for (i = 0; i < sched_taskCount; i++) {
+        sched_task_t *t = &sched_tasks[i];
+
+        if (t->head != t->tail && (!best || t->priority > best->priority)) {
+            best = t;
+        }
+    }
+
+    return best;
+}
+
+int sched_runOnce(void)
+{
+    sched_task_t *best = sched_ready();
+    sched_event_t event;
+
+    if (!best) {
+        if (sched_idle) {
+            // Look again with interrupts masked: a post that slipped in after
+            // the scan above skips the hook, one after this still ends a WFI
+            uint32_t lock = sched_port_lock();
+
+            if (!sched_ready()) {
+                sched_idle();
+            }
+            sched_port_unlock(lock);
+        }
+        return 0;
+    }
+
+    // Only this loop takes events out, so no lock is needed
+    event = best->queue[best->tail & SCHED_QUEUE_MASK];
+    best->tail++;
+    best->handler(event);
+    return 1;
+}
+
+void sched_run(void)
+{
+    while (1) {
+        sched_runOnce();
+    }
+}
+
+uint32_t sched_dropped(void)
+{
+    return sched_droppedEvents;
+}
@@ -0,0 +1,92 @@
+/*
+ * sched.h
+ *
+ * Cooperative run-to-completion scheduler. Each task is a handler function
+ * plus a queue of events; sched_run() repeatedly hands the oldest event of the
+ * highest priority task with pending events to its handler. Handlers must
+ * return quickly (no busy waits), anything longer is split into steps that
+ * post events to themselves.
+ *
+ * Events can be posted from ISRs (button, PING, UART RX, ...), from other
+ * tasks, or after a delay with sched_postAfter()/sched_postEvery(). Delays
+ * count sched_tick() calls, which sched_start() drives from the 1 ms timer
+ * wheel; a host test can call sched_tick() and sched_runOnce() by hand instead.
+ * The interrupt masking and the tick go through sched_port.h, so sched.c
+ * builds on a host; tools/sched_test.c does that.
+ *
+ *     static void scan_task(sched_event_t event) { ... }
+ *     static void move_task(sched_event_t event) { ... }
+ *
+ *     scan = sched_addTask(scan_task, 2);
+ *     move = sched_addTask(move_task, 3);
+ *     sched_postEvery(scan, SCAN_STEP, 0, 100);
+ *     sched_start();
+ *     sched_run();
+ *
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 8
+
+/// Events a task can have pending, power of 2
+#define SCHED_QUEUE_SIZE 8
+
+/// Delayed and periodic posts pending at once
+#define SCHED_MAX_TIMERS 8
+
+#define SCHED_INVALID (-1)
+
+typedef struct {
+    uint16_t signal;    // what happened, defined by the application
+    int32_t value;      // e.g. a distance or a received byte
+} sched_event_t;
+
+typedef void (*sched_handler_t)(sched_event_t event);
+
+/// \brief Add a task
+/// \param priority higher numbers run first
+/// \return task id, or SCHED_INVALID if SCHED_MAX_TASKS are in use
+int sched_addTask(sched_handler_t handler, uint8_t priority);
+
+/// \brief Queue an event for a task, safe from ISRs
+/// \return 0 if the task's queue was full and the event was dropped
+int sched_post(int task, uint16_t signal, int32_t value);
+
+/// \brief Post an event after ticks sched_tick() calls
+/// \return timer id for sched_cancel(), or SCHED_INVALID
+int sched_postAfter(int task, uint16_t signal, int32_t value, uint32_t ticks);
+
+/// \brief Post an event every period ticks
+/// \return timer id for sched_cancel(), or SCHED_INVALID
+int sched_postEvery(int task, uint16_t signal, int32_t value, uint32_t period);
+
+/// Stop a delayed or periodic post
+void sched_cancel(int timer);
+
+/// \brief Called when no task has anything to do, e.g. power_idle() to sleep
+/// until the next interrupt. Runs with interrupts masked, after a last check
+/// that nothing is pending; an interrupt still ends a WFI in the hook and is
+/// served once it returns. The hook must not wait for an ISR to have run.
+void sched_setIdleHook(void (*idle)(void));
+
+/// Advance the delayed posts by one tick, safe from ISRs
+void sched_tick(void);
+
+/// Drive sched_tick() from the 1 ms timer wheel
+void sched_start(void);
+
+/// \brief Dispatch one event, or call the idle hook if there is none
+/// \return 1 if an event was dispatched
+int sched_runOnce(void);
+
+/// Dispatch events forever
+void sched_run(void);
+
+/// Events dropped because a queue was full, since start up
+uint32_t sched_dropped(void);
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,28 @@
+/*
+ * sched_port.c
+ *
+ * Robot side of the scheduler, see sched_port.h.
+ *
+ */
+
+#include <stdbool.h>
+#include "driverlib/interrupt.h"
+#include "timer_wheel.h"
+#include "sched_port.h"
+
+uint32_t sched_port_lock(void)
+{
+    return IntMasterDisable();
+}
+
+void sched_port_unlock(uint32_t wasLocked)
+{
+    if (!wasLocked) {
+        IntMasterEnable();
+    }
+}
+
+void sched_port_startTick(void (*tick)(void))
+{
+    timer_every(tick, 1);
+}
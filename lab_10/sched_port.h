@@ -0,0 +1,24 @@
+/*
+ * sched_port.h
+ *
+ * What the scheduler in sched.c needs from the processor and the timers.
+ * sched_port.c implements it with the driverlib interrupt calls and the timer
+ * wheel; a host test supplies its own, see tools/sched_test.c.
+ *
+ */
+
+#ifndef SCHED_PORT_H_
+#define SCHED_PORT_H_
+
+#include <stdint.h>
+
+/// Interrupts off, returns whether they already were
+uint32_t sched_port_lock(void);
+
+/// Undo sched_port_lock()
+void sched_port_unlock(uint32_t wasLocked);
+
+/// Call tick every 1 ms from an interrupt
+void sched_port_startTick(void (*tick)(void));
+
+#endif /* SCHED_PORT_H_ */
@@ -1,11 +1,12 @@
 #include "Timer.h"
 #include "lcd.h"
 #include "servo.h"
+#include "clock.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 
-unsigned long pwm_period = 0x4E200;
+unsigned long pwm_period = 0x4E200; // 20 ms, set from the system clock in servo_init()
 volatile int degree = 0;
 volatile int clockwise;
 
@@ -29,6 +30,7 @@ void servo_init(void){
     TIMER1_TBMR_R |= 0x2; //sets TnMR, bits 0 and 1 to 0x2 for periodic mode
     TIMER1_TBMR_R |= 0x8; //set TnAMS, bit 3 to 1 for PWM mode enable
 
+    pwm_period = clock_getHz() / 50; // 320000 at 16 MHz, 1600000 at 80 MHz
     TIMER1_TBPR_R = pwm_period >> 16;
     TIMER1_TBILR_R = pwm_period & 0xFFFF;
 
@@ -48,7 +50,8 @@ void servo_move(float degree){
 //       low = 320000 - high;
 //       TIMER1_TBMATCHR_R = low;
 //       TIMER1_TBPMR_R = low >> 16;
-    int counts = 151.59 * degree + 284366;
+    //calibrated at 16 MHz, scaled to the current clock
+    int counts = (151.59f * degree + 284366) * (clock_getHz() / (float)CLOCK_PIOSC_HZ);
         TIMER1_TBMATCHR_R = counts;
         TIMER1_TBPMR_R = counts >> 16;
 }
@@ -0,0 +1,205 @@
+/*
+ * telemetry.c
+ *
+ * COBS framed, CRC checked binary records over UART1. See telemetry.h for the
+ * frame layout.
+ *
+ */
+
+#include "telemetry.h"
+#include "uart.h"
+
+#define TELEM_MAX_PAYLOAD 38 // TELEM_SENSORS
+#define TELEM_MAX_FRAME (2 + TELEM_MAX_PAYLOAD + 2) // type, sequence, crc
+// Delimiters on both sides, and one COBS code byte per 254 bytes and to start
+#define TELEM_MAX_WIRE (TELEM_MAX_FRAME + TELEM_MAX_FRAME / 254 + 3)
+
+typedef struct {
+    uint8_t data[TELEM_MAX_FRAME];
+    uint8_t length;
+} telem_frame_t;
+
+static uint8_t telem_sequence = 0;
+static uint16_t telem_droppedCount = 0;
+
+// CRC-16/CCITT-FALSE, four bits at a time
+static const uint16_t telem_crcTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t telem_crc(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (length--) {
+        crc = (crc << 4) ^ telem_crcTable[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ telem_crcTable[(crc >> 12) ^ (*data & 0x0F)];
+        data++;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief COBS encode length bytes of in. Each zero is replaced by the
+ * distance to the next one, the first code byte points at the first zero.
+ *
+ * @return number of bytes written to out, at most length + length / 254 + 1
+ */
+static uint8_t telem_cobs(const uint8_t *in, uint8_t length, uint8_t *out)
+{
+    uint8_t *code = out;    // where the current run's length goes
+    uint8_t *o = out + 1;
+    uint8_t run = 1;
+
+    while (length--) {
+        if (*in == 0) {
+            *code = run;
+            code = o++;
+            run = 1;
+        } else {
+            *o++ = *in;
+            if (++run == 0xFF) { // Longest run, start a new one
+                *code = run;
+                code = o++;
+                run = 1;
+            }
+        }
+        in++;
+    }
+    *code = run;
+
+    return o - out;
+}
+
+static void telem_begin(telem_frame_t *frame, uint8_t type)
+{
+    frame->data[0] = type;
+    frame->data[1] = telem_sequence++; // Counted even if dropped, as a gap
+    frame->length = 2;
+}
+
+static void telem_u8(telem_frame_t *frame, uint8_t value)
+{
+    frame->data[frame->length++] = value;
+}
+
+static void telem_u16(telem_frame_t *frame, uint16_t value)
+{
+    telem_u8(frame, value & 0xFF);
+    telem_u8(frame, value >> 8);
+}
+
+static void telem_u32(telem_frame_t *frame, uint32_t value)
+{
+    telem_u16(frame, value & 0xFFFF);
+    telem_u16(frame, value >> 16);
+}
+
+/// Add the CRC, frame and queue the whole record, or drop it
+static void telem_send(telem_frame_t *frame)
+{
+    uint8_t wire[TELEM_MAX_WIRE];
+    uint16_t crc = telem_crc(frame->data, frame->length);
+    uint8_t length;
+
+    telem_u16(frame, crc);
+
+    wire[0] = 0;
+    length = 1 + telem_cobs(frame->data, frame->length, &wire[1]);
+    wire[length++] = 0;
+
+    // Half a frame would only cost the next one too
+    if (uart_txFree() < length) {
+        telem_droppedCount++;
+        return;
+    }
+    uart_write(wire, length);
+}
+
+void telem_sendScan(uint8_t angle, int16_t distanceCm, uint16_t raw)
+{
+    telem_frame_t frame;
+
+    telem_begin(&frame, TELEM_SCAN);
+    telem_u8(&frame, angle);
+    telem_u16(&frame, distanceCm);
+    telem_u16(&frame, raw);
+    telem_send(&frame);
+}
+
+void telem_sendObject(uint8_t index, uint8_t startAngle, uint8_t endAngle,
+                      uint8_t middleAngle, int16_t distanceCm, uint16_t widthMm)
+{
+    telem_frame_t frame;
+
+    telem_begin(&frame, TELEM_OBJECT);
+    telem_u8(&frame, index);
+    telem_u8(&frame, startAngle);
+    telem_u8(&frame, endAngle);
+    telem_u8(&frame, middleAngle);
+    telem_u16(&frame, distanceCm);
+    telem_u16(&frame, widthMm);
+    telem_send(&frame);
+}
+
+void telem_sendPose(const oi_pose_t *pose)
+{
+    telem_frame_t frame;
+
+    telem_begin(&frame, TELEM_POSE);
+    telem_u32(&frame, pose->x);
+    telem_u32(&frame, pose->y);
+    telem_u32(&frame, pose->heading);
+    telem_send(&frame);
+}
+
+void telem_sendSensors(const oi_t *self)
+{
+    telem_frame_t frame;
+    uint16_t flags = self->wheelDropLeft |
+                     self->wheelDropRight << 1 |
+                     self->bumpLeft << 2 |
+                     self->bumpRight << 3 |
+                     self->cliffLeft << 4 |
+                     self->cliffFrontLeft << 5 |
+                     self->cliffFrontRight << 6 |
+                     self->cliffRight << 7 |
+                     self->lightBumperLeft << 8 |
+                     self->lightBumperFrontLeft << 9 |
+                     self->lightBumperCenterLeft << 10 |
+                     self->lightBumperCenterRight << 11 |
+                     self->lightBumperFrontRight << 12 |
+                     self->lightBumperRight << 13 |
+                     self->wallSensor << 14 |
+                     self->virtualWall << 15;
+
+    telem_begin(&frame, TELEM_SENSORS);
+    telem_u16(&frame, flags);
+    telem_u16(&frame, self->cliffLeftSignal);
+    telem_u16(&frame, self->cliffFrontLeftSignal);
+    telem_u16(&frame, self->cliffFrontRightSignal);
+    telem_u16(&frame, self->cliffRightSignal);
+    telem_u16(&frame, self->lightBumpLeftSignal);
+    telem_u16(&frame, self->lightBumpFrontLeftSignal);
+    telem_u16(&frame, self->lightBumpCenterLeftSignal);
+    telem_u16(&frame, self->lightBumpCenterRightSignal);
+    telem_u16(&frame, self->lightBumpFrontRightSignal);
+    telem_u16(&frame, self->lightBumpRightSignal);
+    telem_u16(&frame, self->wallSignal);
+    telem_u16(&frame, self->leftEncoderCount);
+    telem_u16(&frame, self->rightEncoderCount);
+    telem_u16(&frame, self->batteryVoltage);
+    telem_u16(&frame, self->batteryCurrent);
+    telem_u16(&frame, self->batteryCharge);
+    telem_u16(&frame, self->batteryCapacity);
+    telem_u8(&frame, self->chargingState);
+    telem_u8(&frame, self->oiMode);
+    telem_send(&frame);
+}
+
+uint16_t telem_dropped(void)
+{
+    return telem_droppedCount;
+}
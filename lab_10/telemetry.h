@@ -0,0 +1,87 @@
+/*
+ * telemetry.h
+ *
+ * Binary telemetry over UART1 in place of printf style text lines. Every
+ * record goes out as one frame:
+ *
+ *     0x00 | COBS( type, sequence, payload..., crc16 low, crc16 high ) | 0x00
+ *
+ * COBS removes every zero from the frame, so 0x00 only ever delimits frames
+ * and a receiver that starts mid-stream or loses bytes picks up again at the
+ * next zero. The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, start 0xFFFF)
+ * over type, sequence and payload. The sequence number counts every record,
+ * sent or not, so gaps show what was lost. Text printed in between (profile
+ * and power dumps) follows a frame's closing zero and runs up to the next
+ * frame's opening one, or to the end of the capture; it fails the CRC and the
+ * decoder passes it through.
+ *
+ * Payloads are little endian, with no padding:
+ *
+ *     TELEM_SCAN     angle u8 (deg), distance i16 (cm), raw u16 (ADC)
+ *     TELEM_OBJECT   index u8, start u8, end u8, middle u8 (deg),
+ *                    distance i16 (cm), width u16 (mm)
+ *     TELEM_POSE     x i32 (um), y i32 (um), heading i32 (millidegrees)
+ *     TELEM_SENSORS  flags u16, cliff signals 4 x u16 (left, front left,
+ *                    front right, right), light bump signals 6 x u16 (left
+ *                    to right), wall signal u16, encoders 2 x i16 (left,
+ *                    right), battery mV u16, mA i16, charge mAh u16,
+ *                    capacity mAh u16, charging state u8, OI mode u8
+ *
+ * TELEM_SENSORS flags, bit 0 first: wheel drop left/right, bump left/right,
+ * cliff left/front left/front right/right, light bumper left/front left/
+ * center left/center right/front right/right, wall, virtual wall.
+ *
+ * A scan sample costs 12 bytes on the wire and an object 15, against about 40
+ * as text, and no float formatting. tools/telemetry_decode.cpp turns a capture
+ * back into CSV or JSON.
+ *
+ * Frames are queued with uart_write(), so uart_interrupt_init() has to have
+ * run. A frame that does not fit into the UART transmit buffer is dropped
+ * rather than waited for. Only send from the main program, not from
+ * interrupts.
+ *
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "open_interface.h"
+
+#define TELEM_SCAN 1
+#define TELEM_OBJECT 2
+#define TELEM_POSE 3
+#define TELEM_SENSORS 4
+
+/**
+ * @brief One sensor sample of a sweep
+ *
+ * @param angle scan angle in degrees
+ * @param distanceCm distance worked out from the sensor
+ * @param raw sensor reading the distance came from
+ */
+void telem_sendScan(uint8_t angle, int16_t distanceCm, uint16_t raw);
+
+/**
+ * @brief An object found in a sweep
+ *
+ * @param index number of the object in the sweep
+ * @param startAngle first angle the object covers, degrees
+ * @param endAngle last angle, degrees
+ * @param middleAngle angle the distance was measured at, degrees
+ * @param distanceCm distance to the object
+ * @param widthMm linear width of the object
+ */
+void telem_sendObject(uint8_t index, uint8_t startAngle, uint8_t endAngle,
+                      uint8_t middleAngle, int16_t distanceCm, uint16_t widthMm);
+
+/// Dead reckoning pose, see oi_getPose()
+void telem_sendPose(const oi_pose_t *pose);
+
+/// Snapshot of the Create's sensors from the last oi_update()
+void telem_sendSensors(const oi_t *self);
+
+/// Records dropped because the UART transmit buffer was full
+uint16_t telem_dropped(void);
+
+#endif /* TELEMETRY_H_ */
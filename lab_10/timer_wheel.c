@@ -0,0 +1,249 @@
+/*
+ * timer_wheel.c
+ *
+ * Hierarchical timer wheel, see timer_wheel.h.
+ *
+ */
+
+#include <inc/tm4c123gh6pm.h>
+#include "driverlib/interrupt.h"
+#include "Timer.h"
+#include "clock.h"
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 5
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+// Furthest a timer can be placed in the top level
+#define TIMER_WHEEL_SPAN ((uint32_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+typedef struct timer_entry {
+    struct timer_entry *next;   // list of the slot the timer sits in
+    struct timer_entry **prev;  // pointer that points at this entry
+    void (*f)(void);
+    uint32_t expires;           // tick to fire at
+    uint32_t period;            // 0 for one-shot
+    int remaining;              // calls left, < 0 for no limit
+    uint8_t generation;         // bumped on free, makes old handles stale
+    uint8_t used;
+} timer_entry_t;
+
+static timer_entry_t timer_entries[TIMER_WHEEL_ENTRIES];
+static timer_entry_t *timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static volatile uint32_t timer_now = 0;
+static uint8_t timer_wheelRunning = 0;
+
+/// Link an entry into the slot matching its expiry
+static void timer_insert(timer_entry_t *entry)
+{
+    uint32_t expires = entry->expires;
+    uint32_t delta = expires - timer_now;
+    timer_entry_t **slot;
+    uint8_t level = 0;
+
+    if ((int32_t)delta <= 0) {
+        expires = timer_now; // late, fire on this tick
+    } else if (delta >= TIMER_WHEEL_SPAN) {
+        expires = timer_now + TIMER_WHEEL_SPAN - 1; // parked, re-placed later
+        delta = TIMER_WHEEL_SPAN - 1;
+    }
+
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((uint32_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    slot = &timer_wheel[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    entry->next = *slot;
+    if (*slot) {
+        (*slot)->prev = &entry->next;
+    }
+    entry->prev = slot;
+    *slot = entry;
+}
+
+static void timer_unlink(timer_entry_t *entry)
+{
+    *entry->prev = entry->next;
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+}
+
+static void timer_free(timer_entry_t *entry)
+{
+    entry->used = 0;
+    entry->generation++;
+}
+
+/// Move every timer of a higher level slot down to where it belongs now
+static void timer_cascade(uint8_t level)
+{
+    uint8_t index = (timer_now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    timer_entry_t *entry = timer_wheel[level][index];
+
+    timer_wheel[level][index] = 0;
+    while (entry) {
+        timer_entry_t *next = entry->next;
+        timer_insert(entry);
+        entry = next;
+    }
+}
+
+static int timer_add(void (*f)(void), uint32_t delay, uint32_t period, int times)
+{
+    bool wasDisabled;
+    int handle = TIMER_INVALID;
+    uint8_t i;
+
+    if (!timer_wheelRunning) {
+        timer_wheel_init();
+    }
+    if (delay == 0) {
+        delay = 1;
+    }
+
+    wasDisabled = IntMasterDisable();
+    for (i = 0; i < TIMER_WHEEL_ENTRIES; i++) {
+        timer_entry_t *entry = &timer_entries[i];
+
+        if (!entry->used) {
+            entry->used = 1;
+            entry->f = f;
+            entry->expires = timer_now + delay;
+            entry->period = period;
+            entry->remaining = times;
+            timer_insert(entry);
+            handle = (entry->generation << 8) | i;
+            break;
+        }
+    }
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+
+    return handle;
+}
+
+void timer_wheel_init(void)
+{
+    if (timer_wheelRunning) {
+        return;
+    }
+
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4; // Turn on clock to TIMER4
+    while (!(SYSCTL_PRTIMER_R & SYSCTL_PRTIMER_R4));
+    TIMER4_CTL_R &= ~TIMER_CTL_TAEN;           // Disable TIMER4 for setup
+    TIMER4_CFG_R = TIMER_CFG_16_BIT;           // Set as 16-bit timer
+    TIMER4_TAMR_R = TIMER_TAMR_TAMR_PERIOD;    // Periodic, countdown mode
+    TIMER4_TAPR_R = clock_cyclesPerMicro() - 1; // 1us per count
+    TIMER4_TAILR_R = 1000 - 1;                 // 1ms per tick
+    TIMER4_ICR_R = TIMER_ICR_TATOCINT;
+    TIMER4_IMR_R |= TIMER_IMR_TATOIM;
+    NVIC_PRI17_R = (NVIC_PRI17_R & ~NVIC_PRI17_INTC_M) | (6 << NVIC_PRI17_INTC_S);
+    IntRegister(INT_TIMER4A, timer_wheel_handler);
+    NVIC_EN2_R |= (1 << 6);                    // TIMER4A is IRQ 70
+    TIMER4_CTL_R |= TIMER_CTL_TAEN;
+
+    timer_wheelRunning = 1;
+}
+
+int timer_schedule(void (*f)(void), uint32_t delay)
+{
+    return timer_add(f, delay, 0, 1);
+}
+
+int timer_every(void (*f)(void), uint32_t period)
+{
+    return timer_add(f, period, period, -1);
+}
+
+void timer_cancel(int handle)
+{
+    timer_entry_t *entry;
+    bool wasDisabled;
+
+    if (handle < 0 || (handle & 0xFF) >= TIMER_WHEEL_ENTRIES) {
+        return;
+    }
+    entry = &timer_entries[handle & 0xFF];
+
+    wasDisabled = IntMasterDisable();
+    if (entry->used && entry->generation == (uint8_t)(handle >> 8)) {
+        timer_unlink(entry);
+        timer_free(entry);
+    }
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
+
+uint32_t timer_wheel_now(void)
+{
+    return timer_now;
+}
+
+void timer_wheel_handler(void)
+{
+    timer_entry_t *entry;
+    void (*f)(void);
+    uint8_t level;
+    uint8_t index;
+
+    TIMER4_ICR_R = TIMER_ICR_TATOCINT;
+    timer_now++;
+
+    // Each time a level wraps, the next level's current slot comes due
+    for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if (timer_now & ((1UL << (TIMER_WHEEL_BITS * level)) - 1)) {
+            break;
+        }
+        timer_cascade(level);
+    }
+
+    // Take timers off the slot one at a time, so a callback can cancel or
+    // schedule any timer, itself included
+    index = timer_now & TIMER_WHEEL_MASK;
+    while ((entry = timer_wheel[0][index]) != 0) {
+        timer_unlink(entry);
+
+        if ((int32_t)(entry->expires - timer_now) > 0) {
+            timer_insert(entry); // parked far timer, not due yet
+            continue;
+        }
+
+        if (entry->remaining > 0) {
+            entry->remaining--;
+        }
+        if (entry->period && entry->remaining != 0) {
+            entry->expires += entry->period;
+            timer_insert(entry);
+        } else {
+            timer_free(entry);
+        }
+
+        f = entry->f; // the entry may be reused by the time f returns
+        f();
+    }
+}
+
+// Timer.h interval helpers, built on the wheel
+
+void timer_fireEvery(void (*f)(void), int millis)
+{
+    timer_every(f, millis);
+}
+
+void timer_fireOnce(void (*f)(void), int millis)
+{
+    timer_schedule(f, millis);
+}
+
+void timer_fireFor(void (*f)(void), int millis, int times)
+{
+    if (times > 0) {
+        timer_add(f, millis, millis, times);
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * timer_wheel.h
+ *
+ * Software timers on a 1 ms TIMER4A tick. Any number of one-shot or periodic
+ * callbacks (up to TIMER_WHEEL_ENTRIES) share the one hardware timer, so
+ * periodic work like IR sampling or LCD refresh no longer needs a busy wait.
+ *
+ * Timers are kept in a hierarchical wheel: four levels of 32 slots covering
+ * 32 ms, 1 s, 33 s and 17 min. Scheduling and cancelling are O(1), and a tick
+ * only touches the timers that are due (plus, every 32 ticks, the ones moving
+ * down a level). Longer delays are fine, they just move down more often.
+ *
+ * Callbacks run inside the TIMER4A interrupt: keep them short, set a flag for
+ * the main loop if there is real work to do.
+ *
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+/// Timers that can be scheduled at once
+#define TIMER_WHEEL_ENTRIES 16
+
+/// Returned instead of a handle when every entry is in use
+#define TIMER_INVALID (-1)
+
+/// Start the 1 ms tick, done by the first timer_schedule()/timer_every()
+void timer_wheel_init(void);
+
+/// \brief Call f once, delay ms from now
+/// \return handle for timer_cancel(), or TIMER_INVALID
+int timer_schedule(void (*f)(void), uint32_t delay);
+
+/// \brief Call f every period ms, the first time period ms from now
+/// \return handle for timer_cancel(), or TIMER_INVALID
+int timer_every(void (*f)(void), uint32_t period);
+
+/// \brief Stop a timer. Handles of timers that already fired are ignored.
+void timer_cancel(int handle);
+
+/// Milliseconds counted by the wheel since timer_wheel_init()
+uint32_t timer_wheel_now(void);
+
+/// TIMER4A interrupt, advances the wheel by one tick
+void timer_wheel_handler(void);
+
+#endif /* TIMER_WHEEL_H_ */
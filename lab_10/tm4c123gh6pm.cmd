@@ -42,4 +42,6 @@ SECTIONS
     .stack  :   > SRAM
 }
 
-__STACK_TOP = __stack + 512;
+/* Top of the whole --stack_size stack. Interrupts and the RTOS kernel run */
+/* on it; RTOS threads bring their own stacks.                              */
+__STACK_TOP = __stack + __STACK_SIZE;
@@ -9,7 +9,25 @@
 */
 
 #include "uart.h"
+#include "clock.h"
 #include <stdint.h>
+#include "driverlib/interrupt.h"
+#include "power.h"
+#include "ringbuf.h"
+
+// Longest sleep while waiting for a byte
+#define UART_SLEEP_MICROS 500
+
+// Receive errors that come with a byte; that byte is not kept
+#define UART_DR_ERRORS (UART_DR_BE | UART_DR_PE | UART_DR_FE)
+
+//interrupt driven mode, see uart_interrupt_init()
+static uint8_t uart_rxStorage[UART_RX_BUFFER_SIZE];
+static uint8_t uart_txStorage[UART_TX_BUFFER_SIZE];
+static ringbuf_t uart_rxBuffer; //filled by the interrupt, emptied by the program
+static ringbuf_t uart_txBuffer; //filled by the program, emptied by the interrupt
+static volatile uart_errors_t uart_errorCounts;
+static int uart_buffered = 0;
 
 
 void uart_init(void){
@@ -34,9 +52,10 @@ void uart_init(void){
     GPIO_PORTB_PCTL_R &= ~0x00000011;
     GPIO_PORTB_PCTL_R |= 0x00000011;
 
-    //calculate baud rate
-    uint16_t iBRD = 8; //use equations decimal 8 hex 0x08
-    uint16_t fBRD = 44; //use equations decimal 44 hex 0x2C
+    //calculate baud rate from the system clock, BRD = clock / (16 * 115200)
+    uint32_t divisor = clock_baudDivisor(115200);
+    uint16_t iBRD = divisor >> 6; //8 at 16 MHz, 43 at 80 MHz
+    uint16_t fBRD = divisor & 0x3F; //44 at 16 MHz, 26 at 80 MHz
 
     //turn off UART1 while setting it up
     UART1_CTL_R &= ~0x0301;
@@ -67,6 +86,14 @@ void uart_init(void){
 
 void uart_sendChar(char data)
 {
+    if(uart_buffered){
+        //only waits while the transmit buffer is full, the TX interrupt wakes us
+        while(uart_write(&data, 1) == 0){
+            power_sleepUntil(timer_getMicros64() + UART_SLEEP_MICROS);
+        }
+        return;
+    }
+
     while(UART1_FR_R & 0x20){ // 0b0010 0000
 
     }
@@ -77,8 +104,22 @@ char uart_receive(void)
 {
     char data = 0;
 
-    while(UART1_FR_R & 0x10){ // 0b0001 0000 UART_FR_RXFE
+    if(uart_buffered){
+        //check for a byte with interrupts masked, so an RX interrupt between
+        //the check and the WFI still ends the sleep
+        bool wasDisabled = power_lock();
+        while(uart_available() == 0){
+            power_sleepLocked(POWER_FOREVER);
+        }
+        power_unlock(wasDisabled);
 
+        uart_read(&data, 1);
+        return data;
+    }
+
+    while(UART1_FR_R & 0x10){ // 0b0001 0000 UART_FR_RXFE
+        // No RX interrupt to wake on; the 16 byte FIFO lasts 1.4 ms at 115200
+        power_sleepUntil(timer_getMicros64() + UART_SLEEP_MICROS);
     }
 
     data = (UART1_DR_R & 0xFF);
@@ -89,6 +130,11 @@ char uart_receive_nonblocking(void)
 {
     char data = 0;
 
+    if(uart_buffered){
+        uart_read(&data, 1);
+        return data;
+    }
+
     if(UART1_FR_R & 0x10){ // 0b0001 0000 UART_FR_RXFE
         return 0;
     }
@@ -105,3 +151,188 @@ void uart_sendStr(const char *data){
         data++;
     }
 }
+
+static udma_entry_t uart_txTasks[UART_DMA_MAX_SEGMENTS];
+
+void uart_dmaInit(void){
+
+    udma_init();
+    udma_assignChannel(UDMA_CH_UART1_RX, UDMA_ENC_UART1);
+    udma_assignChannel(UDMA_CH_UART1_TX, UDMA_ENC_UART1);
+
+    //turn on the FIFO so DMA requests come in bursts of 4
+    UART1_CTL_R &= ~0x0001;
+    UART1_LCRH_R |= 0x10; //FEN
+    UART1_IFLS_R = 0x12; //RX 4/8, TX 4/8
+    UART1_CTL_R |= 0x0001;
+
+    UART1_DMACTL_R |= 0x03; //RXDMAE, TXDMAE
+
+    //DMA completions come in on the UART1 interrupt (vector 22, IRQ 6)
+    IntRegister(INT_UART1, uart_interrupt_handler);
+    NVIC_EN0_R |= 0x00000040;
+}
+
+int uart_sendBufferDma(const void *data, uint16_t length, udma_callback_t done){
+
+    if(length == 0 || length > UDMA_MAX_TRANSFER || uart_dmaBusy()){
+        return 0;
+    }
+
+    udma_startTx(UDMA_CH_UART1_TX, data, length, (volatile uint32_t *)&UART1_DR_R, done);
+    return 1;
+}
+
+int uart_sendGatherDma(const udma_segment_t segments[], uint8_t count, udma_callback_t done){
+
+    if(count > UART_DMA_MAX_SEGMENTS || uart_dmaBusy()){
+        return 0;
+    }
+
+    return udma_startGatherTx(UDMA_CH_UART1_TX, segments, count, uart_txTasks,
+                              (volatile uint32_t *)&UART1_DR_R, done);
+}
+
+void uart_receivePingPongDma(void *bufferA, void *bufferB, uint16_t size, udma_callback_t filled){
+    udma_startPingPongRx(UDMA_CH_UART1_RX, (volatile uint32_t *)&UART1_DR_R,
+                         bufferA, bufferB, size, filled);
+}
+
+int uart_dmaBusy(void){
+    return udma_isBusy(UDMA_CH_UART1_TX);
+}
+
+void uart_interrupt_init(){
+
+    ringbuf_init(&uart_rxBuffer, uart_rxStorage, UART_RX_BUFFER_SIZE);
+    ringbuf_init(&uart_txBuffer, uart_txStorage, UART_TX_BUFFER_SIZE);
+
+    //turn on the FIFOs, interrupt at half full (RX) and half empty (TX)
+    UART1_CTL_R &= ~UART_CTL_UARTEN;
+    UART1_LCRH_R |= UART_LCRH_FEN;
+    UART1_IFLS_R = UART_IFLS_RX4_8 | UART_IFLS_TX4_8;
+    UART1_CTL_R |= UART_CTL_UARTEN;
+
+    //RX at the watermark, RX timeout for the last few bytes of a burst, and
+    //errors; TX is only unmasked while uart_txBuffer has bytes
+    UART1_ICR_R = UART_ICR_OEIC | UART_ICR_BEIC | UART_ICR_PEIC | UART_ICR_FEIC |
+                  UART_ICR_RTIC | UART_ICR_TXIC | UART_ICR_RXIC;
+    UART1_IM_R = UART_IM_OEIM | UART_IM_BEIM | UART_IM_PEIM | UART_IM_FEIM |
+                 UART_IM_RTIM | UART_IM_RXIM;
+    uart_buffered = 1;
+
+    //vector 22, IRQ 6, shared with the uDMA completions
+    IntRegister(INT_UART1, uart_interrupt_handler);
+    NVIC_EN0_R |= 0x00000040;
+}
+
+//move bytes from uart_txBuffer into the TX FIFO until either runs out
+static void uart_fillTxFifo(void){
+    uint8_t byte;
+
+    while(!(UART1_FR_R & UART_FR_TXFF) && ringbuf_get(&uart_txBuffer, &byte)){
+        UART1_DR_R = byte;
+    }
+}
+
+//start sending from the program side. The TX interrupt only fires when the
+//FIFO drains past half, so the FIFO is primed here; with TXIM masked the
+//interrupt cannot take bytes out of uart_txBuffer at the same time
+static void uart_startTx(void){
+    UART1_IM_R &= ~UART_IM_TXIM;
+    uart_fillTxFifo();
+    if(ringbuf_count(&uart_txBuffer)){
+        UART1_IM_R |= UART_IM_TXIM; //FIFO is full, it will cross the watermark
+    }
+}
+
+uint16_t uart_write(const void *data, uint16_t length){
+    const uint8_t *bytes = data;
+    uint16_t queued = 0;
+    uint16_t space = uart_txFree();
+
+    if(length > space){
+        length = space; //partial write, the caller sends the rest later
+    }
+    while(queued < length){
+        ringbuf_put(&uart_txBuffer, bytes[queued++]);
+    }
+
+    if(queued){
+        uart_startTx();
+    }
+    return queued;
+}
+
+uint16_t uart_read(void *data, uint16_t length){
+    uint8_t *bytes = data;
+    uint16_t count = 0;
+
+    while(count < length && ringbuf_get(&uart_rxBuffer, &bytes[count])){
+        count++;
+    }
+    return count;
+}
+
+uint16_t uart_available(void){
+    return ringbuf_count(&uart_rxBuffer);
+}
+
+uint16_t uart_txFree(void){
+    //nothing goes into the buffer before uart_interrupt_init() set it up
+    return uart_buffered ? ringbuf_space(&uart_txBuffer) : 0;
+}
+
+void uart_getErrors(uart_errors_t *errors){
+    errors->overruns = uart_errorCounts.overruns;
+    errors->framing = uart_errorCounts.framing;
+    errors->parity = uart_errorCounts.parity;
+    errors->breaks = uart_errorCounts.breaks;
+    errors->dropped = uart_rxBuffer.dropped;
+}
+
+//empty the RX FIFO into uart_rxBuffer, counting errors on the way
+static void uart_drainRxFifo(void){
+    while(!(UART1_FR_R & UART_FR_RXFE)){
+        uint32_t data = UART1_DR_R;
+
+        if(data & UART_DR_OE){
+            uart_errorCounts.overruns++; //a byte before this one was lost
+        }
+        if(data & UART_DR_BE){
+            uart_errorCounts.breaks++;
+        } else if(data & UART_DR_FE){
+            uart_errorCounts.framing++;
+        } else if(data & UART_DR_PE){
+            uart_errorCounts.parity++;
+        }
+
+        if(!(data & UART_DR_ERRORS)){
+            ringbuf_put(&uart_rxBuffer, data & 0xFF); //counts drops when full
+        }
+    }
+}
+
+void uart_interrupt_handler(){
+    uint32_t status = UART1_MIS_R;
+
+    UART1_ICR_R = status;
+
+    if(uart_buffered){
+        //errors arrive with their byte, so draining covers them too
+        if(status & (UART_MIS_RXMIS | UART_MIS_RTMIS | UART_MIS_OEMIS |
+                     UART_MIS_BEMIS | UART_MIS_PEMIS | UART_MIS_FEMIS)){
+            uart_drainRxFifo();
+        }
+
+        if(status & UART_MIS_TXMIS){
+            uart_fillTxFifo();
+            if(ringbuf_count(&uart_txBuffer) == 0){
+                UART1_IM_R &= ~UART_IM_TXIM; //uart_startTx() turns it back on
+            }
+        }
+    }
+
+    //uDMA completions for UART1
+    udma_service((1UL << UDMA_CH_UART1_RX) | (1UL << UDMA_CH_UART1_TX));
+}
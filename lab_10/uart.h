@@ -15,8 +15,24 @@
 #define UART_H_
 
 #include "Timer.h"
+#include "udma.h"
 #include <inc/tm4c123gh6pm.h>
 
+//most segments uart_sendGatherDma() takes at once
+#define UART_DMA_MAX_SEGMENTS 8
+
+//bytes buffered each way after uart_interrupt_init(), powers of two
+#define UART_RX_BUFFER_SIZE 256
+#define UART_TX_BUFFER_SIZE 256
+
+typedef struct {
+    uint32_t overruns; //bytes lost because the RX FIFO was full
+    uint32_t framing;  //bytes with a bad stop bit, not kept
+    uint32_t parity;   //bytes with a parity error, not kept
+    uint32_t breaks;   //line held low for a whole frame
+    uint32_t dropped;  //bytes lost because the RX buffer was full
+} uart_errors_t;
+
 void uart_init(void);
 
 void uart_sendChar(char data);
@@ -25,9 +41,48 @@ char uart_receive(void);
 
 void uart_sendStr(const char *data);
 
+//after uart_init(): turn on the FIFOs and let the UART1 interrupt move bytes
+//between them and two ring buffers. uart_sendChar(), uart_sendStr() and
+//uart_receive() then only wait while a buffer is full or empty, and sleep
+//meanwhile. Send either through the buffer or by DMA, not both at once;
+//the same goes for receiving.
 void uart_interrupt_init();
 
+//UART1 interrupt: ring buffers, error counts and uDMA completions
 void uart_interrupt_handler();
 
+//queue up to length bytes to send, returns how many fit; never waits
+//only call from the program, not from interrupts
+uint16_t uart_write(const void *data, uint16_t length);
+
+//take up to length received bytes, returns how many there were; never waits
+uint16_t uart_read(void *data, uint16_t length);
+
+//received bytes waiting to be read
+uint16_t uart_available(void);
+
+//bytes uart_write() would take right now
+uint16_t uart_txFree(void);
+
+//copy of the receive error counters since uart_interrupt_init()
+void uart_getErrors(uart_errors_t *errors);
+
+//turn on the FIFO and uDMA channels 22 (RX) and 23 (TX) for UART1
+void uart_dmaInit(void);
+
+//send a buffer without the CPU, done is called from the UART1 interrupt
+//returns 0 if a transfer is still running
+int uart_sendBufferDma(const void *data, uint16_t length, udma_callback_t done);
+
+//send up to UART_DMA_MAX_SEGMENTS buffers back to back, e.g. header, payload, crc
+//returns 0 if a transfer is still running or a segment is bad
+int uart_sendGatherDma(const udma_segment_t segments[], uint8_t count, udma_callback_t done);
+
+//receive into two buffers in turn, filled is called with each full buffer
+void uart_receivePingPongDma(void *bufferA, void *bufferB, uint16_t size, udma_callback_t filled);
+
+//1 while a DMA send is in progress
+int uart_dmaBusy(void);
+
 
 #endif /* UART_H_ */
@@ -0,0 +1,313 @@
+/*
+ * udma.c
+ *
+ * Micro DMA control table and channel bookkeeping, see udma.h.
+ *
+ */
+
+#include <stddef.h>
+#ifndef UDMA_HOST
+#include <inc/tm4c123gh6pm.h>
+#include "driverlib/interrupt.h"
+#endif
+#include "udma.h"
+
+#define UDMA_HW ((udma_regs_t *)0x400FF000)
+
+// DMACHCTL fields
+#define UDMA_CTL_DSTINC_8       0x00000000
+#define UDMA_CTL_DSTINC_32      0x80000000
+#define UDMA_CTL_DSTINC_NONE    0xC0000000
+#define UDMA_CTL_DSTSIZE_8      0x00000000
+#define UDMA_CTL_DSTSIZE_32     0x20000000
+#define UDMA_CTL_SRCINC_8       0x00000000
+#define UDMA_CTL_SRCINC_32      0x08000000
+#define UDMA_CTL_SRCINC_NONE    0x0C000000
+#define UDMA_CTL_SRCSIZE_8      0x00000000
+#define UDMA_CTL_SRCSIZE_32     0x02000000
+#define UDMA_CTL_ARB_4          0x00008000  // re-arbitrate every 4 items, the
+                                            // UART FIFO trigger is 4/8
+#define UDMA_CTL_XFERSIZE(n)    ((uint32_t)((n) - 1) << 4)
+#define UDMA_CTL_MODE_M         0x00000007
+
+#define UDMA_MODE_STOP          0
+#define UDMA_MODE_BASIC         1
+#define UDMA_MODE_PINGPONG      3
+#define UDMA_MODE_PER_SG        6
+#define UDMA_MODE_ALT_PER_SG    7
+
+// Byte moves between a UART data register and memory
+#define UDMA_CTL_TX (UDMA_CTL_DSTINC_NONE | UDMA_CTL_DSTSIZE_8 | UDMA_CTL_SRCINC_8 | \
+                     UDMA_CTL_SRCSIZE_8 | UDMA_CTL_ARB_4)
+#define UDMA_CTL_RX (UDMA_CTL_DSTINC_8 | UDMA_CTL_DSTSIZE_8 | UDMA_CTL_SRCINC_NONE | \
+                     UDMA_CTL_SRCSIZE_8 | UDMA_CTL_ARB_4)
+
+// Scatter-gather: the primary copies one 4 word task at a time into the
+// alternate structure
+#define UDMA_CTL_SG (UDMA_CTL_DSTINC_32 | UDMA_CTL_DSTSIZE_32 | UDMA_CTL_SRCINC_32 | \
+                     UDMA_CTL_SRCSIZE_32 | UDMA_CTL_ARB_4)
+
+#define UDMA_PRIMARY 0
+#define UDMA_ALTERNATE UDMA_NUM_CHANNELS
+
+/// What a channel is doing, so udma_service() knows how to finish it
+typedef struct {
+    udma_callback_t callback;
+    void *buffer[2];        // primary and alternate buffer
+    uint16_t length;
+    uint8_t mode;
+} udma_channel_t;
+
+// Primary structures followed by the alternate ones. The controller needs the
+// table on a 1024 byte boundary.
+#ifdef __TI_COMPILER_VERSION__
+#pragma DATA_ALIGN(udma_controlTable, 1024)
+static udma_entry_t udma_controlTable[2 * UDMA_NUM_CHANNELS];
+#else
+static udma_entry_t udma_controlTable[2 * UDMA_NUM_CHANNELS] __attribute__((aligned(1024)));
+#endif
+
+static udma_channel_t udma_channels[UDMA_NUM_CHANNELS];
+static udma_regs_t *udma_hw = UDMA_HW;
+static volatile uint32_t udma_errors = 0;
+static uint8_t udma_ready = 0;
+
+/// Disable a channel and put it back to primary, single+burst requests
+static void udma_resetChannel(uint8_t channel)
+{
+    uint32_t bit = 1UL << channel;
+
+    udma_hw->ENACLR = bit;
+    udma_hw->ALTCLR = bit;
+    udma_hw->USEBURSTCLR = bit;
+    udma_hw->REQMASKCLR = bit;
+    udma_hw->CHIS = bit;
+}
+
+void udma_setRegisterBlock(udma_regs_t *regs)
+{
+    udma_hw = regs;
+    udma_ready = 0;
+}
+
+void udma_init(void)
+{
+    uint8_t i;
+
+    if (udma_ready) {
+        return; // both UART links call this, only the first one sets up
+    }
+    udma_ready = 1;
+
+#ifndef UDMA_HOST
+    if (udma_hw == UDMA_HW) {
+        SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;
+        while (!(SYSCTL_PRDMA_R & SYSCTL_PRDMA_R0));
+    }
+#endif
+
+    udma_hw->CFG = 1; // MASTEN
+    udma_hw->CTLBASE = (uint32_t)(uintptr_t)udma_controlTable;
+
+    for (i = 0; i < UDMA_NUM_CHANNELS; i++) {
+        udma_channels[i].mode = UDMA_MODE_STOP;
+        udma_channels[i].callback = 0;
+    }
+    udma_errors = 0;
+
+#ifndef UDMA_HOST
+    if (udma_hw == UDMA_HW) {
+        IntRegister(INT_UDMAERR, udma_errorHandler);
+        NVIC_EN1_R |= 1 << (INT_UDMAERR - 48);
+    }
+#endif
+}
+
+void udma_assignChannel(uint8_t channel, uint8_t encoding)
+{
+    uint8_t shift = (channel % 8) * 4;
+    volatile uint32_t *map = &udma_hw->CHMAP[channel / 8];
+
+    *map = (*map & ~(0xFUL << shift)) | ((uint32_t)encoding << shift);
+}
+
+void udma_startTx(uint8_t channel, const void *data, uint16_t length,
+                  volatile uint32_t *reg, udma_callback_t callback)
+{
+    udma_entry_t *entry = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_channel_t *state = &udma_channels[channel];
+
+    udma_resetChannel(channel);
+
+    entry->srcEnd = (const uint8_t *)data + length - 1;
+    entry->dstEnd = reg;
+    entry->control = UDMA_CTL_TX | UDMA_CTL_XFERSIZE(length) | UDMA_MODE_BASIC;
+
+    state->callback = callback;
+    state->buffer[0] = (void *)data;
+    state->length = length;
+    state->mode = UDMA_MODE_BASIC;
+
+    udma_hw->ENASET = 1UL << channel;
+}
+
+void udma_startRx(uint8_t channel, volatile uint32_t *reg, void *buffer, uint16_t length,
+                  udma_callback_t callback)
+{
+    udma_entry_t *entry = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_channel_t *state = &udma_channels[channel];
+
+    udma_resetChannel(channel);
+
+    entry->srcEnd = reg;
+    entry->dstEnd = (uint8_t *)buffer + length - 1;
+    entry->control = UDMA_CTL_RX | UDMA_CTL_XFERSIZE(length) | UDMA_MODE_BASIC;
+
+    state->callback = callback;
+    state->buffer[0] = buffer;
+    state->length = length;
+    state->mode = UDMA_MODE_BASIC;
+
+    udma_hw->ENASET = 1UL << channel;
+}
+
+int udma_startGatherTx(uint8_t channel, const udma_segment_t segments[], uint8_t count,
+                       udma_entry_t tasks[], volatile uint32_t *reg,
+                       udma_callback_t callback)
+{
+    udma_entry_t *entry = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_channel_t *state = &udma_channels[channel];
+    uint16_t total = 0;
+    uint8_t i;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        uint16_t length = segments[i].length;
+
+        if (length == 0 || length > UDMA_MAX_TRANSFER) {
+            return 0;
+        }
+
+        // Every task but the last hands control back to the primary
+        tasks[i].srcEnd = (const uint8_t *)segments[i].data + length - 1;
+        tasks[i].dstEnd = reg;
+        tasks[i].control = UDMA_CTL_TX | UDMA_CTL_XFERSIZE(length) |
+                           (i == count - 1 ? UDMA_MODE_BASIC : UDMA_MODE_ALT_PER_SG);
+        tasks[i].unused = 0;
+        total += length;
+    }
+
+    udma_resetChannel(channel);
+
+    entry->srcEnd = &tasks[count - 1].unused;
+    entry->dstEnd = &udma_controlTable[UDMA_ALTERNATE + channel].unused;
+    entry->control = UDMA_CTL_SG | UDMA_CTL_XFERSIZE(count * 4) | UDMA_MODE_PER_SG;
+
+    state->callback = callback;
+    state->buffer[0] = (void *)segments[0].data;
+    state->length = total;
+    state->mode = UDMA_MODE_PER_SG;
+
+    udma_hw->ENASET = 1UL << channel;
+    return 1;
+}
+
+void udma_startPingPongRx(uint8_t channel, volatile uint32_t *reg, void *bufferA,
+                          void *bufferB, uint16_t size, udma_callback_t callback)
+{
+    udma_entry_t *primary = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_entry_t *alternate = &udma_controlTable[UDMA_ALTERNATE + channel];
+    udma_channel_t *state = &udma_channels[channel];
+
+    udma_resetChannel(channel);
+
+    primary->srcEnd = reg;
+    primary->dstEnd = (uint8_t *)bufferA + size - 1;
+    primary->control = UDMA_CTL_RX | UDMA_CTL_XFERSIZE(size) | UDMA_MODE_PINGPONG;
+
+    alternate->srcEnd = reg;
+    alternate->dstEnd = (uint8_t *)bufferB + size - 1;
+    alternate->control = primary->control;
+
+    state->callback = callback;
+    state->buffer[0] = bufferA;
+    state->buffer[1] = bufferB;
+    state->length = size;
+    state->mode = UDMA_MODE_PINGPONG;
+
+    udma_hw->ENASET = 1UL << channel;
+}
+
+void udma_stop(uint8_t channel)
+{
+    udma_hw->ENACLR = 1UL << channel;
+    udma_channels[channel].mode = UDMA_MODE_STOP;
+}
+
+int udma_isBusy(uint8_t channel)
+{
+    return (udma_hw->ENASET & (1UL << channel)) != 0;
+}
+
+/// Hand a finished ping-pong half to the callback and arm it again
+static void udma_finishHalf(uint8_t channel, uint8_t half)
+{
+    udma_entry_t *entry = &udma_controlTable[(half ? UDMA_ALTERNATE : UDMA_PRIMARY) + channel];
+    udma_channel_t *state = &udma_channels[channel];
+
+    if ((entry->control & UDMA_CTL_MODE_M) != UDMA_MODE_STOP) {
+        return; // still filling
+    }
+
+    if (state->callback) {
+        state->callback(channel, state->buffer[half], state->length);
+    }
+
+    entry->control = UDMA_CTL_RX | UDMA_CTL_XFERSIZE(state->length) | UDMA_MODE_PINGPONG;
+}
+
+void udma_service(uint32_t mask)
+{
+    uint32_t pending = udma_hw->CHIS & mask;
+    uint8_t channel;
+
+    udma_hw->CHIS = pending;
+
+    for (channel = 0; pending; channel++, pending >>= 1) {
+        udma_channel_t *state = &udma_channels[channel];
+
+        if (!(pending & 1)) {
+            continue;
+        }
+
+        if (state->mode == UDMA_MODE_PINGPONG) {
+            // Only one half can be full, or both are and the controller has
+            // come back round to the one that filled first
+            uint8_t first = (udma_hw->ALTSET & (1UL << channel)) ? 1 : 0;
+
+            udma_finishHalf(channel, first);
+            udma_finishHalf(channel, !first);
+        } else if (state->mode != UDMA_MODE_STOP) {
+            state->mode = UDMA_MODE_STOP;
+            if (state->callback) {
+                state->callback(channel, state->buffer[0], state->length);
+            }
+        }
+    }
+}
+
+void udma_errorHandler(void)
+{
+    if (udma_hw->ERRCLR) {
+        udma_hw->ERRCLR = 1;
+        udma_errors++;
+    }
+}
+
+uint32_t udma_errorCount(void)
+{
+    return udma_errors;
+}
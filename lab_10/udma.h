@@ -0,0 +1,137 @@
+/*
+ * udma.h
+ *
+ * Driver for the TM4C123 micro DMA controller. Handles the channel control
+ * table, channel assignment and the three transfer shapes the UART links use:
+ *
+ *  - basic: one buffer to/from a peripheral data register
+ *  - scatter-gather: a list of buffers sent back to back as one transfer
+ *  - ping-pong: two receive buffers, one fills while the other is handed to a
+ *    callback and re-armed
+ *
+ * Completion is reported through the interrupt of the peripheral that owns
+ * the channel, so that peripheral's ISR calls udma_service() with its channels.
+ *
+ * All register access goes through a udma_regs_t pointer. On the robot it
+ * points at the controller; on the host udma_setRegisterBlock() can point it
+ * at a plain struct to check the bookkeeping. Built with UDMA_HOST, udma.c
+ * leaves out the clock gating and interrupt setup; tools/udma_test.c does that.
+ *
+ */
+
+#ifndef UDMA_H_
+#define UDMA_H_
+
+#include <stdint.h>
+
+#define UDMA_NUM_CHANNELS 32
+
+/// Channel assignments used by the UART links: channel number, encoding
+#define UDMA_CH_UART1_RX    22
+#define UDMA_CH_UART1_TX    23
+#define UDMA_ENC_UART1      0
+#define UDMA_CH_UART4_RX    18
+#define UDMA_CH_UART4_TX    19
+#define UDMA_ENC_UART4      2
+
+/// Largest transfer of a single control structure
+#define UDMA_MAX_TRANSFER 1024
+
+/// uDMA register block, laid out as in the datasheet starting at 0x400FF000
+typedef struct {
+    volatile uint32_t STAT;         // 0x000
+    volatile uint32_t CFG;          // 0x004
+    volatile uint32_t CTLBASE;      // 0x008
+    volatile uint32_t ALTBASE;      // 0x00C
+    volatile uint32_t WAITSTAT;     // 0x010
+    volatile uint32_t SWREQ;        // 0x014
+    volatile uint32_t USEBURSTSET;  // 0x018
+    volatile uint32_t USEBURSTCLR;  // 0x01C
+    volatile uint32_t REQMASKSET;   // 0x020
+    volatile uint32_t REQMASKCLR;   // 0x024
+    volatile uint32_t ENASET;       // 0x028
+    volatile uint32_t ENACLR;       // 0x02C
+    volatile uint32_t ALTSET;       // 0x030
+    volatile uint32_t ALTCLR;       // 0x034
+    volatile uint32_t PRIOSET;      // 0x038
+    volatile uint32_t PRIOCLR;      // 0x03C
+    uint32_t reserved0[3];          // 0x040 - 0x048
+    volatile uint32_t ERRCLR;       // 0x04C
+    uint32_t reserved1[300];        // 0x050 - 0x4FC
+    volatile uint32_t CHASGN;       // 0x500
+    volatile uint32_t CHIS;         // 0x504
+    uint32_t reserved2[2];          // 0x508 - 0x50C
+    volatile uint32_t CHMAP[4];     // 0x510 - 0x51C
+} udma_regs_t;
+
+/// One entry of the channel control table, also used for scatter-gather tasks
+typedef struct {
+    volatile const void *srcEnd;    // address of the last source byte
+    volatile void *dstEnd;          // address of the last destination byte
+    volatile uint32_t control;      // DMACHCTL word
+    uint32_t unused;
+} udma_entry_t;
+
+/// One buffer of a scatter-gather transmit
+typedef struct {
+    const void *data;
+    uint16_t length;                // 1 - UDMA_MAX_TRANSFER bytes
+} udma_segment_t;
+
+/// \brief Called from the peripheral ISR when a transfer finished
+/// \param channel channel that completed
+/// \param buffer the buffer that was sent, or the ping-pong half that filled
+/// \param length bytes in that buffer
+typedef void (*udma_callback_t)(uint8_t channel, void *buffer, uint16_t length);
+
+/// Point the driver at another register block (host simulation)
+void udma_setRegisterBlock(udma_regs_t *regs);
+
+/// Turn on the controller and install the control table, only the first call
+/// does anything
+void udma_init(void);
+
+/// Route a channel to one of its peripherals (channel encoding 0 - 4)
+void udma_assignChannel(uint8_t channel, uint8_t encoding);
+
+/// \brief Copy length bytes from data to a peripheral register
+/// \param reg peripheral data register, e.g. &UART1_DR_R
+void udma_startTx(uint8_t channel, const void *data, uint16_t length,
+                  volatile uint32_t *reg, udma_callback_t callback);
+
+/// \brief Copy length bytes from a peripheral register into buffer
+void udma_startRx(uint8_t channel, volatile uint32_t *reg, void *buffer, uint16_t length,
+                  udma_callback_t callback);
+
+/// \brief Send several buffers back to back as one transfer
+/// The callback gets the first segment and the total length.
+/// \param tasks caller owned storage for count task entries; it must stay
+/// valid until the callback runs
+/// \return 0 if count is 0 or a segment is empty or too long
+int udma_startGatherTx(uint8_t channel, const udma_segment_t segments[], uint8_t count,
+                       udma_entry_t tasks[], volatile uint32_t *reg,
+                       udma_callback_t callback);
+
+/// \brief Receive continuously into two buffers of size bytes each
+/// The callback gets each buffer as it fills; it is re-armed right after the
+/// callback returns, so copy out what is needed before returning.
+void udma_startPingPongRx(uint8_t channel, volatile uint32_t *reg, void *bufferA,
+                          void *bufferB, uint16_t size, udma_callback_t callback);
+
+/// Stop a channel, pending data is left in the peripheral
+void udma_stop(uint8_t channel);
+
+/// Returns 1 while a channel is enabled
+int udma_isBusy(uint8_t channel);
+
+/// \brief Handle completions for the channels in mask
+/// Call from the ISR of the peripheral that owns the channels.
+void udma_service(uint32_t mask);
+
+/// uDMA error interrupt, counts and clears bus errors
+void udma_errorHandler(void);
+
+/// Number of bus errors seen since udma_init()
+uint32_t udma_errorCount(void);
+
+#endif /* UDMA_H_ */
@@ -0,0 +1,149 @@
+/*
+ * fmt_bench.c
+ *
+ * Host check of lab_10/fmt.c against the C library: every case is formatted
+ * with both fmt_format() and snprintf() and must come out the same, then the
+ * lines the robot actually prints are timed with both.
+ *
+ *     gcc -O2 -I../lab_10 -o fmt_bench fmt_bench.c ../lab_10/fmt.c
+ *     ./fmt_bench
+ *
+ * Floats are handed to snprintf() after going through float, as fmt carries
+ * them in single precision. Exact ties are left out: fmt rounds them away
+ * from zero, the C library to even.
+ *
+ * The timings are the host's, which has a double precision FPU; on the
+ * Cortex-M4F, where the C library's %f runs in software doubles, the gap is
+ * wider. Exits with 1 if any case differs.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "fmt.h"
+
+#define BENCH_ROUNDS 200000
+
+static int failures = 0;
+static int cases = 0;
+
+#define CHECK(format, ...)                                                     \
+    do {                                                                       \
+        char expected[128];                                                    \
+        char got[128];                                                         \
+        fmt_t f;                                                               \
+                                                                               \
+        snprintf(expected, sizeof(expected), format, __VA_ARGS__);             \
+        fmt_buffer(&f, got, sizeof(got));                                      \
+        fmt_format(&f, format, __VA_ARGS__);                                   \
+        cases++;                                                               \
+        if (strcmp(expected, got) != 0) {                                      \
+            printf("DIFF %-12s snprintf \"%s\" fmt \"%s\"\n", format, expected, got); \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+// A float as the robot would pass it, as a double for the varargs
+#define F(x) ((double)(float)(x))
+
+static void checkIntegers(void)
+{
+    CHECK("%d", 0);
+    CHECK("%d|%5d|%-5d|%05d", -42, 42, -42, -42);
+    CHECK("%d %i", (int)-2147483647 - 1, 2147483647);
+    CHECK("%u %x %X %08X", 4000000000u, 255u, 0xBEEFu, 0x12u);
+    CHECK("%c|%3c|%-3c|", 'q', 'r', 's');
+    CHECK("%s|%.3s|%-6s|%6s|%%", "hi", "abcdef", "ab", "cd");
+}
+
+// fmt_u64() has no conversion of its own, so it is checked against %llu
+static void checkU64(unsigned long long value, int8_t width)
+{
+    char expected[32];
+    char got[32];
+    fmt_t f;
+
+    snprintf(expected, sizeof(expected), "%*llu", width, value);
+    fmt_buffer(&f, got, sizeof(got));
+    fmt_u64(&f, value, width);
+    cases++;
+    if (strcmp(expected, got) != 0) {
+        printf("DIFF fmt_u64     snprintf \"%s\" fmt \"%s\"\n", expected, got);
+        failures++;
+    }
+}
+
+static void checkFloats(void)
+{
+    CHECK("%f", F(0.0));
+    CHECK("%f", F(3000.0));
+    CHECK("%f", F(-2147.49));
+    CHECK("%f", F(1.0e9));
+    CHECK("%.2f", F(-0.001));
+    CHECK("%.2f", F(-0.004));
+    CHECK("%.2f", F(12.3456));
+    CHECK("%.0f", F(0.7));
+    CHECK("%.0f", F(-1234.6));
+    CHECK("%6.1f|%-7.3f|%06.2f", F(3.14159), F(-1.5), F(-3.2));
+    CHECK("%.1f", F(9.96));
+    CHECK("%.3f", F(0.0626));
+    CHECK("Object @ Angle:%d Distance:%d LWidth:%.2f\n", 90, 45, F(12.3456));
+}
+
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Keep the optimizer from dropping the formatting
+static volatile char sink;
+
+static void bench(const char *name, const char *format, int angle, int distance,
+                  double width)
+{
+    char line[64];
+    double start;
+    double libc;
+    double own;
+    int i;
+
+    start = seconds();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        snprintf(line, sizeof(line), format, angle + (i & 7), distance, width);
+        sink = line[0];
+    }
+    libc = seconds() - start;
+
+    start = seconds();
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        fmt_t f;
+
+        fmt_buffer(&f, line, sizeof(line));
+        fmt_format(&f, format, angle + (i & 7), distance, width);
+        sink = line[0];
+    }
+    own = seconds() - start;
+
+    printf("%-8s snprintf %6.0f ns  fmt %6.0f ns  (%.1fx)\n", name,
+           libc / BENCH_ROUNDS * 1e9, own / BENCH_ROUNDS * 1e9, libc / own);
+}
+
+int main(void)
+{
+    checkIntegers();
+    checkU64(0, 0);
+    checkU64(4294967295ull, 0);
+    checkU64(4294967296ull, 12);
+    checkU64(1000000000000000000ull, -22);
+    checkU64(18446744073709551615ull, 0);
+    checkFloats();
+    printf("%d of %d cases match snprintf\n", cases - failures, cases);
+
+    bench("object", "Object @ Angle:%d Distance:%d LWidth:%.2f\n", 90, 45, F(12.3456));
+    bench("lcd", "%d \nClockwise %d %.1f", 135, 0, F(-7.3));
+
+    return failures ? 1 : 0;
+}
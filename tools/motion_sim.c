@@ -0,0 +1,253 @@
+/*
+ * motion_sim.c
+ *
+ * Host simulation of the motion queue in lab_10/movement.c. motion_poll()
+ * drives a simple two-wheel robot: each wheel follows its command with a
+ * 50 ms lag, one wheel is weaker than the other, and the encoders only count
+ * whole ticks, in 16 bits that wrap. The sensors update every 15 or 16 ms,
+ * like the OI stream, and go through oi_odometryUpdate() as on the robot.
+ *
+ *     gcc -O2 -Wall -DMOVEMENT_HOST -I../lab_10 -o motion_sim motion_sim.c \
+ *         ../lab_10/movement.c ../lab_10/oi_odometry.c -lm
+ *     ./motion_sim
+ *
+ * After every move the robot's true position and heading have to be within a
+ * few mm and a degree or two of the target, and no wheel command may leave
+ * the OI's +-500 mm/s. Most of what is left is the wheels coasting through
+ * their lag after the stop, turns overshoot by a little over a degree.
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "movement.h"
+#include "oi_odometry.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define TICKS_PER_MM (508.8 / (72.0 * M_PI))
+#define WHEEL_BASE 235.0    // mm
+#define MOTOR_LAG 0.05      // s, time constant of a wheel following its command
+#define MOVE_LIMIT 30000    // ms a single move may take
+
+#define DEG(radians) ((radians) * 180.0 / M_PI)
+
+// The robot
+static struct {
+    double left;            // wheel travel, mm
+    double right;
+    double leftSpeed;       // mm/s
+    double rightSpeed;
+    double leftGain;        // speed a wheel reaches per mm/s commanded
+    double rightGain;
+    double x;               // mm
+    double y;
+    double heading;         // radians, counter-clockwise
+} robot;
+
+static int16_t commandLeft;
+static int16_t commandRight;
+static int worstCommand;    // largest |command| seen
+static unsigned int millis;
+static unsigned int updates;
+static oi_t sensor;
+
+void oi_setWheels(int16_t right_wheel, int16_t left_wheel)
+{
+    commandRight = right_wheel;
+    commandLeft = left_wheel;
+    if (abs(right_wheel) > worstCommand) {
+        worstCommand = abs(right_wheel);
+    }
+    if (abs(left_wheel) > worstCommand) {
+        worstCommand = abs(left_wheel);
+    }
+}
+
+unsigned int timer_getMillis(void)
+{
+    return millis;
+}
+
+/// Run the robot for ms milliseconds in 1 ms steps
+static void step(unsigned int ms)
+{
+    double follow = 1.0 - exp(-0.001 / MOTOR_LAG);
+
+    while (ms--) {
+        double dl;
+        double dr;
+        double turn;
+
+        robot.leftSpeed += (commandLeft * robot.leftGain - robot.leftSpeed) * follow;
+        robot.rightSpeed += (commandRight * robot.rightGain - robot.rightSpeed) * follow;
+        dl = robot.leftSpeed * 0.001;
+        dr = robot.rightSpeed * 0.001;
+        turn = (dr - dl) / WHEEL_BASE;
+
+        robot.left += dl;
+        robot.right += dr;
+        robot.x += (dl + dr) / 2 * cos(robot.heading + turn / 2);
+        robot.y += (dl + dr) / 2 * sin(robot.heading + turn / 2);
+        robot.heading += turn;
+        millis++;
+    }
+}
+
+/// Read the encoders as the OI reports them: whole ticks, 16 bits, starting
+/// close to the wrap
+static void sense(oi_t *self)
+{
+    self->leftEncoderCount = (int16_t)(32000 + (int32_t)floor(robot.left * TICKS_PER_MM));
+    self->rightEncoderCount = (int16_t)(32000 + (int32_t)floor(robot.right * TICKS_PER_MM));
+    oi_odometryUpdate(self);
+}
+
+/// One sensor update: 15 ms, every third one 16 ms
+void oi_update(oi_t *self)
+{
+    step(++updates % 3 ? 15 : 16);
+    sense(self);
+}
+
+static void place(double leftGain, double rightGain)
+{
+    memset(&robot, 0, sizeof(robot));
+    robot.leftGain = leftGain;
+    robot.rightGain = rightGain;
+    commandLeft = 0;
+    commandRight = 0;
+    worstCommand = 0;
+
+    memset(&sensor, 0, sizeof(sensor));
+    sense(&sensor); // primes the odometry
+}
+
+/// Poll the queue until it is empty, then let the wheels run down
+static void run(void)
+{
+    unsigned int start = millis;
+
+    motion_poll(&sensor);
+    while (!motion_is_done() && millis - start < MOVE_LIMIT) {
+        oi_update(&sensor);
+        motion_poll(&sensor);
+    }
+    CHECK(motion_is_done());
+    CHECK(commandLeft == 0 && commandRight == 0);
+    step(500);
+}
+
+/// Wrap to -pi..pi
+static double angleError(double radians)
+{
+    return atan2(sin(radians), cos(radians));
+}
+
+static void report(const char *what)
+{
+    printf("%-34s x %7.1f mm  y %6.1f mm  heading %7.2f deg  |wheel| <= %d\n",
+           what, robot.x, robot.y, DEG(robot.heading), worstCommand);
+}
+
+static void checkStraight(void)
+{
+    place(1.0, 0.97);
+    motion_start_forward(100);
+    run();
+    report("forward 100 cm, right wheel -3%");
+
+    CHECK(fabs(robot.x - 1000) <= 5);
+    CHECK(fabs(robot.y) <= 20);
+    CHECK(fabs(DEG(robot.heading)) <= 1);
+    CHECK(worstCommand <= 500);
+
+    place(0.97, 1.0);
+    move_backward(&sensor, 50);
+    step(500);
+    report("move_backward 50 cm, left wheel -3%");
+
+    CHECK(fabs(robot.x + 500) <= 5);
+    CHECK(fabs(robot.y) <= 20);
+    CHECK(fabs(DEG(robot.heading)) <= 1);
+    CHECK(worstCommand <= 500);
+}
+
+static void checkTurns(void)
+{
+    place(1.0, 0.97);
+    motion_start_turn_clockwise(90);
+    run();
+    report("turn clockwise 90");
+
+    CHECK(fabs(DEG(angleError(robot.heading + M_PI / 2))) <= 2);
+    CHECK(hypot(robot.x, robot.y) <= 10); // in place
+    CHECK(worstCommand <= MOTION_MAX_TURN_SPEED);
+
+    place(0.97, 1.0);
+    turn_counterclockwise(&sensor, 180);
+    step(500);
+    report("turn_counterclockwise 180");
+
+    CHECK(fabs(DEG(angleError(robot.heading - M_PI))) <= 2);
+    CHECK(hypot(robot.x, robot.y) <= 10);
+}
+
+static void checkSequence(void)
+{
+    // An L with a reverse at the end, queued all at once
+    place(1.0, 0.97);
+    CHECK(motion_start_forward(50));
+    CHECK(motion_start_turn_counterclockwise(90));
+    CHECK(motion_start_forward(50));
+    CHECK(motion_start_backward(20));
+    run();
+    report("forward 50, left 90, forward 50, back 20");
+
+    CHECK(fabs(robot.x - 500) <= 15);
+    CHECK(fabs(robot.y - 300) <= 15);
+    CHECK(fabs(DEG(angleError(robot.heading - M_PI / 2))) <= 1.5);
+    CHECK(worstCommand <= 500);
+}
+
+static void checkWheelLimit(void)
+{
+    // Top speed and a wheel far off: the correction has to come out of the
+    // speed, not push a wheel past 500
+    motion_setProfile(500, 500, 1000);
+    place(1.0, 0.85);
+    motion_start_forward(200);
+    run();
+    report("forward 200 cm at 500, right -15%");
+
+    CHECK(fabs(robot.x - 2000) <= 10);
+    CHECK(fabs(robot.y) <= 50);
+    CHECK(fabs(DEG(robot.heading)) <= 2);
+    CHECK(worstCommand <= 500);
+    CHECK(worstCommand >= 450);
+
+    motion_setProfile(MOTION_MAX_SPEED, MOTION_MAX_TURN_SPEED, MOTION_ACCEL);
+}
+
+int main(void)
+{
+    checkStraight();
+    checkTurns();
+    checkSequence();
+    checkWheelLimit();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+/*
+ * odometry_bench.c
+ *
+ * Host check of the Q16 odometry in lab_10/oi_odometry.c against the double
+ * formulas it replaced (oi_getDistance() and oi_getDegrees() before the
+ * change), then a timing of both over the same encoder readings, the double
+ * one also with the pose integrated in double for a like for like cost.
+ *
+ *     gcc -O2 -I../lab_10 -o odometry_bench odometry_bench.c \
+ *         ../lab_10/oi_odometry.c -lm
+ *     ./odometry_bench
+ *
+ * The encoder readings are a random drive at up to about 600 mm/s, sampled
+ * every 15 ms, with the 16-bit counters wrapping. Every update's distance and
+ * angle must be within 1 um and 1 millidegree of the double results, and the
+ * heading after the whole drive within 1 millidegree of the double sum. The
+ * pose, integrated in single precision, has to stay within 10 mm of a double
+ * integration over the drive.
+ *
+ * Costs are in TSC cycles on x86 and nanoseconds elsewhere. The host has a
+ * double precision FPU, so the double formulas are cheap here; on the
+ * Cortex-M4F every double operation is a library call. Exits with 1 if any
+ * check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "oi_odometry.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define COST_UNIT "cycles"
+static uint64_t now(void) { return __rdtsc(); }
+#else
+#define COST_UNIT "ns"
+static uint64_t now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+#endif
+
+#define UPDATES 200000
+#define MAX_STEP 20 // ticks per 15 ms, about 600 mm/s
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond, ...)                                                       \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL " __VA_ARGS__);                                       \
+            printf("\n");                                                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int16_t leftCounts[UPDATES];
+static int16_t rightCounts[UPDATES];
+
+// The old double math, as it ran on every update
+typedef struct {
+    int16_t prevLeft;
+    int16_t prevRight;
+    double distance;    // mm
+    double degrees;
+} double_odometry_t;
+
+static void doubleUpdate(double_odometry_t *d, int16_t left, int16_t right)
+{
+    int16_t leftEncoderDiff = left - d->prevLeft;
+    int16_t rightEncoderDiff = right - d->prevRight;
+    double distLeft = leftEncoderDiff * (72.00 * M_PI / 508.8);
+    double distRight = rightEncoderDiff * (72.00 * M_PI / 508.8);
+    double radians = (distRight - distLeft) / 235.00;
+
+    d->prevLeft = left;
+    d->prevRight = right;
+    d->distance = (distLeft + distRight) / 2.00;
+    d->degrees = radians * 180.00 / M_PI;
+}
+
+/// The same pose integration in double, what keeping the pose would cost
+static void doublePose(double_odometry_t *d, double pose[3])
+{
+    double middle = (pose[2] + d->degrees / 2) * (M_PI / 180);
+
+    pose[0] += d->distance * cos(middle);
+    pose[1] += d->distance * sin(middle);
+    pose[2] += d->degrees;
+}
+
+static void drive(void)
+{
+    int16_t left = 30000; // Close to the wrap, it is crossed early on
+    int16_t right = -30000;
+    int leftSpeed = 0;
+    int rightSpeed = 0;
+    int i;
+
+    srand(1);
+    for (i = 0; i < UPDATES; i++) {
+        // Speeds drift, so the run has straights, arcs and turns in place
+        leftSpeed += rand() % 5 - 2;
+        rightSpeed += rand() % 5 - 2;
+        leftSpeed = leftSpeed > MAX_STEP ? MAX_STEP : leftSpeed < -MAX_STEP ? -MAX_STEP : leftSpeed;
+        rightSpeed = rightSpeed > MAX_STEP ? MAX_STEP : rightSpeed < -MAX_STEP ? -MAX_STEP : rightSpeed;
+        left += leftSpeed;
+        right += rightSpeed;
+        leftCounts[i] = left;
+        rightCounts[i] = right;
+    }
+}
+
+static void start(oi_t *s, double_odometry_t *d)
+{
+    memset(s, 0, sizeof(*s));
+    s->leftEncoderCount = leftCounts[0];
+    s->rightEncoderCount = rightCounts[0];
+    oi_odometryUpdate(s); // Primes with the first reading
+
+    memset(d, 0, sizeof(*d));
+    d->prevLeft = leftCounts[0];
+    d->prevRight = rightCounts[0];
+}
+
+static void checkAgainstDouble(void)
+{
+    oi_t s;
+    double_odometry_t d;
+    double heading = 0;
+    double x = 0;
+    double y = 0;
+    double path = 0;
+    double worstDistance = 0;
+    double worstAngle = 0;
+    int i;
+
+    start(&s, &d);
+    for (i = 1; i < UPDATES; i++) {
+        double distanceError;
+        double angleError;
+
+        s.leftEncoderCount = leftCounts[i];
+        s.rightEncoderCount = rightCounts[i];
+        oi_odometryUpdate(&s);
+        doubleUpdate(&d, leftCounts[i], rightCounts[i]);
+
+        x += d.distance * cos((heading + d.degrees / 2) * M_PI / 180);
+        y += d.distance * sin((heading + d.degrees / 2) * M_PI / 180);
+        heading += d.degrees;
+        path += fabs(d.distance);
+
+        distanceError = fabs(s.distanceMicrons - d.distance * 1000);
+        angleError = fabs(s.angleMillidegrees - d.degrees * 1000);
+        worstDistance = distanceError > worstDistance ? distanceError : worstDistance;
+        worstAngle = angleError > worstAngle ? angleError : worstAngle;
+    }
+
+    CHECK(worstDistance <= 1.0, "distance off by %.3f um", worstDistance);
+    CHECK(worstAngle <= 1.0, "angle off by %.3f mdeg", worstAngle);
+    CHECK(fabs(s.pose.heading - heading * 1000) <= 1.0, "heading %ld mdeg, double %.1f",
+          (long)s.pose.heading, heading * 1000);
+    CHECK(hypot(s.pose.x / 1000.0 - x, s.pose.y / 1000.0 - y) <= 10.0, "pose %.1f, %.1f mm",
+          s.pose.x / 1000.0, s.pose.y / 1000.0);
+
+    printf("worst update: distance %.3f um, angle %.3f mdeg\n", worstDistance, worstAngle);
+    printf("after %.0f m: heading %ld mdeg (double %.1f), pose %.1f, %.1f mm "
+           "(double %.1f, %.1f)\n",
+           path / 1000, (long)s.pose.heading, heading * 1000,
+           s.pose.x / 1000.0, s.pose.y / 1000.0, x, y);
+}
+
+static void checkReset(void)
+{
+    oi_t s;
+    oi_pose_t pose;
+
+    // Straight ahead along +y after a reset facing 90 degrees
+    memset(&s, 0, sizeof(s));
+    oi_odometryUpdate(&s);
+    oi_resetPose(&s, 1000, 2000, 90000);
+    s.leftEncoderCount = 1000;
+    s.rightEncoderCount = 1000;
+    oi_odometryUpdate(&s);
+    oi_getPose(&s, &pose);
+
+    CHECK(s.distanceMicrons == 444565, "1000 ticks are %ld um", (long)s.distanceMicrons);
+    CHECK(s.angleMillidegrees == 0 && pose.heading == 90000, "heading %ld", (long)pose.heading);
+    CHECK(abs(pose.x - 1000) <= 20 && abs(pose.y - (2000 + 444565)) <= 20,
+          "pose %ld, %ld", (long)pose.x, (long)pose.y);
+}
+
+static volatile int32_t sink;
+static volatile double doubleSink;
+
+static void bench(void)
+{
+    oi_t s;
+    double_odometry_t d;
+    uint64_t begin;
+    uint64_t fixed;
+    uint64_t floating;
+    uint64_t floatingPose;
+    double pose[3] = {0, 0, 0};
+    int i;
+
+    start(&s, &d);
+    begin = now();
+    for (i = 1; i < UPDATES; i++) {
+        s.leftEncoderCount = leftCounts[i];
+        s.rightEncoderCount = rightCounts[i];
+        oi_odometryUpdate(&s);
+        sink = s.distanceMicrons + s.angleMillidegrees;
+    }
+    fixed = now() - begin;
+
+    begin = now();
+    for (i = 1; i < UPDATES; i++) {
+        doubleUpdate(&d, leftCounts[i], rightCounts[i]);
+        doubleSink = d.distance + d.degrees;
+    }
+    floating = now() - begin;
+
+    start(&s, &d);
+    begin = now();
+    for (i = 1; i < UPDATES; i++) {
+        doubleUpdate(&d, leftCounts[i], rightCounts[i]);
+        doublePose(&d, pose);
+        doubleSink = pose[0] + pose[1];
+    }
+    floatingPose = now() - begin;
+
+    printf("%s per update:\n", COST_UNIT);
+    printf("  Q16 distance/angle, float pose   %6.1f\n", (double)fixed / UPDATES);
+    printf("  double distance/angle            %6.1f\n", (double)floating / UPDATES);
+    printf("  double distance/angle and pose   %6.1f\n", (double)floatingPose / UPDATES);
+}
+
+int main(void)
+{
+    drive();
+    checkAgainstDouble();
+    checkReset();
+    bench();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * oi_packets_test.c
+ *
+ * Host check of the table driven sensor decoder in lab_10/oi_packets.c against
+ * golden packets: a full group 100 reply, the response to a query list, stream
+ * frame payloads, and decoding limited to the packets in use.
+ *
+ *     gcc -O2 -Wall -I../lab_10 -o oi_packets_test oi_packets_test.c \
+ *         ../lab_10/oi_packets.c
+ *     ./oi_packets_test
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "oi_packets.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+// Group 100 reply, packets 7 - 58 in order, big endian
+static const uint8_t group100[OI_GROUP100_SIZE] = {
+    0x0B,                   //  7 wheel drop left, bump left and right
+    0x01,                   //  8 wall
+    0x00, 0x01, 0x00, 0x00, //  9 - 12 cliff front left
+    0x00,                   // 13 virtual wall
+    0x11,                   // 14 overcurrent left wheel and side brush
+    0x05,                   // 15 dirt
+    0x00,                   // 16 unused
+    0xA1,                   // 17 IR omni
+    0x84,                   // 18 clock and dock buttons
+    0x12, 0x34,             // 19 distance, not decoded
+    0xFF, 0xFE,             // 20 angle, not decoded
+    0x02,                   // 21 charging state
+    0x3A, 0x98,             // 22 15000 mV
+    0xFE, 0x0C,             // 23 -500 mA
+    0xE7,                   // 24 -25 C
+    0x0A, 0x8C,             // 25 2700 mAh
+    0x0B, 0xB8,             // 26 3000 mAh
+    0x00, 0x64,             // 27 wall signal 100
+    0x0A, 0xBC,             // 28 cliff left signal 2748
+    0x01, 0x00,             // 29 256
+    0x02, 0x00,             // 30 512
+    0x0F, 0xFF,             // 31 4095
+    0x00,                   // 32 unused
+    0x00, 0x00,             // 33 unused
+    0x02,                   // 34 home base
+    0x03,                   // 35 safe mode
+    0x04,                   // 36 song 4
+    0x00,                   // 37 not playing
+    0x07,                   // 38 stream packets
+    0x00, 0x64,             // 39 requested velocity 100
+    0x00, 0x20,             // 40 requested radius 32
+    0x01, 0xF4,             // 41 requested right 500
+    0xFE, 0x0C,             // 42 requested left -500
+    0xC3, 0x50,             // 43 left encoder 50000
+    0x00, 0x7B,             // 44 right encoder 123
+    0x21,                   // 45 light bumper right and left
+    0x00, 0x0A,             // 46 - 51 light bump signals 10 - 60
+    0x00, 0x14,
+    0x00, 0x1E,
+    0x00, 0x28,
+    0x00, 0x32,
+    0x00, 0x3C,
+    0xA8,                   // 52 IR left
+    0xA9,                   // 53 IR right
+    0xFF, 0x9C,             // 54 left motor -100 mA
+    0x00, 0x64,             // 55 right motor 100 mA
+    0x01, 0x00,             // 56 main brush 256 mA
+    0x00, 0x10,             // 57 side brush 16 mA
+    0x01,                   // 58 stasis
+};
+
+#define ENCODERS (OI_PACKET_BIT(OI_PACKET_LEFT_ENCODER) | OI_PACKET_BIT(OI_PACKET_RIGHT_ENCODER))
+
+/// Packets 7 - 58 that land in oi_t; the unused ids and distance/angle do not
+static uint64_t decodedIds(void)
+{
+    uint64_t mask = 0;
+    uint8_t id;
+
+    for (id = OI_PACKET_BUMPS_WHEELDROPS; id <= OI_PACKET_STASIS; id++) {
+        if (id != 16 && id != 19 && id != 20 && id != 32 && id != 33) {
+            mask |= OI_PACKET_BIT(id);
+        }
+    }
+    return mask;
+}
+
+static void checkGroup100(void)
+{
+    oi_t s;
+
+    memset(&s, 0, sizeof(s));
+    CHECK(oi_packets_decodeGroup100(&s, group100, OI_PACKETS_ALL) == decodedIds());
+
+    CHECK(s.wheelDropLeft == 1 && s.wheelDropRight == 0);
+    CHECK(s.bumpLeft == 1 && s.bumpRight == 1);
+    CHECK(s.wallSensor == 1);
+    CHECK(s.cliffLeft == 0 && s.cliffFrontLeft == 1 && s.cliffFrontRight == 0 && s.cliffRight == 0);
+    CHECK(s.virtualWall == 0);
+    CHECK(s.overcurrentLeftWheel == 1 && s.overcurrentRightWheel == 0);
+    CHECK(s.overcurrentMainBrush == 0 && s.overcurrentSideBrush == 1);
+    CHECK(s.dirtDetect == 5);
+    CHECK((uint8_t)s.infraredCharOmni == 0xA1);
+    CHECK(s.buttonClock == 1 && s.buttonDock == 1);
+    CHECK(s.buttonSchedule == 0 && s.buttonDay == 0 && s.buttonHour == 0);
+    CHECK(s.buttonMinute == 0 && s.buttonSpot == 0 && s.buttonClean == 0);
+    CHECK(s.chargingState == 2);
+    CHECK(s.batteryVoltage == 15000);
+    CHECK(s.batteryCurrent == -500);
+    CHECK((int8_t)s.batteryTemperature == -25);
+    CHECK(s.batteryCharge == 2700 && s.batteryCapacity == 3000);
+    CHECK(s.wallSignal == 100);
+    CHECK(s.cliffLeftSignal == 2748 && s.cliffFrontLeftSignal == 256);
+    CHECK(s.cliffFrontRightSignal == 512 && s.cliffRightSignal == 4095);
+    CHECK(s.chargingSourcesAvailable == 2 && s.oiMode == 3);
+    CHECK(s.songNumber == 4 && s.songPlaying == 0 && s.numberOfStreamPackets == 7);
+    CHECK(s.requestedVelocity == 100 && s.requestedRadius == 32);
+    CHECK(s.requestedRightVelocity == 500 && s.requestedLeftVelocity == -500);
+    CHECK(s.leftEncoderCount == (int16_t)50000 && s.rightEncoderCount == 123);
+    CHECK(s.lightBumperRight == 1 && s.lightBumperLeft == 1);
+    CHECK(s.lightBumperFrontRight == 0 && s.lightBumperCenterRight == 0);
+    CHECK(s.lightBumperCenterLeft == 0 && s.lightBumperFrontLeft == 0);
+    CHECK(s.lightBumpLeftSignal == 10 && s.lightBumpFrontLeftSignal == 20);
+    CHECK(s.lightBumpCenterLeftSignal == 30 && s.lightBumpCenterRightSignal == 40);
+    CHECK(s.lightBumpFrontRightSignal == 50 && s.lightBumpRightSignal == 60);
+    CHECK((uint8_t)s.infraredCharLeft == 0xA8 && (uint8_t)s.infraredCharRight == 0xA9);
+    CHECK(s.leftMotorCurrent == -100 && s.rightMotorCurrent == 100);
+    CHECK(s.mainBrushMotorCurrent == 256 && s.sideBrushMotorCurrent == 16);
+    CHECK(s.stasis == 1);
+
+    // The odometry is left to the caller
+    CHECK(s.distanceMicrons == 0 && s.angleMillidegrees == 0);
+}
+
+static void checkLazy(void)
+{
+    uint64_t inUse = OI_PACKET_BIT(OI_PACKET_BUMPS_WHEELDROPS) | ENCODERS;
+    oi_t s;
+
+    memset(&s, 0, sizeof(s));
+    s.batteryVoltage = 1234;
+    s.wallSignal = 77;
+    s.stasis = 0;
+
+    // Only what is in use is touched, the rest keeps its last value
+    CHECK(oi_packets_decodeGroup100(&s, group100, inUse) == inUse);
+    CHECK(s.bumpLeft == 1 && s.wheelDropLeft == 1);
+    CHECK(s.leftEncoderCount == (int16_t)50000 && s.rightEncoderCount == 123);
+    CHECK(s.batteryVoltage == 1234 && s.wallSignal == 77 && s.stasis == 0);
+    CHECK(s.cliffFrontLeft == 0 && s.batteryCurrent == 0);
+
+    CHECK(oi_packets_decode(&s, OI_PACKET_VOLTAGE, &group100[17], inUse) == 0);
+    CHECK(s.batteryVoltage == 1234);
+    CHECK(oi_packets_decode(&s, OI_PACKET_VOLTAGE, &group100[17], OI_PACKETS_ALL) ==
+          OI_PACKET_BIT(OI_PACKET_VOLTAGE));
+    CHECK(s.batteryVoltage == 15000);
+}
+
+static void checkQueryList(void)
+{
+    static const uint8_t ids[] = {
+        OI_PACKET_BUMPS_WHEELDROPS, OI_PACKET_LEFT_ENCODER, OI_PACKET_RIGHT_ENCODER,
+        OI_PACKET_CURRENT, OI_PACKET_LIGHT_BUMPER
+    };
+    // What the robot answers, packets back to back in request order
+    static const uint8_t response[] = {0x0B, 0xC3, 0x50, 0x00, 0x7B, 0xFE, 0x0C, 0x21};
+    uint8_t tooMany[OI_QUERY_MAX_PACKETS + 1];
+    oi_queryList_t list;
+    oi_t s;
+
+    CHECK(oi_queryListInit(&list, ids, sizeof(ids)));
+    CHECK(list.count == 5 && list.responseLength == sizeof(response));
+    CHECK(list.offsets[0] == 0 && list.offsets[1] == 1 && list.offsets[2] == 3);
+    CHECK(list.offsets[3] == 5 && list.offsets[4] == 7);
+
+    memset(&s, 0, sizeof(s));
+    s.batteryVoltage = 1234;
+    CHECK(oi_packets_decodeList(&s, &list, response, OI_PACKETS_ALL) ==
+          (OI_PACKET_BIT(OI_PACKET_BUMPS_WHEELDROPS) | ENCODERS |
+           OI_PACKET_BIT(OI_PACKET_CURRENT) | OI_PACKET_BIT(OI_PACKET_LIGHT_BUMPER)));
+    CHECK(s.bumpRight == 1 && s.wheelDropRight == 0);
+    CHECK(s.leftEncoderCount == (int16_t)50000 && s.rightEncoderCount == 123);
+    CHECK(s.batteryCurrent == -500);
+    CHECK(s.lightBumperRight == 1 && s.lightBumperCenterLeft == 0);
+    CHECK(s.batteryVoltage == 1234);
+
+    // A list answered in full but only partly in use
+    memset(&s, 0, sizeof(s));
+    CHECK(oi_packets_decodeList(&s, &list, response, ENCODERS) == ENCODERS);
+    CHECK(s.bumpRight == 0 && s.batteryCurrent == 0 && s.rightEncoderCount == 123);
+
+    // Groups, ids past 58 and overlong lists are refused
+    CHECK(!oi_queryListInit(&list, (const uint8_t[]){OI_PACKET_WALL, 6}, 2));
+    CHECK(list.count == 0);
+    CHECK(!oi_queryListInit(&list, (const uint8_t[]){59}, 1));
+    CHECK(!oi_queryListInit(&list, (const uint8_t[]){100}, 1));
+    CHECK(!oi_queryListInit(&list, ids, 0));
+    memset(tooMany, OI_PACKET_WALL, sizeof(tooMany));
+    CHECK(!oi_queryListInit(&list, tooMany, sizeof(tooMany)));
+    CHECK(oi_queryListInit(&list, tooMany, OI_QUERY_MAX_PACKETS));
+    CHECK(list.responseLength == OI_QUERY_MAX_PACKETS);
+}
+
+static void checkStream(void)
+{
+    uint8_t payload[1 + OI_GROUP100_SIZE];
+    static const uint8_t subset[] = {7, 0x02, 43, 0x00, 0x05, 44, 0xFF, 0xFF};
+    oi_t s;
+
+    memset(&s, 0, sizeof(s));
+    CHECK(oi_packets_decodeStream(&s, subset, sizeof(subset), OI_PACKETS_ALL) ==
+          (OI_PACKET_BIT(OI_PACKET_BUMPS_WHEELDROPS) | ENCODERS));
+    CHECK(s.bumpLeft == 1 && s.bumpRight == 0);
+    CHECK(s.leftEncoderCount == 5 && s.rightEncoderCount == -1);
+
+    // Group 100 inside a frame
+    payload[0] = 100;
+    memcpy(payload + 1, group100, OI_GROUP100_SIZE);
+    memset(&s, 0, sizeof(s));
+    CHECK(oi_packets_decodeStream(&s, payload, sizeof(payload), ENCODERS) == ENCODERS);
+    CHECK(s.rightEncoderCount == 123 && s.batteryVoltage == 0);
+
+    // A payload that does not match the table decodes nothing
+    CHECK(oi_packets_decodeStream(&s, subset, sizeof(subset) - 1, OI_PACKETS_ALL) == 0);
+    CHECK(oi_packets_decodeStream(&s, (const uint8_t[]){3, 0}, 2, OI_PACKETS_ALL) == 0);
+    CHECK(oi_packets_decodeStream(&s, payload, sizeof(payload) - 1, OI_PACKETS_ALL) == 0);
+}
+
+int main(void)
+{
+    checkGroup100();
+    checkLazy();
+    checkQueryList();
+    checkStream();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * oi_stream_test.c
+ *
+ * Host check of the sensor stream framer in lab_10/oi_stream.c. A recorded
+ * stream of packet 7 (bumps and wheel drops) and packet 25 (battery charge)
+ * frames is fed through a ring buffer the way the UART4 interrupt and
+ * oi_streamUpdate() pass it, with a corrupted byte, a frame cut short and a
+ * start in the middle of a frame.
+ *
+ *     gcc -O2 -Wall -I../lab_10 -o oi_stream_test oi_stream_test.c \
+ *         ../lab_10/oi_stream.c ../lab_10/ringbuf.c
+ *     ./oi_stream_test
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "oi_stream.h"
+#include "ringbuf.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define FRAME_BYTES 8
+
+// [19] [5] [7] bumps [25] charge high, low [checksum]
+static const uint8_t recorded[][FRAME_BYTES] = {
+    {19, 5, 7, 0x00, 25, 0x0B, 0xB8, 5},
+    {19, 5, 7, 0x01, 25, 0x0B, 0xB7, 5},
+    {19, 5, 7, 0x13, 25, 0x00, 0x13, 162},  // 19s in the data
+    {19, 5, 7, 0x02, 25, 0x0B, 0xB6, 5},
+    {19, 5, 7, 0x00, 25, 0x0B, 0xB5, 8},
+    {19, 5, 7, 0x03, 25, 0x0B, 0xB4, 6},
+};
+
+#define RECORDED_FRAMES (sizeof(recorded) / sizeof(recorded[0]))
+
+static uint8_t rxStorage[128];
+static ringbuf_t rx;
+static oi_stream_t stream;
+
+// Bumps byte of every frame decoded by the last drain(), in order
+static uint8_t decoded[32];
+static int decodedCount;
+
+static void start(void)
+{
+    oi_stream_init(&stream);
+    ringbuf_init(&rx, rxStorage, sizeof(rxStorage));
+    decodedCount = 0;
+}
+
+/// The UART4 interrupt's side: queue received bytes
+static void receive(const uint8_t *bytes, int length)
+{
+    while (length--) {
+        CHECK(ringbuf_put(&rx, *bytes++));
+    }
+}
+
+/// oi_streamUpdate()'s side: run everything queued through the framer
+static void drain(void)
+{
+    uint8_t byte;
+
+    while (ringbuf_get(&rx, &byte)) {
+        if (oi_stream_feed(&stream, byte)) {
+            CHECK(stream.length == 5);
+            CHECK(stream.payload[0] == 7 && stream.payload[2] == 25);
+            decoded[decodedCount++] = stream.payload[1];
+        }
+    }
+}
+
+static void receiveFrames(int first, int last)
+{
+    int i;
+
+    for (i = first; i <= last; i++) {
+        receive(recorded[i], FRAME_BYTES);
+    }
+}
+
+static void checkClean(void)
+{
+    int i;
+
+    start();
+    receiveFrames(0, RECORDED_FRAMES - 1);
+    drain();
+
+    CHECK(decodedCount == (int)RECORDED_FRAMES);
+    for (i = 0; i < decodedCount; i++) {
+        CHECK(decoded[i] == recorded[i][3]);
+    }
+    CHECK(stream.frames == RECORDED_FRAMES);
+    CHECK(stream.badChecksum == 0 && stream.badLength == 0);
+}
+
+static void checkBadChecksum(void)
+{
+    uint8_t corrupted[FRAME_BYTES];
+
+    memcpy(corrupted, recorded[1], FRAME_BYTES);
+    corrupted[6] ^= 0x40; // A flipped bit in the charge
+
+    start();
+    receiveFrames(0, 0);
+    receive(corrupted, FRAME_BYTES);
+    receiveFrames(2, 3);
+    drain();
+
+    // Dropped on its own; the frame right after it is whole
+    CHECK(decodedCount == 3);
+    CHECK(decoded[0] == 0x00 && decoded[1] == 0x13 && decoded[2] == 0x02);
+    CHECK(stream.badChecksum == 1);
+}
+
+static void checkTruncated(void)
+{
+    start();
+    receiveFrames(0, 0);
+    receive(recorded[1], FRAME_BYTES - 3); // Cut off after the 25
+    receiveFrames(3, 5);
+    drain();
+
+    // The short frame takes the next one's header as data and fails its
+    // checksum there, so that frame goes too; the one after is found again
+    CHECK(decodedCount == 3);
+    CHECK(decoded[0] == 0x00 && decoded[1] == 0x00 && decoded[2] == 0x03);
+    CHECK(stream.badChecksum == 1);
+    CHECK(stream.state == OI_STREAM_WAIT_HEADER);
+}
+
+static void checkResync(void)
+{
+    int i;
+
+    // Join the stream just after a header, in front of a data byte of 19
+    start();
+    receive(&recorded[2][2], FRAME_BYTES - 2);
+    receiveFrames(3, 5);
+    receiveFrames(0, 5);
+    drain();
+
+    // The 19 and the 25 after it look like a header and a length, which
+    // swallows frames until that checksum fails; from then on nothing is lost
+    CHECK(stream.badChecksum + stream.badLength >= 1);
+    CHECK(decodedCount >= (int)RECORDED_FRAMES);
+    for (i = 0; i < (int)RECORDED_FRAMES; i++) {
+        CHECK(decoded[decodedCount - RECORDED_FRAMES + i] == recorded[i][3]);
+    }
+
+    // A length byte that cannot be one is refused at once
+    start();
+    receive((const uint8_t[]){19, 0, 19, 200}, 4);
+    receiveFrames(4, 4);
+    drain();
+    CHECK(stream.badLength == 2);
+    CHECK(decodedCount == 1 && decoded[0] == 0x00);
+}
+
+int main(void)
+{
+    checkClean();
+    checkBadChecksum();
+    checkTruncated();
+    checkResync();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
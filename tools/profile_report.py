@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Render the PROF lines printed by profile_dump() (lab_10/profile.c).
+
+Reads a PuTTY log or a serial port capture and prints one row per zone,
+sorted by total time spent in the zone.
+
+    python3 profile_report.py putty.log
+    python3 profile_report.py --sort max putty.log
+"""
+
+import argparse
+import sys
+
+BUCKETS = 16
+
+
+def parse(lines):
+    zones = {}
+    for line in lines:
+        fields = line.split()
+        if len(fields) != 8 + BUCKETS or fields[0] != "PROF":
+            continue
+        try:
+            count, low, high, mean, total, per_us = (int(f) for f in fields[2:8])
+            hist = [int(f) for f in fields[8:]]
+        except ValueError:
+            continue
+        # A later dump replaces an earlier one
+        zones[fields[1]] = {
+            "count": count,
+            "min": low / per_us,
+            "max": high / per_us,
+            "mean": mean / per_us,
+            "total": total / per_us,
+            "hist": hist,
+        }
+    return zones
+
+
+def sparkline(hist):
+    bars = " .:-=+*#%@"
+    peak = max(hist) or 1
+    used = [i for i, n in enumerate(hist) if n]
+    if not used:
+        return ""
+    lo, hi = used[0], used[-1]
+    return "4^%d %s 4^%d" % (
+        lo, "".join(bars[(n * (len(bars) - 1) + peak - 1) // peak] for n in hist[lo:hi + 1]),
+        hi + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r", errors="replace"),
+                        default=sys.stdin)
+    parser.add_argument("--sort", choices=["total", "mean", "max", "count"], default="total")
+    args = parser.parse_args()
+
+    zones = parse(args.log)
+    if not zones:
+        sys.exit("no PROF lines found")
+
+    grand = sum(z["total"] for z in zones.values()) or 1
+    print("%-18s %8s %10s %10s %10s %12s %6s  %s" % (
+        "zone", "count", "min us", "mean us", "max us", "total us", "share", "cycles"))
+    for name, z in sorted(zones.items(), key=lambda kv: kv[1][args.sort], reverse=True):
+        print("%-18s %8d %10.1f %10.1f %10.1f %12.0f %5.1f%%  %s" % (
+            name, z["count"], z["min"], z["mean"], z["max"], z["total"],
+            100.0 * z["total"] / grand, sparkline(z["hist"])))
+
+
+if __name__ == "__main__":
+    main()
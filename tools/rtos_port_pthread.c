@@ -0,0 +1,191 @@
+/*
+ * rtos_port_pthread.c
+ *
+ * pthread port of the kernel, see rtos_port_pthread.h. A thread that is not
+ * rtos_current waits on rtos_port_turn; rtos_port_pendSvHandler() hands the
+ * CPU lock to rtos_next and waits until the kernel picks the caller again.
+ *
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "rtos_port_pthread.h"
+
+// Words a thread's initial context takes on its kernel stack, the real port's
+// exception frame and saved registers
+#define RTOS_PORT_FRAME_WORDS 17
+
+typedef struct {
+    void (*entry)(void *);
+    void *arg;
+    void (*exit)(void);
+    const uint32_t *sp;
+    uint32_t generation;
+} rtos_port_context_t;
+
+static pthread_mutex_t rtos_port_cpu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rtos_port_turn = PTHREAD_COND_INITIALIZER;
+
+static uint8_t rtos_port_started = 0;
+static uint32_t rtos_port_generation = 0; // one per run, see rtos_port_stop()
+static uint32_t rtos_port_locked = 0;
+static uint8_t rtos_port_pending = 0;     // PendSV
+static uint8_t rtos_port_inInterrupt = 0;
+static uint32_t rtos_port_switchCount = 0;
+
+// Run the calling thread belongs to
+static __thread uint32_t rtos_port_myGeneration;
+
+/// Wait, holding the CPU lock, until the thread whose stack pointer is sp is
+/// rtos_current; threads of an earlier run end here
+static void rtos_port_waitTurn(const uint32_t *sp)
+{
+    while (1) {
+        if (rtos_port_myGeneration != rtos_port_generation) {
+            pthread_mutex_unlock(&rtos_port_cpu);
+            pthread_exit(0);
+        }
+        if (rtos_port_started && rtos_current->sp == sp) {
+            return;
+        }
+        pthread_cond_wait(&rtos_port_turn, &rtos_port_cpu);
+    }
+}
+
+static void *rtos_port_main(void *arg)
+{
+    rtos_port_context_t context = *(rtos_port_context_t *)arg;
+
+    free(arg);
+    pthread_mutex_lock(&rtos_port_cpu);
+    rtos_port_myGeneration = context.generation;
+    rtos_port_waitTurn(context.sp);
+
+    // Switched to with interrupts on, as from PendSV
+    context.entry(context.arg);
+    context.exit();
+    return 0;
+}
+
+uint32_t *rtos_port_initStack(uint32_t *stackTop, void (*entry)(void *), void *arg,
+                              void (*exit)(void))
+{
+    rtos_port_context_t *context = malloc(sizeof(*context));
+    uint32_t *sp = stackTop - RTOS_PORT_FRAME_WORDS;
+    pthread_attr_t attr;
+    pthread_t thread;
+    uint16_t i;
+
+    // Nothing runs from here, it only shows up in rtos_stackUnused()
+    for (i = 0; i < RTOS_PORT_FRAME_WORDS; i++) {
+        sp[i] = 0;
+    }
+
+    context->entry = entry;
+    context->arg = arg;
+    context->exit = exit;
+    context->sp = sp;
+    context->generation = rtos_port_generation;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attr, rtos_port_main, context);
+    pthread_attr_destroy(&attr);
+
+    return sp;
+}
+
+uint32_t rtos_port_lock(void)
+{
+    uint32_t wasLocked = rtos_port_locked;
+
+    rtos_port_locked = 1;
+    return wasLocked;
+}
+
+void rtos_port_unlock(uint32_t wasLocked)
+{
+    if (!wasLocked) {
+        rtos_port_locked = 0;
+        if (rtos_port_pending && !rtos_port_inInterrupt) {
+            rtos_port_pendSvHandler();
+        }
+    }
+}
+
+void rtos_port_switch(void)
+{
+    rtos_port_pending = 1;
+}
+
+void rtos_port_start(void)
+{
+    uint32_t generation;
+
+    // Called locked by rtos_start(), the first thread starts unlocked
+    pthread_mutex_lock(&rtos_port_cpu);
+    generation = rtos_port_generation;
+    rtos_current = rtos_next;
+    rtos_port_locked = 0;
+    rtos_port_pending = 0;
+    rtos_port_started = 1;
+    pthread_cond_broadcast(&rtos_port_turn);
+
+    while (rtos_port_generation == generation) {
+        pthread_cond_wait(&rtos_port_turn, &rtos_port_cpu);
+    }
+    pthread_mutex_unlock(&rtos_port_cpu);
+}
+
+void rtos_port_sysTickHandler(void)
+{
+    rtos_tick();
+}
+
+void rtos_port_pendSvHandler(void)
+{
+    rtos_thread_t *previous = rtos_current;
+
+    rtos_port_pending = 0;
+    rtos_current = rtos_next;
+    if (rtos_current == previous) {
+        return;
+    }
+
+    rtos_port_switchCount++;
+    pthread_cond_broadcast(&rtos_port_turn);
+    rtos_port_waitTurn(previous->sp);
+}
+
+void rtos_port_run(uint32_t ticks)
+{
+    while (ticks--) {
+        rtos_port_interrupt(rtos_port_sysTickHandler);
+    }
+}
+
+void rtos_port_interrupt(void (*isr)(void))
+{
+    rtos_port_inInterrupt++;
+    isr();
+    rtos_port_inInterrupt--;
+
+    // PendSV has the lowest priority, it runs once the last handler returns
+    if (rtos_port_pending && !rtos_port_inInterrupt && !rtos_port_locked) {
+        rtos_port_pendSvHandler();
+    }
+}
+
+void rtos_port_stop(void)
+{
+    rtos_port_started = 0;
+    rtos_port_generation++;
+    pthread_cond_broadcast(&rtos_port_turn);
+    pthread_mutex_unlock(&rtos_port_cpu);
+    pthread_exit(0);
+}
+
+uint32_t rtos_port_switches(void)
+{
+    return rtos_port_switchCount;
+}
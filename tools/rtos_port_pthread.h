@@ -0,0 +1,37 @@
+/*
+ * rtos_port_pthread.h
+ *
+ * Host port of the kernel in lab_10/rtos.c: every kernel thread is a pthread,
+ * and one lock stands in for the CPU, so exactly one of them runs at a time,
+ * the one in rtos_current. Time only passes when the running thread says so:
+ * rtos_port_run() raises a SysTick per tick, as an interrupt of that thread,
+ * and a switch the kernel asks for happens when the interrupt returns. That
+ * keeps every run of a test the same, down to the tick.
+ *
+ * The idle thread has to let time pass too, so a test sets an idle hook that
+ * calls rtos_port_run(1) and ends with rtos_port_stop(); rtos_start() then
+ * returns, and rtos_init() can set up the next run.
+ *
+ */
+
+#ifndef RTOS_PORT_PTHREAD_H_
+#define RTOS_PORT_PTHREAD_H_
+
+#include <stdint.h>
+#include "rtos_port.h"
+
+/// Run the calling thread for ticks SysTicks; it may be switched away at any
+/// of them and the rest of the ticks run once it is back
+void rtos_port_run(uint32_t ticks);
+
+/// Run isr as an interrupt of the calling thread, interrupts have to be on
+void rtos_port_interrupt(void (*isr)(void));
+
+/// End the run from any kernel thread: rtos_start() returns and every thread
+/// of the run is dropped
+void rtos_port_stop(void);
+
+/// Context switches since the program started
+uint32_t rtos_port_switches(void);
+
+#endif /* RTOS_PORT_PTHREAD_H_ */
@@ -0,0 +1,410 @@
+/*
+ * rtos_test.c
+ *
+ * Host check of the kernel in lab_10/rtos.c on the pthread port. Each run
+ * starts a few threads that note what they do in a trace, one letter per
+ * step, and the trace and the tick of every step are checked afterwards:
+ * preemption by a higher priority thread, round-robin on the tick, sleep
+ * wakeups, mutex priority inheritance and its restore, queue timeouts and the
+ * handoff from a blocked sender or to a blocked receiver.
+ *
+ *     gcc -O2 -Wall -pthread -I../lab_10 -o rtos_test rtos_test.c \
+ *         rtos_port_pthread.c ../lab_10/rtos.c
+ *     ./rtos_test
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rtos.h"
+#include "rtos_port_pthread.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define STACK_WORDS 128
+
+// Ticks after which a run is taken to be stuck
+#define RUN_LIMIT 1000
+
+static uint32_t stacks[4][STACK_WORDS];
+static rtos_thread_t threads[4];
+static uint8_t created;
+
+// One letter per step, and the tick it happened at
+static char trace[64];
+static uint32_t traceTicks[64];
+static uint8_t traceLength;
+
+static void mark(char step)
+{
+    if (traceLength < sizeof(trace) - 1) {
+        traceTicks[traceLength] = rtos_ticks();
+        trace[traceLength++] = step;
+    }
+}
+
+/// Tick of the first step with that letter
+static uint32_t tickOf(char step)
+{
+    const char *at = strchr(trace, step);
+
+    return at ? traceTicks[at - trace] : 0xFFFFFFFFUL;
+}
+
+/// Time passes while nothing else runs; a run that goes quiet ends here
+static void idle(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < created; i++) {
+        if (threads[i].state != RTOS_FINISHED) {
+            break;
+        }
+    }
+    if (i == created) {
+        rtos_port_stop();
+    }
+
+    if (rtos_ticks() > RUN_LIMIT) {
+        printf("FAIL stuck after %u ticks, trace %s\n", (unsigned)rtos_ticks(), trace);
+        failures++;
+        rtos_port_stop();
+    }
+    rtos_port_run(1);
+}
+
+static void begin(void)
+{
+    rtos_init();
+    rtos_setIdleHook(idle);
+    memset(trace, 0, sizeof(trace));
+    traceLength = 0;
+    created = 0;
+}
+
+static rtos_thread_t *spawn(void (*entry)(void *), void *arg, uint8_t priority)
+{
+    rtos_thread_t *thread = &threads[created];
+
+    CHECK(rtos_threadCreate(thread, entry, arg, stacks[created], STACK_WORDS, priority));
+    created++;
+    return thread;
+}
+
+// Preemption
+
+static rtos_queue_t queue;
+static uint32_t queueItems[4];
+
+static void high_thread(void *arg)
+{
+    uint32_t message = 0;
+
+    mark('H');
+    rtos_sleep(5);
+    mark('W'); // woken in the middle of the low thread's work
+    CHECK(rtos_queueReceive(&queue, &message, RTOS_FOREVER) == RTOS_OK);
+    mark('Q');
+    CHECK(message == 42);
+}
+
+static void sendFromIsr(void)
+{
+    CHECK(rtos_queueSend(&queue, 42, 0) == RTOS_OK);
+}
+
+static void low_thread(void *arg)
+{
+    mark('L');
+    spawn(high_thread, 0, 3); // runs before this returns
+    mark('l');
+    rtos_port_run(10);
+    mark('i');
+    rtos_port_interrupt(sendFromIsr); // wakes the high thread on return
+    mark('e');
+}
+
+static void checkPreemption(void)
+{
+    begin();
+    rtos_queueInit(&queue, queueItems, 4);
+    spawn(low_thread, 0, 1);
+    rtos_start();
+
+    CHECK(strcmp(trace, "LHlWiQe") == 0);
+    CHECK(tickOf('W') == 5);
+    CHECK(tickOf('i') == 10);
+    CHECK(tickOf('e') == 10);
+}
+
+// Round-robin
+
+static void turns_thread(void *arg)
+{
+    uint8_t i;
+
+    for (i = 0; i < 3; i++) {
+        mark(*(const char *)arg);
+        rtos_port_run(1);
+    }
+}
+
+static void yield_thread(void *arg)
+{
+    mark('Y');
+    rtos_yield();
+    mark('y');
+}
+
+static void background_thread(void *arg)
+{
+    mark('z');
+}
+
+static void checkRoundRobin(void)
+{
+    uint32_t switches;
+
+    begin();
+    spawn(turns_thread, "a", 2);
+    spawn(turns_thread, "b", 2);
+    spawn(background_thread, 0, 1);
+    switches = rtos_port_switches();
+    rtos_start();
+
+    // Every tick hands the CPU to the other one, the lower priority thread
+    // gets it once both are done
+    CHECK(strcmp(trace, "abababz") == 0);
+    CHECK(tickOf('z') == 6);
+    CHECK(rtos_port_switches() - switches >= 6);
+
+    // A yield hands it over without waiting for the tick
+    begin();
+    spawn(yield_thread, 0, 2);
+    spawn(turns_thread, "c", 2);
+    rtos_start();
+    CHECK(strcmp(trace, "Ycycc") == 0);
+    CHECK(tickOf('c') == 0 && tickOf('y') == 1);
+}
+
+// Sleeping
+
+static void sleep_thread(void *arg)
+{
+    uint32_t ticks = (uintptr_t)arg;
+
+    rtos_sleep(ticks);
+    mark('0' + ticks);
+    rtos_sleep(ticks);
+    mark('0' + ticks);
+}
+
+static void checkSleep(void)
+{
+    begin();
+    spawn(sleep_thread, (void *)7, 2);
+    spawn(sleep_thread, (void *)3, 2);
+    spawn(sleep_thread, (void *)5, 2);
+    rtos_start();
+
+    // Wake at 3, 5, 6, 7, 10, 14
+    CHECK(strcmp(trace, "353757") == 0);
+    CHECK(traceTicks[0] == 3 && traceTicks[1] == 5 && traceTicks[2] == 6);
+    CHECK(traceTicks[3] == 7 && traceTicks[4] == 10 && traceTicks[5] == 14);
+}
+
+// Mutex priority inheritance
+
+static rtos_mutex_t mutex;
+static uint8_t priorityHolding;
+static uint8_t priorityAfter;
+
+static void owner_thread(void *arg)
+{
+    CHECK(rtos_mutexLock(&mutex, RTOS_FOREVER) == RTOS_OK);
+    mark('o');
+    rtos_port_run(6); // the high thread blocks at 2, the middle wakes at 3
+    priorityHolding = rtos_self()->priority;
+    mark('u');
+    CHECK(rtos_mutexUnlock(&mutex) == RTOS_OK); // the high thread runs here
+    priorityAfter = rtos_self()->priority;
+    mark('r');
+}
+
+static void middle_thread(void *arg)
+{
+    rtos_sleep(3);
+    mark('m');
+    rtos_port_run(2);
+    mark('M');
+}
+
+static void waiter_thread(void *arg)
+{
+    rtos_sleep(2);
+    mark('w');
+    CHECK(rtos_mutexLock(&mutex, RTOS_FOREVER) == RTOS_OK);
+    mark('g');
+    CHECK(mutex.owner == rtos_self());
+    CHECK(rtos_mutexUnlock(&mutex) == RTOS_OK);
+}
+
+static void timeout_thread(void *arg)
+{
+    rtos_sleep(1);
+    CHECK(rtos_mutexUnlock(&mutex) == RTOS_ERROR); // not the owner
+    CHECK(rtos_mutexLock(&mutex, 0) == RTOS_TIMEOUT);
+    CHECK(rtos_mutexLock(&mutex, 4) == RTOS_TIMEOUT);
+    mark('t');
+}
+
+static void checkMutex(void)
+{
+    begin();
+    rtos_mutexInit(&mutex);
+    CHECK(rtos_mutexLock(&mutex, 0) == RTOS_ERROR); // not started yet
+    spawn(owner_thread, 0, 1);
+    spawn(middle_thread, 0, 2);
+    spawn(waiter_thread, 0, 3);
+    rtos_start();
+
+    // The owner keeps the CPU at the waiter's priority when the middle thread
+    // wakes, and drops back to its own on the unlock
+    CHECK(strcmp(trace, "owugmMr") == 0);
+    CHECK(priorityHolding == 3);
+    CHECK(priorityAfter == 1);
+    CHECK(tickOf('u') == 6 && tickOf('g') == 6);
+    CHECK(tickOf('M') == 8);
+    CHECK(mutex.owner == 0);
+
+    // A lock that times out leaves the owner with it
+    begin();
+    rtos_mutexInit(&mutex);
+    spawn(owner_thread, 0, 1);
+    spawn(timeout_thread, 0, 2);
+    rtos_start();
+    CHECK(strcmp(trace, "otur") == 0);
+    CHECK(tickOf('t') == 5);
+    CHECK(priorityAfter == 1);
+}
+
+// Queues
+
+static void timeouts_thread(void *arg)
+{
+    uint32_t message = 0;
+
+    CHECK(rtos_queueReceive(&queue, &message, 0) == RTOS_TIMEOUT);
+    CHECK(rtos_queueReceive(&queue, &message, 5) == RTOS_TIMEOUT);
+    mark('r');
+
+    CHECK(rtos_queueSend(&queue, 1, 0) == RTOS_OK);
+    CHECK(rtos_queueSend(&queue, 2, 0) == RTOS_OK);
+    CHECK(rtos_queueSend(&queue, 3, 0) == RTOS_TIMEOUT);
+    CHECK(rtos_queueSend(&queue, 3, 3) == RTOS_TIMEOUT);
+    mark('s');
+
+    CHECK(rtos_queueReceive(&queue, &message, 0) == RTOS_OK && message == 1);
+    CHECK(rtos_queueReceive(&queue, &message, 5) == RTOS_OK && message == 2);
+    mark('e');
+}
+
+static void sender_thread(void *arg)
+{
+    mark('1');
+    CHECK(rtos_queueSend(&queue, 1, RTOS_FOREVER) == RTOS_OK);
+    mark('2');
+    CHECK(rtos_queueSend(&queue, 2, RTOS_FOREVER) == RTOS_OK); // full, blocks
+    mark('3');
+    CHECK(rtos_queueSend(&queue, 3, 10) == RTOS_OK);
+    mark('4');
+}
+
+static void receiver_thread(void *arg)
+{
+    uint32_t message = 0;
+    uint8_t i;
+
+    for (i = 1; i <= 3; i++) {
+        CHECK(rtos_queueReceive(&queue, &message, RTOS_FOREVER) == RTOS_OK);
+        CHECK(message == i);
+        mark('a' + i - 1);
+        rtos_port_run(2);
+    }
+}
+
+static void waiting_receiver_thread(void *arg)
+{
+    uint32_t message = 0;
+
+    mark('R');
+    CHECK(rtos_queueReceive(&queue, &message, RTOS_FOREVER) == RTOS_OK);
+    mark('G');
+    CHECK(message == 7);
+}
+
+static void late_sender_thread(void *arg)
+{
+    rtos_sleep(4);
+    mark('S');
+    CHECK(rtos_queueSend(&queue, 7, 0) == RTOS_OK);
+    mark('s');
+}
+
+static void checkQueues(void)
+{
+    begin();
+    rtos_queueInit(&queue, queueItems, 2);
+    CHECK(rtos_queueSend(&queue, 9, 5) == RTOS_OK); // before the start
+    CHECK(rtos_queueReceive(&queue, &queueItems[3], 0) == RTOS_OK);
+    spawn(timeouts_thread, 0, 2);
+    rtos_start();
+    CHECK(strcmp(trace, "rse") == 0);
+    CHECK(tickOf('r') == 5);
+    CHECK(tickOf('s') == 8 && tickOf('e') == 8);
+
+    // The sender blocks on the full queue; the first receive takes its
+    // message in and it runs again at once, ahead of the receiver
+    begin();
+    rtos_queueInit(&queue, queueItems, 1);
+    spawn(sender_thread, 0, 2);
+    spawn(receiver_thread, 0, 1);
+    rtos_start();
+    CHECK(strcmp(trace, "123a4bc") == 0);
+    CHECK(tickOf('3') == 0 && tickOf('4') == 2);
+    CHECK(tickOf('c') == 4);
+    CHECK(queue.count == 0);
+
+    // A blocked receiver gets the message directly, the queue stays empty
+    begin();
+    rtos_queueInit(&queue, queueItems, 1);
+    spawn(waiting_receiver_thread, 0, 2);
+    spawn(late_sender_thread, 0, 1);
+    rtos_start();
+    CHECK(strcmp(trace, "RSGs") == 0);
+    CHECK(tickOf('G') == 4);
+    CHECK(queue.count == 0);
+}
+
+int main(void)
+{
+    checkPreemption();
+    checkRoundRobin();
+    checkSleep();
+    checkMutex();
+    checkQueues();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * sched_test.c
+ *
+ * Host check of the cooperative scheduler in lab_10/sched.c. The port below
+ * stands in for sched_port.c: interrupt masking is a flag, and the 1 ms tick
+ * is whatever sched_start() hands over, called by hand. Covers the priority
+ * order between tasks, FIFO order within one, postAfter()/postEvery() timing,
+ * drops on a full queue and the idle hook's second look with interrupts
+ * masked.
+ *
+ *     gcc -O2 -Wall -I../lab_10 -o sched_test sched_test.c ../lab_10/sched.c
+ *     ./sched_test
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sched_port.h"
+#include "sched.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+// Host port
+
+static uint32_t locked = 0;
+static void (*tick)(void) = 0;
+
+// An interrupt that fires just before the next sched_port_lock() masks
+static void (*interruptBeforeLock)(void) = 0;
+
+uint32_t sched_port_lock(void)
+{
+    uint32_t wasLocked = locked;
+
+    if (interruptBeforeLock && !wasLocked) {
+        void (*isr)(void) = interruptBeforeLock;
+
+        interruptBeforeLock = 0;
+        isr();
+    }
+    locked = 1;
+    return wasLocked;
+}
+
+void sched_port_unlock(uint32_t wasLocked)
+{
+    if (!wasLocked) {
+        locked = 0;
+    }
+}
+
+void sched_port_startTick(void (*f)(void))
+{
+    tick = f;
+}
+
+// Tasks: a letter and the signal for every event handled, in order
+
+static int low;
+static int mid;
+static int high;
+
+static char trace[128];
+static int32_t values[64];
+static int handled;
+
+static void note(char task, sched_event_t event)
+{
+    size_t length = strlen(trace);
+
+    if (length + 2 < sizeof(trace)) {
+        trace[length] = task;
+        trace[length + 1] = '0' + event.signal;
+        trace[length + 2] = 0;
+    }
+    if (handled < 64) {
+        values[handled] = event.value;
+    }
+    handled++;
+    CHECK(!locked);
+}
+
+#define SIGNAL_POST_HIGH 9
+
+static void low_task(sched_event_t event)
+{
+    note('L', event);
+    if (event.signal == SIGNAL_POST_HIGH) {
+        sched_post(high, 1, 0);
+    }
+}
+
+static void mid_task(sched_event_t event)
+{
+    note('M', event);
+}
+
+static void high_task(sched_event_t event)
+{
+    note('H', event);
+}
+
+/// Dispatch until nothing is left, returns the trace of it
+static const char *drain(void)
+{
+    int limit = 100;
+
+    trace[0] = 0;
+    handled = 0;
+    while (sched_runOnce() && --limit);
+    CHECK(limit);
+    return trace;
+}
+
+/// Advance ticks ticks, dispatching after each; returns the trace
+static const char *runTicks(int ticks)
+{
+    static char all[128];
+
+    all[0] = 0;
+    while (ticks--) {
+        tick();
+        strncat(all, drain(), sizeof(all) - strlen(all) - 1);
+    }
+    return all;
+}
+
+static void checkOrder(void)
+{
+    sched_post(low, 1, 0);
+    sched_post(low, 2, 0);
+    sched_post(high, 1, 0);
+    sched_post(mid, 1, 0);
+    sched_post(high, 2, 0);
+    CHECK(strcmp(drain(), "H1H2M1L1L2") == 0);
+
+    // A higher priority event posted by a handler goes ahead of what the
+    // lower task still has queued
+    sched_post(low, SIGNAL_POST_HIGH, 0);
+    sched_post(low, 3, 0);
+    sched_post(mid, 3, 0);
+    CHECK(strcmp(drain(), "M3L9H1L3") == 0);
+}
+
+static void checkDrops(void)
+{
+    int32_t i;
+
+    for (i = 0; i < SCHED_QUEUE_SIZE; i++) {
+        CHECK(sched_post(low, 1, i));
+    }
+    CHECK(!sched_post(low, 2, 100));
+    CHECK(!sched_post(low, 2, 101));
+    CHECK(sched_dropped() == 2);
+
+    // The other tasks still take events
+    CHECK(sched_post(mid, 1, 200));
+
+    // Oldest first, the drops are gone
+    drain();
+    CHECK(handled == SCHED_QUEUE_SIZE + 1);
+    CHECK(values[0] == 200);
+    for (i = 0; i < SCHED_QUEUE_SIZE; i++) {
+        CHECK(values[i + 1] == i);
+    }
+    CHECK(strchr(trace, '2') == 0);
+
+    // Room again once drained, unknown tasks are refused without a drop
+    CHECK(sched_post(low, 1, 0));
+    CHECK(!sched_post(SCHED_MAX_TASKS, 1, 0));
+    CHECK(!sched_post(SCHED_INVALID, 1, 0));
+    CHECK(sched_dropped() == 2);
+    drain();
+}
+
+static void checkTimers(void)
+{
+    int every;
+    int once;
+    int ids[SCHED_MAX_TIMERS];
+    int i;
+
+    sched_start();
+    CHECK(tick != 0);
+
+    // A single post after 3 ticks, and one every 4
+    once = sched_postAfter(mid, 1, 0, 3);
+    every = sched_postEvery(low, 2, 0, 4);
+    CHECK(once != SCHED_INVALID && every != SCHED_INVALID && once != every);
+    CHECK(strcmp(runTicks(2), "") == 0);
+    CHECK(strcmp(runTicks(1), "M1") == 0);
+    CHECK(strcmp(runTicks(1), "L2") == 0);
+    CHECK(strcmp(runTicks(7), "L2") == 0);
+    CHECK(strcmp(runTicks(1), "L2") == 0);
+
+    // Two due on the same tick are dispatched by priority
+    once = sched_postAfter(high, 3, 0, 4);
+    CHECK(strcmp(runTicks(4), "H3L2") == 0);
+
+    // 0 ticks means the next one; a cancelled timer stays quiet
+    once = sched_postAfter(mid, 4, 0, 0);
+    CHECK(strcmp(runTicks(1), "M4") == 0);
+    sched_cancel(every);
+    CHECK(strcmp(runTicks(12), "") == 0);
+
+    // The single post's entry was freed when it fired, so all of them are
+    // free again
+    for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+        ids[i] = sched_postEvery(low, 5, i, 1);
+        CHECK(ids[i] != SCHED_INVALID);
+    }
+    CHECK(sched_postAfter(low, 5, 0, 1) == SCHED_INVALID);
+    CHECK(strcmp(runTicks(1), "L5L5L5L5L5L5L5L5") == 0);
+    for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+        sched_cancel(ids[i]);
+    }
+    CHECK(strcmp(runTicks(1), "") == 0);
+    CHECK(!locked);
+}
+
+static int idleCalls;
+static int idleLocked;
+
+static void idle(void)
+{
+    idleCalls++;
+    idleLocked += locked != 0;
+}
+
+static void postFromIsr(void)
+{
+    sched_post(low, 6, 0);
+}
+
+static void checkIdle(void)
+{
+    sched_setIdleHook(idle);
+
+    // Nothing to do: the hook runs, with interrupts masked
+    CHECK(sched_runOnce() == 0);
+    CHECK(idleCalls == 1 && idleLocked == 1);
+    CHECK(!locked);
+
+    // Something to do: no hook
+    sched_post(mid, 5, 0);
+    CHECK(sched_runOnce() == 1);
+    CHECK(idleCalls == 1);
+
+    // An event posted between the first look and the masking is seen by the
+    // second look, so the hook does not sleep on it
+    interruptBeforeLock = postFromIsr;
+    CHECK(sched_runOnce() == 0);
+    CHECK(interruptBeforeLock == 0);
+    CHECK(idleCalls == 1);
+    CHECK(strcmp(drain(), "L6") == 0);
+    CHECK(idleCalls == 2 && idleLocked == 2);
+
+    // Masked by the caller already: still masked after
+    locked = 1;
+    CHECK(sched_runOnce() == 0);
+    CHECK(locked == 1);
+    locked = 0;
+    sched_setIdleHook(0);
+}
+
+static void checkTaskLimit(void)
+{
+    int i;
+
+    for (i = 3; i < SCHED_MAX_TASKS; i++) {
+        CHECK(sched_addTask(mid_task, 0) == i);
+    }
+    CHECK(sched_addTask(mid_task, 0) == SCHED_INVALID);
+}
+
+int main(void)
+{
+    low = sched_addTask(low_task, 1);
+    high = sched_addTask(high_task, 3);
+    mid = sched_addTask(mid_task, 2);
+    CHECK(low == 0 && high == 1 && mid == 2);
+
+    checkOrder();
+    checkDrops();
+    checkTimers();
+    checkIdle();
+    checkTaskLimit();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+// Decode the binary telemetry sent by lab_10/telemetry.c.
+//
+// Reads a capture of UART1 (a PuTTY session log saved as "all session output",
+// or a serial port) and prints one line per record, as CSV or as JSON Lines.
+// Text the robot printed in between, like profile_dump(), goes to stderr
+// unchanged, followed by a summary of bad frames and lost records.
+//
+//     g++ -std=c++17 -O2 -o telemetry_decode telemetry_decode.cpp
+//     ./telemetry_decode capture.bin > run.csv
+//     ./telemetry_decode --json capture.bin
+//     ./telemetry_decode --only scan capture.bin > scan.csv
+//     stty -F /dev/ttyUSB0 115200 raw && ./telemetry_decode /dev/ttyUSB0
+//
+// See lab_10/telemetry.h for the frame layout.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum RecordType : uint8_t {
+    TELEM_SCAN = 1,
+    TELEM_OBJECT = 2,
+    TELEM_POSE = 3,
+    TELEM_SENSORS = 4,
+};
+
+// One decoded value, kept as text so CSV and JSON share the formatting
+struct Field {
+    const char *name;
+    std::string value;
+};
+
+struct Record {
+    const char *name;
+    uint8_t sequence;
+    std::vector<Field> fields;
+};
+
+struct Stats {
+    unsigned long frames = 0;
+    unsigned long badFrames = 0;
+    unsigned long lost = 0;
+    unsigned long textChunks = 0;
+};
+
+// Little endian reader over a payload; a short payload is a bad frame
+class Reader {
+public:
+    Reader(const uint8_t *data, size_t length) : data_(data), length_(length) {}
+
+    bool done() const { return offset_ == length_ && ok_; }
+
+    uint32_t u(size_t bytes)
+    {
+        uint32_t value = 0;
+
+        if (offset_ + bytes > length_) {
+            ok_ = false;
+            return 0;
+        }
+        for (size_t i = 0; i < bytes; i++) {
+            value |= static_cast<uint32_t>(data_[offset_ + i]) << (8 * i);
+        }
+        offset_ += bytes;
+        return value;
+    }
+
+    std::string u8() { return std::to_string(u(1)); }
+    std::string u16() { return std::to_string(u(2)); }
+    std::string i16() { return std::to_string(static_cast<int16_t>(u(2))); }
+    std::string i32() { return std::to_string(static_cast<int32_t>(u(4))); }
+
+private:
+    const uint8_t *data_;
+    size_t length_;
+    size_t offset_ = 0;
+    bool ok_ = true;
+};
+
+uint16_t crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (length--) {
+        crc ^= static_cast<uint16_t>(*data++) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool cobsDecode(const std::vector<uint8_t> &in, std::vector<uint8_t> &out)
+{
+    size_t i = 0;
+
+    out.clear();
+    while (i < in.size()) {
+        uint8_t code = in[i++];
+
+        if (code == 0 || i + code - 1 > in.size()) {
+            return false;
+        }
+        out.insert(out.end(), in.begin() + i, in.begin() + i + code - 1);
+        i += code - 1;
+        // A full run of 254 bytes is not followed by a zero, neither is the end
+        if (code != 0xFF && i < in.size()) {
+            out.push_back(0);
+        }
+    }
+    return true;
+}
+
+bool parse(const std::vector<uint8_t> &frame, Record &record)
+{
+    if (frame.size() < 4) {
+        return false;
+    }
+
+    size_t payload = frame.size() - 2;
+    uint16_t crc = frame[payload] | frame[payload + 1] << 8;
+    if (crc16(frame.data(), payload) != crc) {
+        return false;
+    }
+
+    Reader r(frame.data() + 2, payload - 2);
+    record.sequence = frame[1];
+    record.fields.clear();
+
+    switch (frame[0]) {
+    case TELEM_SCAN:
+        record.name = "scan";
+        record.fields = {{"angle_deg", r.u8()}, {"distance_cm", r.i16()}, {"raw", r.u16()}};
+        break;
+    case TELEM_OBJECT:
+        record.name = "object";
+        record.fields = {{"index", r.u8()},       {"start_deg", r.u8()},
+                         {"end_deg", r.u8()},     {"middle_deg", r.u8()},
+                         {"distance_cm", r.i16()}, {"width_mm", r.u16()}};
+        break;
+    case TELEM_POSE:
+        record.name = "pose";
+        record.fields = {{"x_um", r.i32()}, {"y_um", r.i32()}, {"heading_mdeg", r.i32()}};
+        break;
+    case TELEM_SENSORS: {
+        static const char *const flagNames[16] = {
+            "wheel_drop_left", "wheel_drop_right", "bump_left", "bump_right",
+            "cliff_left", "cliff_front_left", "cliff_front_right", "cliff_right",
+            "light_left", "light_front_left", "light_center_left", "light_center_right",
+            "light_front_right", "light_right", "wall", "virtual_wall"};
+        uint32_t flags = r.u(2);
+
+        record.name = "sensors";
+        for (int bit = 0; bit < 16; bit++) {
+            record.fields.push_back({flagNames[bit], std::to_string((flags >> bit) & 1)});
+        }
+        for (const char *name : {"cliff_left_signal", "cliff_front_left_signal",
+                                 "cliff_front_right_signal", "cliff_right_signal",
+                                 "light_left_signal", "light_front_left_signal",
+                                 "light_center_left_signal", "light_center_right_signal",
+                                 "light_front_right_signal", "light_right_signal",
+                                 "wall_signal"}) {
+            record.fields.push_back({name, r.u16()});
+        }
+        record.fields.push_back({"left_encoder", r.i16()});
+        record.fields.push_back({"right_encoder", r.i16()});
+        record.fields.push_back({"battery_mv", r.u16()});
+        record.fields.push_back({"battery_ma", r.i16()});
+        record.fields.push_back({"battery_charge_mah", r.u16()});
+        record.fields.push_back({"battery_capacity_mah", r.u16()});
+        record.fields.push_back({"charging_state", r.u8()});
+        record.fields.push_back({"oi_mode", r.u8()});
+        break;
+    }
+    default:
+        return false;
+    }
+
+    return r.done();
+}
+
+bool printable(const std::vector<uint8_t> &chunk)
+{
+    for (uint8_t c : chunk) {
+        if (c < 0x20 && c != '\r' && c != '\n' && c != '\t') {
+            return false;
+        }
+        if (c >= 0x7F) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void printCsv(const Record &record, std::set<std::string> &headers)
+{
+    if (headers.insert(record.name).second) {
+        std::cout << "record,seq";
+        for (const Field &field : record.fields) {
+            std::cout << ',' << field.name;
+        }
+        std::cout << '\n';
+    }
+
+    std::cout << record.name << ',' << static_cast<unsigned>(record.sequence);
+    for (const Field &field : record.fields) {
+        std::cout << ',' << field.value;
+    }
+    std::cout << '\n';
+}
+
+void printJson(const Record &record)
+{
+    std::cout << "{\"record\":\"" << record.name << "\",\"seq\":"
+              << static_cast<unsigned>(record.sequence);
+    for (const Field &field : record.fields) {
+        std::cout << ",\"" << field.name << "\":" << field.value;
+    }
+    std::cout << "}\n";
+}
+
+int usage()
+{
+    std::cerr << "usage: telemetry_decode [--json] [--only scan|object|pose|sensors] [capture]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    std::string only;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else if (path.empty()) {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+
+    std::ifstream file;
+    if (!path.empty() && path != "-") {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "telemetry_decode: cannot open " << path << '\n';
+            return 1;
+        }
+    }
+    std::istream &in = file.is_open() ? file : std::cin;
+
+    Stats stats;
+    std::set<std::string> headers;
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> frame;
+    Record record;
+    bool haveSequence = false;
+    uint8_t nextSequence = 0;
+
+    std::ios::sync_with_stdio(false);
+
+    // Chunks end at a zero, or at the end of the capture
+    int c;
+    do {
+        c = in.get();
+        if (c != 0 && c != EOF) {
+            chunk.push_back(static_cast<uint8_t>(c));
+            continue;
+        }
+        if (chunk.empty()) {
+            continue; // Back to back delimiters between frames
+        }
+
+        if (cobsDecode(chunk, frame) && parse(frame, record)) {
+            stats.frames++;
+            if (haveSequence) {
+                stats.lost += static_cast<uint8_t>(record.sequence - nextSequence);
+            }
+            haveSequence = true;
+            nextSequence = record.sequence + 1;
+
+            if (only.empty() || only == record.name) {
+                if (json) {
+                    printJson(record);
+                } else {
+                    printCsv(record, headers);
+                }
+            }
+        } else if (printable(chunk)) {
+            stats.textChunks++;
+            std::cerr.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+        } else {
+            stats.badFrames++;
+        }
+        chunk.clear();
+    } while (c != EOF);
+
+    std::cout.flush();
+    std::cerr << "telemetry_decode: " << stats.frames << " records, " << stats.badFrames
+              << " bad frames, " << stats.lost << " lost, " << stats.textChunks
+              << " text chunks\n";
+    return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * udma_test.c
+ *
+ * Host check of the uDMA bookkeeping in lab_10/udma.c. The register block is a
+ * plain struct, and a few lines below stand in for the controller: they run a
+ * control table entry the way the datasheet describes and raise the channel's
+ * CHIS bit when it is done. Covers the scatter-gather task list, the ping-pong
+ * swap between the primary and alternate structures, and which callback gets
+ * which buffer.
+ *
+ *     gcc -O2 -Wall -I../lab_10 -o udma_test udma_test.c
+ *     ./udma_test
+ *
+ * udma.c is included rather than linked so the control table can be looked at
+ * through its pointers; CTLBASE only holds the low 32 bits of it on a 64-bit
+ * host. Exits with 1 if any check fails.
+ */
+
+#define UDMA_HOST
+#include "udma.c"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);              \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define CHANNEL UDMA_CH_UART1_TX
+
+static udma_regs_t regs;
+static volatile uint32_t dataRegister; // stands in for UART1_DR_R
+
+// What the controller wrote to the data register
+static uint8_t sent[256];
+static int sentCount;
+
+// Callbacks seen, in order
+static struct {
+    uint8_t channel;
+    void *buffer;
+    uint16_t length;
+} calls[8];
+static int callCount;
+
+static void callback(uint8_t channel, void *buffer, uint16_t length)
+{
+    if (callCount < 8) {
+        calls[callCount].channel = channel;
+        calls[callCount].buffer = buffer;
+        calls[callCount].length = length;
+    }
+    callCount++;
+}
+
+static void start(void)
+{
+    memset(&regs, 0, sizeof(regs));
+    udma_setRegisterBlock(&regs);
+    udma_init();
+    memset(udma_controlTable, 0, sizeof(udma_controlTable));
+    sentCount = 0;
+    callCount = 0;
+}
+
+/// udma_service() with CHIS acting as on the controller, where writing a 1
+/// clears that bit; checks that exactly the pending channels in mask were
+static void service(uint32_t mask)
+{
+    uint32_t pending = regs.CHIS;
+
+    udma_service(mask);
+    CHECK(regs.CHIS == (pending & mask));
+    regs.CHIS = pending & ~mask;
+}
+
+static uint16_t items(const udma_entry_t *entry)
+{
+    return ((entry->control >> 4) & 0x3FF) + 1;
+}
+
+static uint8_t mode(const udma_entry_t *entry)
+{
+    return entry->control & UDMA_CTL_MODE_M;
+}
+
+/// The controller's side of a basic transmit: the bytes go out, the entry
+/// is left in stop mode
+static void runTx(udma_entry_t *entry)
+{
+    const uint8_t *src = (const uint8_t *)entry->srcEnd - (items(entry) - 1);
+    uint16_t i;
+
+    for (i = 0; i < items(entry); i++) {
+        sent[sentCount++] = src[i];
+    }
+    entry->control &= ~(0x3FFUL << 4 | UDMA_CTL_MODE_M);
+}
+
+/// The controller's side of a scatter-gather transmit: the primary copies
+/// each task into the alternate structure, which then runs it. Tasks are
+/// counted in entries, the 4 words per task only hold on the robot.
+static void runGather(uint8_t channel)
+{
+    udma_entry_t *primary = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_entry_t *alternate = &udma_controlTable[UDMA_ALTERNATE + channel];
+    const udma_entry_t *last = (const udma_entry_t *)
+        ((const uint8_t *)primary->srcEnd - offsetof(udma_entry_t, unused));
+    const udma_entry_t *task = last - (items(primary) / 4 - 1);
+
+    do {
+        *alternate = *task++;
+        runTx(alternate);
+    } while (task <= last && mode(&task[-1]) == UDMA_MODE_ALT_PER_SG);
+
+    regs.ENASET &= ~(1UL << channel);
+    regs.CHIS |= 1UL << channel;
+}
+
+static void checkGather(void)
+{
+    static const uint8_t header[] = {'$', 'T', ','};
+    static const uint8_t body[] = "1234,5678";
+    static const uint8_t trailer[] = {'*', '4', 'F', '\r', '\n'};
+    const udma_segment_t segments[] = {
+        {header, sizeof(header)},
+        {body, sizeof(body) - 1},
+        {trailer, sizeof(trailer)},
+    };
+    udma_entry_t tasks[3];
+    udma_entry_t *primary = &udma_controlTable[UDMA_PRIMARY + CHANNEL];
+    uint8_t i;
+
+    start();
+    CHECK(udma_startGatherTx(CHANNEL, segments, 3, tasks, &dataRegister, callback));
+    CHECK(regs.ENASET == 1UL << CHANNEL);
+
+    // Every task moves its segment to the data register; all but the last
+    // continue with the next one
+    for (i = 0; i < 3; i++) {
+        CHECK(tasks[i].srcEnd == (const uint8_t *)segments[i].data + segments[i].length - 1);
+        CHECK(tasks[i].dstEnd == &dataRegister);
+        CHECK(items(&tasks[i]) == segments[i].length);
+        CHECK((tasks[i].control & ~(0x3FFUL << 4 | UDMA_CTL_MODE_M)) == UDMA_CTL_TX);
+        CHECK(mode(&tasks[i]) == (i == 2 ? UDMA_MODE_BASIC : UDMA_MODE_ALT_PER_SG));
+    }
+
+    // The primary copies the list, ending at the last words of both
+    CHECK(primary->srcEnd == &tasks[2].unused);
+    CHECK(primary->dstEnd == &udma_controlTable[UDMA_ALTERNATE + CHANNEL].unused);
+    CHECK(items(primary) == 3 * 4);
+    CHECK(mode(primary) == UDMA_MODE_PER_SG);
+
+    runGather(CHANNEL);
+    CHECK(sentCount == 17);
+    CHECK(memcmp(sent, "$T,1234,5678*4F\r\n", 17) == 0);
+
+    // One callback for the whole list, with the first segment
+    service(1UL << CHANNEL);
+    CHECK(callCount == 1);
+    CHECK(calls[0].channel == CHANNEL);
+    CHECK(calls[0].buffer == header && calls[0].length == 17);
+    CHECK(!udma_isBusy(CHANNEL));
+
+    // A second service finds nothing left to report
+    regs.CHIS = 1UL << CHANNEL;
+    service(1UL << CHANNEL);
+    CHECK(callCount == 1);
+
+    // Segments the controller cannot take are refused before anything starts
+    start();
+    CHECK(!udma_startGatherTx(CHANNEL, segments, 0, tasks, &dataRegister, callback));
+    {
+        const udma_segment_t empty[] = {{header, 3}, {body, 0}};
+        const udma_segment_t tooLong[] = {{header, UDMA_MAX_TRANSFER + 1}};
+
+        CHECK(!udma_startGatherTx(CHANNEL, empty, 2, tasks, &dataRegister, callback));
+        CHECK(!udma_startGatherTx(CHANNEL, tooLong, 1, tasks, &dataRegister, callback));
+    }
+    CHECK(regs.ENASET == 0);
+}
+
+/// The controller's side of one ping-pong half filling: the entry goes to
+/// stop mode and the controller moves on to the other structure
+static void fillHalf(uint8_t channel, uint8_t half)
+{
+    udma_entry_t *entry = &udma_controlTable[(half ? UDMA_ALTERNATE : UDMA_PRIMARY) + channel];
+
+    entry->control &= ~(0x3FFUL << 4 | UDMA_CTL_MODE_M);
+    if (half) {
+        regs.ALTSET &= ~(1UL << channel);
+    } else {
+        regs.ALTSET |= 1UL << channel;
+    }
+    regs.CHIS |= 1UL << channel;
+}
+
+static void checkPingPong(void)
+{
+    const uint8_t channel = UDMA_CH_UART4_RX;
+    uint8_t bufferA[16];
+    uint8_t bufferB[16];
+    udma_entry_t *primary = &udma_controlTable[UDMA_PRIMARY + channel];
+    udma_entry_t *alternate = &udma_controlTable[UDMA_ALTERNATE + channel];
+    uint32_t armed;
+
+    start();
+    udma_startPingPongRx(channel, &dataRegister, bufferA, bufferB, sizeof(bufferA), callback);
+    armed = primary->control;
+
+    CHECK(primary->srcEnd == &dataRegister && alternate->srcEnd == &dataRegister);
+    CHECK(primary->dstEnd == &bufferA[15] && alternate->dstEnd == &bufferB[15]);
+    CHECK(mode(primary) == UDMA_MODE_PINGPONG && items(primary) == 16);
+    CHECK(alternate->control == armed);
+
+    // A fills, the controller is on B: A is handed over and armed again
+    fillHalf(channel, 0);
+    service(1UL << channel);
+    CHECK(callCount == 1 && calls[0].buffer == bufferA && calls[0].length == 16);
+    CHECK(calls[0].channel == channel);
+    CHECK(primary->control == armed);
+
+    // Then B, with the controller back on A
+    fillHalf(channel, 1);
+    service(1UL << channel);
+    CHECK(callCount == 2 && calls[1].buffer == bufferB);
+    CHECK(alternate->control == armed);
+
+    // Both filled before the interrupt was served: the controller is back
+    // on A, which is the older one and goes first
+    fillHalf(channel, 0);
+    fillHalf(channel, 1);
+    service(1UL << channel);
+    CHECK(callCount == 4);
+    CHECK(calls[2].buffer == bufferA && calls[3].buffer == bufferB);
+    CHECK(primary->control == armed && alternate->control == armed);
+
+    // The same starting from B
+    fillHalf(channel, 0);
+    service(1UL << channel);
+    fillHalf(channel, 1);
+    fillHalf(channel, 0);
+    service(1UL << channel);
+    CHECK(callCount == 7);
+    CHECK(calls[5].buffer == bufferB && calls[6].buffer == bufferA);
+
+    // Nothing filled, nothing to hand over
+    regs.CHIS |= 1UL << channel;
+    service(1UL << channel);
+    CHECK(callCount == 7);
+}
+
+static void checkDispatch(void)
+{
+    static const uint8_t message[] = "OK\r\n";
+    uint8_t received[8];
+    udma_entry_t *txEntry = &udma_controlTable[UDMA_CH_UART1_TX];
+    udma_entry_t *rxEntry = &udma_controlTable[UDMA_CH_UART1_RX];
+
+    start();
+    // ENASET keeps only the last write here, the controller ORs them up
+    udma_startTx(UDMA_CH_UART1_TX, message, 4, &dataRegister, callback);
+    CHECK(regs.ENASET == 1UL << UDMA_CH_UART1_TX);
+    udma_startRx(UDMA_CH_UART1_RX, &dataRegister, received, sizeof(received), callback);
+    CHECK(regs.ENASET == 1UL << UDMA_CH_UART1_RX);
+    CHECK(txEntry->srcEnd == &message[3] && txEntry->dstEnd == &dataRegister);
+    CHECK(rxEntry->srcEnd == &dataRegister && rxEntry->dstEnd == &received[7]);
+
+    runTx(txEntry);
+    CHECK(sentCount == 4 && memcmp(sent, message, 4) == 0);
+
+    // Only the channels in the mask are served, the other stays pending
+    regs.CHIS = 1UL << UDMA_CH_UART1_TX | 1UL << UDMA_CH_UART1_RX;
+    service(1UL << UDMA_CH_UART1_TX);
+    CHECK(callCount == 1);
+    CHECK(calls[0].channel == UDMA_CH_UART1_TX);
+    CHECK(calls[0].buffer == message && calls[0].length == 4);
+    CHECK(regs.CHIS == 1UL << UDMA_CH_UART1_RX);
+
+    service(1UL << UDMA_CH_UART1_RX | 1UL << UDMA_CH_UART1_TX);
+    CHECK(callCount == 2);
+    CHECK(calls[1].channel == UDMA_CH_UART1_RX);
+    CHECK(calls[1].buffer == received && calls[1].length == 8);
+
+    // A stopped channel reports nothing
+    udma_startRx(UDMA_CH_UART1_RX, &dataRegister, received, sizeof(received), callback);
+    udma_stop(UDMA_CH_UART1_RX);
+    regs.CHIS = 1UL << UDMA_CH_UART1_RX;
+    service(1UL << UDMA_CH_UART1_RX);
+    CHECK(callCount == 2);
+
+    // Neither does one without a callback
+    udma_startTx(UDMA_CH_UART1_TX, message, 4, &dataRegister, 0);
+    regs.CHIS = 1UL << UDMA_CH_UART1_TX;
+    service(1UL << UDMA_CH_UART1_TX);
+    CHECK(callCount == 2);
+
+    // Channel routing keeps the other channels' encodings
+    udma_assignChannel(UDMA_CH_UART4_RX, UDMA_ENC_UART4);
+    udma_assignChannel(UDMA_CH_UART4_TX, UDMA_ENC_UART4);
+    udma_assignChannel(UDMA_CH_UART1_RX, UDMA_ENC_UART1);
+    CHECK(regs.CHMAP[2] == 0x00002200);
+}
+
+int main(void)
+{
+    checkGather();
+    checkPingPong();
+    checkDispatch();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}